@@ -0,0 +1,210 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: anillo.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Implementación de la cola declarada en anillo.h. La celda de la
+ *              posición p está libre cuando su secuencia vale p y llena cuando
+ *              vale p + 1; al vaciarla se adelanta una vuelta (p + capacidad).
+ *              Un consumidor reclama con un solo CAS todas las celdas llenas
+ *              consecutivas que encuentre, hasta el máximo pedido.
+ * =============================================================================
+ */
+
+#include <stdint.h>
+
+#include "anillo.h"
+
+int anillo_init(anillo_t *anillo, size_t capacidad) {
+    size_t n = 2;
+    while (n < capacidad) {
+        n <<= 1;
+    }
+
+    anillo->celdas = malloc(n * sizeof(celda_anillo_t));
+    if (!anillo->celdas) {
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        anillo->celdas[i].secuencia = i;
+    }
+
+    anillo->mascara = n - 1;
+    anillo->cabeza = 0;
+    anillo->cola = 0;
+    pthread_mutex_init(&anillo->espera_mutex, NULL);
+    pthread_cond_init(&anillo->hay_datos, NULL);
+    pthread_cond_init(&anillo->hay_espacio, NULL);
+    anillo->consumidores_esperando = 0;
+    anillo->productores_esperando = 0;
+    anillo->cerrado = 0;
+    return 0;
+}
+
+void anillo_destruir(anillo_t *anillo) {
+    free(anillo->celdas);
+    anillo->celdas = NULL;
+    pthread_mutex_destroy(&anillo->espera_mutex);
+    pthread_cond_destroy(&anillo->hay_datos);
+    pthread_cond_destroy(&anillo->hay_espacio);
+}
+
+// Función para despertar a quien espera del otro lado, solo si hay alguien.
+// La barrera ordena la publicación de la celda antes de leer el contador; el
+// que se duerme incrementa el contador antes de volver a mirar la cola, así
+// que alguno de los dos ve al otro y no se pierde el aviso.
+static void despertar(anillo_t *anillo, int *esperando, pthread_cond_t *cond) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(esperando, __ATOMIC_RELAXED) > 0) {
+        pthread_mutex_lock(&anillo->espera_mutex);
+        pthread_cond_broadcast(cond);
+        pthread_mutex_unlock(&anillo->espera_mutex);
+    }
+}
+
+static void anotar_espera(int *esperando) {
+    __atomic_add_fetch(esperando, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static int poner_sin_avisar(anillo_t *anillo, const solicitud_t *sol) {
+    size_t pos = __atomic_load_n(&anillo->cabeza, __ATOMIC_RELAXED);
+
+    while (1) {
+        celda_anillo_t *celda = &anillo->celdas[pos & anillo->mascara];
+        size_t secuencia = __atomic_load_n(&celda->secuencia, __ATOMIC_ACQUIRE);
+        intptr_t diferencia = (intptr_t)secuencia - (intptr_t)pos;
+
+        if (diferencia == 0) {
+            // Celda libre en esta vuelta: reclamarla (si falla, pos se actualiza)
+            if (__atomic_compare_exchange_n(&anillo->cabeza, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                celda->dato = *sol;
+                __atomic_store_n(&celda->secuencia, pos + 1, __ATOMIC_RELEASE);
+                return 1;
+            }
+        } else if (diferencia < 0) {
+            return 0;  // la celda aún guarda un dato de la vuelta anterior: llena
+        } else {
+            pos = __atomic_load_n(&anillo->cabeza, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static int sacar_sin_avisar(anillo_t *anillo, solicitud_t *destino, int max) {
+    size_t pos = __atomic_load_n(&anillo->cola, __ATOMIC_RELAXED);
+
+    while (1) {
+        // Contar las celdas llenas consecutivas a partir de pos
+        int listos = 0;
+        while (listos < max) {
+            celda_anillo_t *celda = &anillo->celdas[(pos + listos) & anillo->mascara];
+            size_t secuencia = __atomic_load_n(&celda->secuencia, __ATOMIC_ACQUIRE);
+            if (secuencia != pos + listos + 1) {
+                break;
+            }
+            listos++;
+        }
+
+        if (listos == 0) {
+            size_t actual = __atomic_load_n(&anillo->cola, __ATOMIC_RELAXED);
+            if (actual == pos) {
+                return 0;  // vacía (o el productor aún no publicó la celda)
+            }
+            pos = actual;  // otro consumidor se adelantó
+            continue;
+        }
+
+        if (__atomic_compare_exchange_n(&anillo->cola, &pos, pos + listos, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            for (int i = 0; i < listos; i++) {
+                celda_anillo_t *celda = &anillo->celdas[(pos + i) & anillo->mascara];
+                destino[i] = celda->dato;
+                __atomic_store_n(&celda->secuencia, pos + i + anillo->mascara + 1,
+                                 __ATOMIC_RELEASE);
+            }
+            return listos;
+        }
+    }
+}
+
+int anillo_intentar_poner(anillo_t *anillo, const solicitud_t *sol) {
+    if (!poner_sin_avisar(anillo, sol)) {
+        return 0;
+    }
+    despertar(anillo, &anillo->consumidores_esperando, &anillo->hay_datos);
+    return 1;
+}
+
+int anillo_intentar_sacar_lote(anillo_t *anillo, solicitud_t *destino, int max) {
+    int n = sacar_sin_avisar(anillo, destino, max);
+    if (n > 0) {
+        despertar(anillo, &anillo->productores_esperando, &anillo->hay_espacio);
+    }
+    return n;
+}
+
+// Función para poner esperando a que haya espacio si la cola está llena
+int anillo_poner(anillo_t *anillo, const solicitud_t *sol) {
+    while (1) {
+        if (anillo_intentar_poner(anillo, sol)) {
+            return 0;
+        }
+
+        pthread_mutex_lock(&anillo->espera_mutex);
+        anotar_espera(&anillo->productores_esperando);
+        int puesto = !anillo->cerrado && poner_sin_avisar(anillo, sol);
+        int cerrado = anillo->cerrado;
+        if (!puesto && !cerrado) {
+            pthread_cond_wait(&anillo->hay_espacio, &anillo->espera_mutex);
+        }
+        __atomic_sub_fetch(&anillo->productores_esperando, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&anillo->espera_mutex);
+
+        if (puesto) {
+            despertar(anillo, &anillo->consumidores_esperando, &anillo->hay_datos);
+            return 0;
+        }
+        if (cerrado) {
+            return -1;
+        }
+    }
+}
+
+// Función para sacar hasta max elementos, esperando si la cola está vacía
+int anillo_sacar_lote(anillo_t *anillo, solicitud_t *destino, int max) {
+    while (1) {
+        int n = anillo_intentar_sacar_lote(anillo, destino, max);
+        if (n > 0) {
+            return n;
+        }
+
+        pthread_mutex_lock(&anillo->espera_mutex);
+        anotar_espera(&anillo->consumidores_esperando);
+        n = sacar_sin_avisar(anillo, destino, max);
+        int cerrado = anillo->cerrado;
+        if (n == 0 && !cerrado) {
+            pthread_cond_wait(&anillo->hay_datos, &anillo->espera_mutex);
+        }
+        __atomic_sub_fetch(&anillo->consumidores_esperando, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&anillo->espera_mutex);
+
+        if (n > 0) {
+            despertar(anillo, &anillo->productores_esperando, &anillo->hay_espacio);
+            return n;
+        }
+        if (cerrado) {
+            return 0;  // cerrada y vacía
+        }
+    }
+}
+
+// Función para cerrar la cola: los consumidores vacían lo que quede y terminan
+void anillo_cerrar(anillo_t *anillo) {
+    pthread_mutex_lock(&anillo->espera_mutex);
+    anillo->cerrado = 1;
+    pthread_cond_broadcast(&anillo->hay_datos);
+    pthread_cond_broadcast(&anillo->hay_espacio);
+    pthread_mutex_unlock(&anillo->espera_mutex);
+}
@@ -0,0 +1,59 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: anillo.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Cola circular sin bloqueos para varios productores y varios
+ *              consumidores (reemplaza a circular_buffer_t). Cada celda lleva
+ *              un número de secuencia que indica si está libre o llena para la
+ *              vuelta actual, así productores y consumidores solo compiten por
+ *              un CAS sobre su propio índice. El mutex y las condiciones solo
+ *              se usan para dormir cuando la cola está vacía o llena.
+ * =============================================================================
+ */
+
+#ifndef ANILLO_H
+#define ANILLO_H
+
+#include "estructuras.h"
+
+#define CAPACIDAD_ANILLO_POR_DEFECTO 1024
+#define LOTE_ANILLO 32  // máximo de elementos que un consumidor saca de una vez
+
+typedef struct {
+    size_t secuencia;
+    solicitud_t dato;
+} celda_anillo_t;
+
+// Los índices de productores y consumidores van en líneas de caché distintas
+// para que escribir uno no invalide al otro.
+typedef struct {
+    celda_anillo_t *celdas;
+    size_t mascara;
+
+    size_t cabeza __attribute__((aligned(TAM_LINEA_CACHE)));  // próxima posición a escribir
+    size_t cola __attribute__((aligned(TAM_LINEA_CACHE)));    // próxima posición a leer
+
+    pthread_mutex_t espera_mutex __attribute__((aligned(TAM_LINEA_CACHE)));
+    pthread_cond_t hay_datos;
+    pthread_cond_t hay_espacio;
+    int consumidores_esperando;
+    int productores_esperando;
+    int cerrado;
+} anillo_t;
+
+int anillo_init(anillo_t *anillo, size_t capacidad);
+void anillo_destruir(anillo_t *anillo);
+
+// Sin bloqueo: devuelven 1 si pusieron/sacaron y 0 si la cola estaba llena/vacía
+int anillo_intentar_poner(anillo_t *anillo, const solicitud_t *sol);
+int anillo_intentar_sacar_lote(anillo_t *anillo, solicitud_t *destino, int max);
+
+// Con espera: poner devuelve -1 si la cola está cerrada; sacar_lote devuelve
+// cuántos elementos sacó, o 0 cuando la cola está cerrada y vacía
+int anillo_poner(anillo_t *anillo, const solicitud_t *sol);
+int anillo_sacar_lote(anillo_t *anillo, solicitud_t *destino, int max);
+void anillo_cerrar(anillo_t *anillo);
+
+#endif // ANILLO_H
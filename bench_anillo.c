@@ -0,0 +1,169 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros - Benchmark de la cola de devoluciones
+ * Archivo: bench_anillo.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Un productor (como el hilo lector) encola solicitudes y uno o
+ *              varios consumidores las sacan. Compara el antiguo
+ *              circular_buffer_t (mutex + dos condiciones, 10 casillas) con la
+ *              cola sin bloqueos de anillo.c, con su capacidad por defecto y
+ *              con la misma capacidad que el buffer antiguo.
+ * Uso: ./bench_anillo [solicitudes] [max_consumidores]
+ * =============================================================================
+ */
+
+#include "anillo.h"
+#include "bench_comun.h"
+
+#define BUFFER_ANTIGUO 10
+
+// Copia del buffer productor-consumidor original de receptor.c
+typedef struct {
+    solicitud_t buffer[BUFFER_ANTIGUO];
+    int in;
+    int out;
+    int count;
+    int cerrado;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+} buffer_antiguo_t;
+
+static buffer_antiguo_t antiguo;
+static anillo_t anillo;
+static long num_solicitudes;
+static volatile unsigned sumidero;
+
+static void antiguo_put(const solicitud_t *sol) {
+    pthread_mutex_lock(&antiguo.mutex);
+    while (antiguo.count == BUFFER_ANTIGUO) {
+        pthread_cond_wait(&antiguo.not_full, &antiguo.mutex);
+    }
+    antiguo.buffer[antiguo.in] = *sol;
+    antiguo.in = (antiguo.in + 1) % BUFFER_ANTIGUO;
+    antiguo.count++;
+    pthread_cond_signal(&antiguo.not_empty);
+    pthread_mutex_unlock(&antiguo.mutex);
+}
+
+static int antiguo_get(solicitud_t *sol) {
+    pthread_mutex_lock(&antiguo.mutex);
+    while (antiguo.count == 0 && !antiguo.cerrado) {
+        pthread_cond_wait(&antiguo.not_empty, &antiguo.mutex);
+    }
+    if (antiguo.count == 0) {
+        pthread_mutex_unlock(&antiguo.mutex);
+        return 0;
+    }
+    *sol = antiguo.buffer[antiguo.out];
+    antiguo.out = (antiguo.out + 1) % BUFFER_ANTIGUO;
+    antiguo.count--;
+    pthread_cond_signal(&antiguo.not_full);
+    pthread_mutex_unlock(&antiguo.mutex);
+    return 1;
+}
+
+static void *consumidor_antiguo(void *arg) {
+    long *consumidos = arg;
+    solicitud_t sol;
+    while (antiguo_get(&sol)) {
+        sumidero += sol.isbn;
+        (*consumidos)++;
+    }
+    return NULL;
+}
+
+static void *consumidor_anillo(void *arg) {
+    long *consumidos = arg;
+    solicitud_t lote[LOTE_ANILLO];
+    int n;
+    while ((n = anillo_sacar_lote(&anillo, lote, LOTE_ANILLO)) > 0) {
+        for (int i = 0; i < n; i++) {
+            sumidero += lote[i].isbn;
+        }
+        *consumidos += n;
+    }
+    return NULL;
+}
+
+// Función para una corrida: devuelve solicitudes por segundo. capacidad 0
+// corre el buffer antiguo.
+static double correr(size_t capacidad, int num_consumidores) {
+    pthread_t hilos[num_consumidores];
+    long consumidos[num_consumidores];
+    solicitud_t sol = {0};
+    sol.operacion = OP_DEVOLVER;
+
+    if (capacidad == 0) {
+        memset(&antiguo, 0, sizeof(antiguo));
+        pthread_mutex_init(&antiguo.mutex, NULL);
+        pthread_cond_init(&antiguo.not_full, NULL);
+        pthread_cond_init(&antiguo.not_empty, NULL);
+    } else if (anillo_init(&anillo, capacidad) != 0) {
+        return 0;
+    }
+
+    double inicio = ahora_s();
+    for (int c = 0; c < num_consumidores; c++) {
+        consumidos[c] = 0;
+        pthread_create(&hilos[c], NULL, capacidad ? consumidor_anillo : consumidor_antiguo,
+                       &consumidos[c]);
+    }
+
+    for (long i = 0; i < num_solicitudes; i++) {
+        sol.isbn = (int)i + 1;
+        if (capacidad) {
+            anillo_poner(&anillo, &sol);
+        } else {
+            antiguo_put(&sol);
+        }
+    }
+
+    if (capacidad) {
+        anillo_cerrar(&anillo);
+    } else {
+        pthread_mutex_lock(&antiguo.mutex);
+        antiguo.cerrado = 1;
+        pthread_cond_broadcast(&antiguo.not_empty);
+        pthread_mutex_unlock(&antiguo.mutex);
+    }
+
+    long total = 0;
+    for (int c = 0; c < num_consumidores; c++) {
+        pthread_join(hilos[c], NULL);
+        total += consumidos[c];
+    }
+    double segundos = ahora_s() - inicio;
+
+    if (capacidad) {
+        anillo_destruir(&anillo);
+    } else {
+        pthread_mutex_destroy(&antiguo.mutex);
+        pthread_cond_destroy(&antiguo.not_full);
+        pthread_cond_destroy(&antiguo.not_empty);
+    }
+
+    if (total != num_solicitudes) {
+        fprintf(stderr, "Se perdieron solicitudes: %ld de %ld\n", total, num_solicitudes);
+    }
+    return num_solicitudes / segundos;
+}
+
+int main(int argc, char *argv[]) {
+    num_solicitudes = (argc > 1) ? atol(argv[1]) : 1000000;
+    int max_consumidores = (argc > 2) ? atoi(argv[2]) : 4;
+
+    printf("CPUs en línea: %ld, solicitudes por corrida: %ld\n",
+           sysconf(_SC_NPROCESSORS_ONLN), num_solicitudes);
+    printf("%12s %18s %18s %18s\n", "consumidores", "antiguo sol/s",
+           "anillo(16) sol/s", "anillo(1024) sol/s");
+
+    for (int c = 1; c <= max_consumidores; c *= 2) {
+        double base = correr(0, c);
+        double chico = correr(BUFFER_ANTIGUO, c);
+        double grande = correr(CAPACIDAD_ANILLO_POR_DEFECTO, c);
+        printf("%12d %18.0f %18.0f %18.0f  (%.2fx)\n", c, base, chico, grande, grande / base);
+    }
+    return 0;
+}
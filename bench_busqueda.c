@@ -0,0 +1,216 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros - Benchmark de búsqueda por título
+ * Archivo: bench_busqueda.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Genera un catálogo sintético de títulos con palabras de un
+ *              vocabulario en el que unas pocas son muy frecuentes, mide cuánto
+ *              tarda busqueda_iniciar() y la latencia (P50, P99 y máxima) de
+ *              búsquedas de 1, 2 y 3 palabras tomadas de títulos existentes.
+ *              Como referencia mide también un recorrido lineal con
+ *              strcasestr sobre todos los títulos. Los últimos títulos se
+ *              agregan de a uno con busqueda_agregar() después de construir
+ *              el índice, y se comprueba que las búsquedas den lo mismo que
+ *              con el índice construido de una vez.
+ * Uso: ./bench_busqueda [titulos] [busquedas_por_tipo]
+ * =============================================================================
+ */
+
+#include "catalogo.h"
+#include "busqueda.h"
+#include "bench_comun.h"
+
+#define ARCHIVO_BENCH "/tmp/bench_busqueda.txt"
+#define VOCABULARIO 20000
+#define MAX_PALABRAS_TITULO 6
+#define BUSQUEDAS_LINEALES 20
+#define TITULOS_AGREGADOS 1000   // se indexan con busqueda_agregar()
+#define DUPLICADO_CADA 100       // de los agregados, uno de cada tantos repite un ISBN
+
+static char palabras[VOCABULARIO][16];
+
+// Palabra del vocabulario con sesgo hacia las primeras (las más frecuentes)
+static const char *palabra_sesgada(void) {
+    double u = uniforme();
+    return palabras[(int)(VOCABULARIO * u * u * u)];
+}
+
+// Función para armar un vocabulario de palabras de 2 a 4 sílabas
+static void generar_vocabulario(void) {
+    static const char *silabas[] = {
+        "ba", "ce", "di", "fo", "gu", "la", "me", "ni", "po", "ru",
+        "sa", "te", "vi", "zo", "cha", "lle", "mar", "sol", "tor", "qui"
+    };
+    for (int i = 0; i < VOCABULARIO; i++) {
+        int n = 2 + (int)(aleatorio() % 3);
+        palabras[i][0] = '\0';
+        for (int s = 0; s < n; s++) {
+            strcat(palabras[i], silabas[aleatorio() % 20]);
+        }
+    }
+}
+
+// Cuántos de los últimos títulos se agregan después de construir el índice
+static int titulos_agregados(int titulos) {
+    return titulos / 2 < TITULOS_AGREGADOS ? titulos / 2 : TITULOS_AGREGADOS;
+}
+
+// Los títulos que se agregan al final incluyen algunos ISBN repetidos, que
+// la carga ignora y tampoco deben entrar al índice
+static int generar_archivo(int titulos) {
+    FILE *f = crear_archivo_bench(ARCHIVO_BENCH);
+    if (!f) {
+        return -1;
+    }
+    for (int l = 0; l < titulos; l++) {
+        int n = 2 + (int)(aleatorio() % (MAX_PALABRAS_TITULO - 1));
+        for (int p = 0; p < n; p++) {
+            fprintf(f, "%s%s", p ? " " : "", palabra_sesgada());
+        }
+        int agregado = l - (titulos - titulos_agregados(titulos));
+        int isbn = (agregado >= 0 && agregado % DUPLICADO_CADA == DUPLICADO_CADA - 1) ? agregado + 1 : l + 1;
+        fprintf(f, ", %d, 1\n", isbn);
+        escribir_ejemplares(f, 1, 0);
+    }
+    fclose(f);
+    return 0;
+}
+
+static int comparar_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Función para armar una búsqueda con k palabras de un título al azar
+static void armar_busqueda(int k, char *texto, size_t largo) {
+    char copia[MAX_STRING];
+    char *partes[MAX_PALABRAS_TITULO];
+    int n = 0;
+
+    snprintf(copia, sizeof(copia), "%s", biblioteca[aleatorio() % num_libros].nombre);
+    for (char *tok = strtok(copia, " "); tok && n < MAX_PALABRAS_TITULO; tok = strtok(NULL, " ")) {
+        partes[n++] = tok;
+    }
+    texto[0] = '\0';
+    for (int i = 0; i < k && i < n; i++) {
+        size_t usado = strlen(texto);
+        snprintf(texto + usado, largo - usado, "%s%s", i ? " " : "", partes[(i * 2 + 1) % n]);
+    }
+}
+
+static void medir(const char *tipo, int k, int busquedas) {
+    double *latencias = malloc(busquedas * sizeof(double));
+    int libros[MAX_ENCONTRADOS];
+    long encontrados = 0;
+    int hay_mas;
+    char texto[MAX_STRING];
+
+    for (int i = 0; i < busquedas; i++) {
+        armar_busqueda(k, texto, sizeof(texto));
+        uint64_t inicio = ahora_ns();
+        encontrados += busqueda_buscar(texto, libros, MAX_ENCONTRADOS, &hay_mas);
+        latencias[i] = ahora_ns() - inicio;
+    }
+    qsort(latencias, busquedas, sizeof(double), comparar_doubles);
+    printf("%-22s %10.1f %10.1f %10.1f %12.1f\n", tipo,
+           latencias[busquedas / 2] / 1e3, latencias[(int)(busquedas * 0.99)] / 1e3,
+           latencias[busquedas - 1] / 1e3, (double)encontrados / busquedas);
+    free(latencias);
+}
+
+// Función para buscar el título completo de cada libro agregado y resumir
+// los resultados en una suma (con el mismo índice, la misma suma)
+static uint64_t resumir_agregados(int primero) {
+    int libros[MAX_ENCONTRADOS];
+    int hay_mas;
+    uint64_t suma = 0;
+
+    for (int l = primero; l < num_libros; l++) {
+        int n = busqueda_buscar(biblioteca[l].nombre, libros, MAX_ENCONTRADOS, &hay_mas);
+        suma = suma * 31 + n * 2 + hay_mas;
+        for (int i = 0; i < n; i++) {
+            suma = suma * 31 + libros[i];
+        }
+    }
+    return suma;
+}
+
+// Función para indexar los últimos títulos con busqueda_agregar() y
+// compararlo con construir el índice con todos. Devuelve 0 si coinciden.
+static int probar_agregados(void) {
+    int agregados = titulos_agregados(num_libros);
+    int primero = num_libros - agregados;
+
+    // El índice se construye como si el catálogo terminara antes
+    busqueda_liberar();
+    num_libros = primero;
+    int error = busqueda_iniciar();
+    num_libros = primero + agregados;
+
+    uint64_t inicio = ahora_ns();
+    for (int l = primero; l < num_libros && error == 0; l++) {
+        error = busqueda_agregar(l);
+    }
+    double tiempo = ahora_ns() - inicio;
+    if (error != 0) {
+        fprintf(stderr, "Sin memoria para el índice de títulos\n");
+        return -1;
+    }
+    uint64_t con_agregados = resumir_agregados(primero);
+
+    busqueda_liberar();
+    if (busqueda_iniciar() != 0) {
+        fprintf(stderr, "Sin memoria para el índice de títulos\n");
+        return -1;
+    }
+    int coinciden = (resumir_agregados(primero) == con_agregados);
+    printf("\n%d títulos agregados de a uno: %.2f us por título, búsquedas %s\n",
+           agregados, tiempo / agregados / 1e3,
+           coinciden ? "iguales al índice completo" : "DISTINTAS del índice completo");
+    return coinciden ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    int titulos = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int busquedas = (argc > 2) ? atoi(argv[2]) : 20000;
+
+    generar_vocabulario();
+    if (catalogo_init_bloqueos(FRANJAS_POR_DEFECTO) < 0 || generar_archivo(titulos) != 0 ||
+        catalogo_cargar(ARCHIVO_BENCH) != 0) {
+        return 1;
+    }
+
+    uint64_t inicio = ahora_ns();
+    if (busqueda_iniciar() != 0) {
+        fprintf(stderr, "Sin memoria para el índice de títulos\n");
+        return 1;
+    }
+    printf("Índice de %d títulos construido en %.1f ms\n\n", num_libros, (ahora_ns() - inicio) / 1e6);
+
+    printf("%-22s %10s %10s %10s %12s\n", "búsqueda", "P50 us", "P99 us", "max us", "resultados");
+    medir("1 palabra", 1, busquedas);
+    medir("2 palabras", 2, busquedas);
+    medir("3 palabras", 3, busquedas);
+
+    // Referencia: recorrer todos los títulos buscando una palabra
+    char texto[MAX_STRING];
+    long coincidencias = 0;
+    inicio = ahora_ns();
+    for (int i = 0; i < BUSQUEDAS_LINEALES; i++) {
+        armar_busqueda(1, texto, sizeof(texto));
+        for (int l = 0; l < num_libros; l++) {
+            coincidencias += strcasestr(biblioteca[l].nombre, texto) != NULL;
+        }
+    }
+    printf("%-22s %10.1f %10s %10s %12.1f\n", "lineal (strcasestr)",
+           (double)(ahora_ns() - inicio) / BUSQUEDAS_LINEALES / 1e3, "-", "-",
+           (double)coincidencias / BUSQUEDAS_LINEALES);
+
+    int resultado = probar_agregados() == 0 ? 0 : 1;
+
+    busqueda_liberar();
+    catalogo_liberar();
+    unlink(ARCHIVO_BENCH);
+    return resultado;
+}
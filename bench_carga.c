@@ -0,0 +1,126 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros - Benchmark de carga
+ * Archivo: bench_carga.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Genera un archivo de datos sintético con el número de
+ *              ejemplares pedido y mide su carga: primero solo el recorrido
+ *              con fgets + sscanf del cargador anterior, como referencia, y
+ *              después catalogo_cargar_paralelo() con 1, 2, 4... hilos hasta
+ *              el máximo pedido. Reporta tiempos y la memoria residente por
+ *              cada 1M ejemplares.
+ * Uso: ./bench_carga [millones_de_ejemplares] [ejemplares_por_libro] [max_hilos]
+ * =============================================================================
+ */
+
+#include "catalogo.h"
+#include "bench_comun.h"
+
+#define ARCHIVO_BENCH "/tmp/bench_libros.txt"
+
+// Memoria residente del proceso en bytes (segundo campo de /proc/self/statm)
+static long memoria_residente(void) {
+    long total = 0, residente = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%ld %ld", &total, &residente) != 2) {
+            residente = 0;
+        }
+        fclose(f);
+    }
+    return residente * sysconf(_SC_PAGESIZE);
+}
+
+// Función para generar el archivo sintético en el formato de libros.txt
+static int generar_archivo(long ejemplares, int por_libro) {
+    FILE *f = crear_archivo_bench(ARCHIVO_BENCH);
+    if (!f) {
+        return -1;
+    }
+
+    long libros = (ejemplares + por_libro - 1) / por_libro;
+    for (long l = 0; l < libros; l++) {
+        int n = (l == libros - 1) ? (int)(ejemplares - l * por_libro) : por_libro;
+        fprintf(f, "Libro de prueba numero %ld, %ld, %d\n", l, l + 1, n);
+        escribir_ejemplares(f, n, 3);
+    }
+
+    fclose(f);
+    return 0;
+}
+
+// Recorrido del cargador anterior (fgets + sscanf por línea), sin guardar
+// nada: sirve de cota inferior de lo que tardaba
+static double medir_fgets_sscanf(void) {
+    FILE *f = fopen(ARCHIVO_BENCH, "r");
+    if (!f) {
+        return 0;
+    }
+
+    char linea[MAX_LINE], nombre[MAX_STRING], fecha[12], status;
+    int isbn, n, numero;
+    long ejemplares = 0;
+    double inicio = ahora_s();
+    while (fgets(linea, sizeof(linea), f)) {
+        if (sscanf(linea, "%255[^,], %d, %d", nombre, &isbn, &n) != 3) {
+            continue;
+        }
+        for (int i = 0; i < n && fgets(linea, sizeof(linea), f); i++) {
+            if (sscanf(linea, "%d, %c, %11s", &numero, &status, fecha) == 3) {
+                ejemplares++;
+            }
+        }
+    }
+    double segundos = ahora_s() - inicio;
+    fclose(f);
+    return ejemplares > 0 ? segundos : 0;
+}
+
+int main(int argc, char *argv[]) {
+    double millones = (argc > 1) ? atof(argv[1]) : 1.0;
+    int por_libro = (argc > 2) ? atoi(argv[2]) : 10;
+    int max_hilos = (argc > 3) ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long ejemplares = (long)(millones * 1000000);
+    if (max_hilos < 1) {
+        max_hilos = 1;
+    }
+
+    if (ejemplares <= 0 || por_libro <= 0) {
+        printf("Uso: %s [millones_de_ejemplares] [ejemplares_por_libro] [max_hilos]\n", argv[0]);
+        return 1;
+    }
+
+    printf("Generando %ld ejemplares (%d por libro) en %s...\n",
+           ejemplares, por_libro, ARCHIVO_BENCH);
+    if (generar_archivo(ejemplares, por_libro) != 0) {
+        return 1;
+    }
+
+    printf("CPUs en línea: %ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+    printf("fgets + sscanf (cargador anterior, solo lectura): %.3f s\n", medir_fgets_sscanf());
+
+    for (int hilos = 1; hilos <= max_hilos; hilos *= 2) {
+        catalogo_liberar();
+        long rss_antes = memoria_residente();
+        double inicio = ahora_s();
+        if (catalogo_cargar_paralelo(ARCHIVO_BENCH, hilos) != 0) {
+            return 1;
+        }
+        double segundos = ahora_s() - inicio;
+        long rss_despues = memoria_residente();
+
+        double por_millon = 1000000.0 / num_ejemplares_total;
+        printf("%2d hilos: carga %.3f s (%.3f s por 1M ejemplares)\n",
+               hilos, segundos, segundos * por_millon);
+        // La primera corrida parte sin catálogo: solo ahí la diferencia es su memoria
+        if (hilos == 1) {
+            printf("Memoria residente del catálogo: %.1f MiB por 1M ejemplares\n",
+                   (rss_despues - rss_antes) / 1048576.0 * por_millon);
+        }
+    }
+
+    catalogo_liberar();
+    unlink(ARCHIVO_BENCH);
+    return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros - Benchmarks
+ * Archivo: bench_comun.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Utilidades compartidas por los bench_*.c: generador
+ *              pseudoaleatorio determinista, relojes monotónicos y la
+ *              escritura de catálogos sintéticos en el formato de libros.txt.
+ *              Cada bench es un programa de un solo archivo, así que todo va
+ *              aquí como funciones static inline.
+ * =============================================================================
+ */
+
+#ifndef BENCH_COMUN_H
+#define BENCH_COMUN_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#define SEMILLA_BENCH 88172645463325252ull
+
+// Estado del generador; un bench que reparte la carga en procesos puede
+// resembrarlo en cada uno
+static uint64_t estado_rng __attribute__((unused)) = SEMILLA_BENCH;
+
+// Generador xorshift64 (determinista para que las corridas sean comparables)
+static inline uint64_t aleatorio(void) {
+    estado_rng ^= estado_rng << 13;
+    estado_rng ^= estado_rng >> 7;
+    estado_rng ^= estado_rng << 17;
+    return estado_rng;
+}
+
+// Real uniforme en [0, 1) con los 53 bits altos del generador
+static inline double uniforme(void) {
+    return (aleatorio() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Reloj monotónico en nanosegundos
+static inline uint64_t ahora_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Reloj monotónico en segundos
+static inline double ahora_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Función para crear el archivo sintético del bench
+static inline FILE *crear_archivo_bench(const char *ruta) {
+    FILE *f = fopen(ruta, "w");
+    if (!f) {
+        perror("Error creando archivo de benchmark");
+    }
+    return f;
+}
+
+// Función para escribir los ejemplares de un libro; con prestado_cada > 0,
+// los ejemplares cuyo número es múltiplo de él empiezan prestados
+static inline void escribir_ejemplares(FILE *f, int ejemplares, int prestado_cada) {
+    for (int e = 1; e <= ejemplares; e++) {
+        int prestado = prestado_cada > 0 && e % prestado_cada == 0;
+        fprintf(f, "%d, %c, 01-03-2025\n", e, prestado ? 'P' : 'D');
+    }
+}
+
+// Función para generar un catálogo de libros "Libro k" con ISBN k (desde 1)
+// y el mismo número de ejemplares cada uno
+static inline int generar_catalogo(const char *ruta, int libros, int ejemplares, int prestado_cada) {
+    FILE *f = crear_archivo_bench(ruta);
+    if (!f) {
+        return -1;
+    }
+    for (int l = 1; l <= libros; l++) {
+        fprintf(f, "Libro %d, %d, %d\n", l, l, ejemplares);
+        escribir_ejemplares(f, ejemplares, prestado_cada);
+    }
+    fclose(f);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros - Benchmark de contención
+ * Archivo: bench_contencion.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Compara el rendimiento de préstamos/devoluciones sobre ISBN
+ *              disjuntos con un solo bloqueo global (equivalente al antiguo
+ *              bd_mutex) y con bloqueo por franjas. Cada hilo trabaja sobre su
+ *              propio subconjunto de libros, así que con franjas no deberían
+ *              competir entre sí.
+ * Uso: ./bench_contencion [max_hilos] [segundos_por_corrida]
+ * =============================================================================
+ */
+
+#include "catalogo.h"
+#include "bench_comun.h"
+
+#define ARCHIVO_BENCH "/tmp/bench_contencion.txt"
+#define LIBROS_BENCH 4096
+#define EJEMPLARES_POR_LIBRO 4
+#define TRABAJO_EN_SECCION 200  // simula el formateo de fechas y el reporte
+
+// Cada hilo en su propia línea de caché: los resultados se escriben una
+// sola vez al terminar, así el bench no mide compartición falsa
+typedef struct {
+    int id;
+    int num_hilos;
+    long operaciones;
+    unsigned sumidero;      // resultado del trabajo simulado, para que no se elimine
+} __attribute__((aligned(TAM_LINEA_CACHE))) datos_hilo_t;
+
+static volatile int detener = 0;
+
+// Trabajo dentro de la sección crítica, para que el bloqueo pese como en
+// receptor.c. 'semilla' encadena las llamadas para que no se pueda sacar
+// del bucle.
+static unsigned trabajo_simulado(unsigned semilla) {
+    unsigned x = semilla;
+    for (int i = 0; i < TRABAJO_EN_SECCION; i++) {
+        x = x * 31 + i;
+    }
+    return x;
+}
+
+// Hilo que presta y devuelve ejemplares de los libros id, id + n, id + 2n...
+static void *hilo_bench(void *arg) {
+    datos_hilo_t *datos = arg;
+    int libro_idx = datos->id;
+    long operaciones = 0;
+    unsigned sumidero = 0;
+
+    while (!detener) {
+        libro_t *libro = &biblioteca[libro_idx];
+
+        catalogo_bloquear(libro_idx);
+        int i = libro_primer_ejemplar(libro, STATUS_DISPONIBLE);
+        if (i != -1) {
+            libro_cambiar_estado(libro, i, STATUS_PRESTADO);
+        }
+        sumidero = trabajo_simulado(sumidero);
+        catalogo_desbloquear(libro_idx);
+
+        catalogo_bloquear(libro_idx);
+        i = libro_primer_ejemplar(libro, STATUS_PRESTADO);
+        if (i != -1) {
+            libro_cambiar_estado(libro, i, STATUS_DISPONIBLE);
+        }
+        sumidero = trabajo_simulado(sumidero);
+        catalogo_desbloquear(libro_idx);
+
+        operaciones += 2;
+        libro_idx += datos->num_hilos;
+        if (libro_idx >= num_libros) {
+            libro_idx = datos->id;
+        }
+    }
+    datos->operaciones = operaciones;
+    datos->sumidero = sumidero;
+    return NULL;
+}
+
+// Función para una corrida: devuelve operaciones por segundo
+static double correr(int num_hilos, double segundos) {
+    pthread_t hilos[num_hilos];
+    datos_hilo_t datos[num_hilos];
+
+    detener = 0;
+    for (int h = 0; h < num_hilos; h++) {
+        datos[h].id = h;
+        datos[h].num_hilos = num_hilos;
+        datos[h].operaciones = 0;
+        pthread_create(&hilos[h], NULL, hilo_bench, &datos[h]);
+    }
+
+    usleep((useconds_t)(segundos * 1e6));
+    detener = 1;
+
+    long total = 0;
+    for (int h = 0; h < num_hilos; h++) {
+        pthread_join(hilos[h], NULL);
+        total += datos[h].operaciones;
+    }
+    return total / segundos;
+}
+
+int main(int argc, char *argv[]) {
+    int max_hilos = (argc > 1) ? atoi(argv[1]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    double segundos = (argc > 2) ? atof(argv[2]) : 1.0;
+    if (max_hilos < 4) {
+        max_hilos = 4;
+    }
+
+    if (generar_catalogo(ARCHIVO_BENCH, LIBROS_BENCH, EJEMPLARES_POR_LIBRO, 0) != 0 || catalogo_cargar(ARCHIVO_BENCH) != 0) {
+        return 1;
+    }
+    printf("CPUs en línea: %ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%6s %18s %18s %8s\n", "hilos", "global ops/s", "franjas ops/s", "ganancia");
+
+    for (int n = 1; n <= max_hilos; n *= 2) {
+        catalogo_init_bloqueos(1);
+        double global = correr(n, segundos);
+        catalogo_destruir_bloqueos();
+
+        catalogo_init_bloqueos(FRANJAS_POR_DEFECTO);
+        double franjas = correr(n, segundos);
+        catalogo_destruir_bloqueos();
+
+        printf("%6d %18.0f %18.0f %7.2fx\n", n, global, franjas, franjas / global);
+    }
+
+    catalogo_liberar();
+    unlink(ARCHIVO_BENCH);
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros - Microbenchmark
+ * Archivo: bench_indice.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Mide la latencia de búsqueda por ISBN con el índice hash de
+ *              indice.c para catálogos de 100 a 1M títulos, y la compara con
+ *              el recorrido lineal que usaba encontrar_libro() originalmente.
+ * Uso: ./bench_indice [busquedas]
+ * =============================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "indice.h"
+#include "bench_comun.h"
+
+#define MAX_LINEAL 10000  // el recorrido lineal solo se mide hasta este tamaño
+
+// Búsqueda lineal equivalente a la versión anterior de encontrar_libro()
+static int buscar_lineal(const int *isbns, int n, int isbn) {
+    for (int i = 0; i < n; i++) {
+        if (isbns[i] == isbn) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char *argv[]) {
+    long busquedas = (argc > 1) ? atol(argv[1]) : 5000000;
+    const int tamanos[] = {100, 1000, 10000, 100000, 1000000};
+    const int num_tamanos = sizeof(tamanos) / sizeof(tamanos[0]);
+
+    printf("%10s %14s %14s\n", "titulos", "hash ns/op", "lineal ns/op");
+
+    for (int t = 0; t < num_tamanos; t++) {
+        int n = tamanos[t];
+        int *isbns = malloc(n * sizeof(int));
+        int *consultas = malloc(n * sizeof(int));
+        indice_t indice;
+
+        if (!isbns || !consultas || indice_init(&indice, n) != 0) {
+            fprintf(stderr, "Sin memoria para %d títulos\n", n);
+            return 1;
+        }
+
+        // ISBN distintos y dispersos, como los de un catálogo real
+        for (int i = 0; i < n; i++) {
+            int isbn;
+            do {
+                isbn = (int)(aleatorio() % 2000000000u) + 1;
+            } while (indice_insertar(&indice, isbn, i) != 0);
+            isbns[i] = isbn;
+        }
+        for (int i = 0; i < n; i++) {
+            consultas[i] = isbns[aleatorio() % n];
+        }
+
+        long acumulado = 0;
+        uint64_t inicio = ahora_ns();
+        for (long i = 0; i < busquedas; i++) {
+            acumulado += indice_buscar(&indice, consultas[i % n]);
+        }
+        double ns_hash = (double)(ahora_ns() - inicio) / busquedas;
+
+        char lineal[32] = "-";
+        if (n <= MAX_LINEAL) {
+            long repeticiones = busquedas / (n / 10 + 1);
+            inicio = ahora_ns();
+            for (long i = 0; i < repeticiones; i++) {
+                acumulado += buscar_lineal(isbns, n, consultas[i % n]);
+            }
+            snprintf(lineal, sizeof(lineal), "%.1f",
+                     (double)(ahora_ns() - inicio) / repeticiones);
+        }
+
+        printf("%10d %14.1f %14s\n", n, ns_hash, lineal);
+
+        // Evita que el compilador elimine los bucles de medición
+        if (acumulado == 42) {
+            printf(" ");
+        }
+
+        indice_destruir(&indice);
+        free(isbns);
+        free(consultas);
+    }
+
+    return 0;
+}
@@ -0,0 +1,729 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros - Generador de carga del receptor
+ * Archivo: bench_receptor.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Benchmark de punta a punta. Genera un catálogo sintético,
+ *              arranca ./receptor sobre él y lanza varios procesos cliente que
+ *              hablan el protocolo binario por el pipe (o por el socket Unix
+ *              con -t socket, juntando en un writev las casillas libres, o
+ *              por anillos en memoria compartida con -t memoria), cada uno
+ *              con una sesión propia y un hilo que envía y otro que recibe,
+ *              con hasta -n solicitudes en vuelo. Los ISBN se eligen con
+ *              distribución uniforme o Zipf. Tras un calentamiento se mide durante -s
+ *              segundos y se informa el rendimiento y la latencia (P50, P99,
+ *              P99.9 y máxima) por operación. Las solicitudes que el receptor
+ *              rechaza por estar ocupado se cuentan aparte, fuera de la tabla.
+ * Uso: ./bench_receptor [-c clientes] [-n en_vuelo] [-s segundos]
+ *                       [-w calentamiento] [-l libros] [-e ejemplares]
+ *                       [-m P:R:D] [-z theta] [-t pipe|socket|memoria]
+ *                       [-a "opciones del receptor"]
+ * =============================================================================
+ */
+
+#include <math.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "memoria.h"
+#include "protocolo.h"
+#include "bench_comun.h"
+
+#define ARCHIVO_BENCH "/tmp/bench_receptor.txt"
+#define MAX_CLIENTES 256
+#define MAX_EN_VUELO_BENCH 256
+#define MAX_MUESTRAS_TOTAL (1 << 23)
+#define MAX_ARGS_RECEPTOR 32
+#define SEGUNDOS_ESPERA_RECEPTOR 60
+#define SEGUNDOS_ESPERA_CLIENTES 10
+
+enum { BENCH_PRESTAR, BENCH_RENOVAR, BENCH_DEVOLVER, NUM_OPS_BENCH };
+
+static const operation_t OPERACIONES[NUM_OPS_BENCH] = { OP_PRESTAR, OP_RENOVAR, OP_DEVOLVER };
+static const char *NOMBRES_OPS[NUM_OPS_BENCH] = { "prestar", "renovar", "devolver" };
+
+// Una latencia medida (en ns, hasta unos 4 s) y su operación
+typedef struct {
+    uint32_t ns;
+    uint32_t op;
+} muestra_t;
+
+// Resultados de un cliente, en memoria compartida con el proceso padre
+typedef struct {
+    uint64_t enviadas[NUM_OPS_BENCH];
+    uint64_t exitosas[NUM_OPS_BENCH];
+    long num_muestras;
+    long perdidas;          // medidas que no cupieron en el arreglo de muestras
+    uint64_t rechazadas;    // respuestas RES_OCUPADO
+    int error;
+} resultado_cliente_t;
+
+typedef struct {
+    int detener;
+    uint64_t inicio_medicion;
+    resultado_cliente_t clientes[MAX_CLIENTES];
+} control_t;
+
+// Solicitud en vuelo de un cliente
+typedef struct {
+    uint64_t enviada;
+    int op;
+    unsigned id;
+} pendiente_t;
+
+// Parámetros
+static int num_clientes = 4;
+static int en_vuelo = 8;
+static double segundos = 5.0;
+static double calentamiento = 1.0;
+static int libros = 10000;
+static int ejemplares = 4;
+static int mezcla[NUM_OPS_BENCH] = { 50, 25, 25 };
+static double theta = 0.99;
+static char opciones_receptor[MAX_LINE];
+static int usar_socket = 0;         // también con -t memoria (el socket la arranca)
+static int usar_memoria = 0;
+
+static char pipe_receptor[MAX_STRING];
+static char ruta_socket[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static control_t *control;
+static muestra_t *muestras;
+static long muestras_por_cliente;
+static double *acumulada = NULL;    // distribución acumulada de Zipf por rango
+
+// Estado de un proceso cliente (compartido entre su hilo emisor y receptor)
+static int pipe_fd, resp_fd;
+static memoria_t *memoria;          // -t memoria: el hilo emisor produce y el de respuestas consume
+static int aviso_fd = -1;
+static pendiente_t pendientes[MAX_EN_VUELO_BENCH];
+static uint8_t tramas[MAX_EN_VUELO_BENCH][PROTO_MAX_TRAMA];
+static int libres[MAX_EN_VUELO_BENCH];
+static int num_libres;
+static pthread_mutex_t mutex_pendientes = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond_pendientes = PTHREAD_COND_INITIALIZER;
+static resultado_cliente_t *resultado;
+static muestra_t *mis_muestras;
+static int rechazos_seguidos = 0;   // del hilo de respuestas
+static unsigned semilla_reintentos;
+static uint64_t pausa_hasta = 0;    // el emisor no manda nada antes (RES_OCUPADO)
+
+// Función para preparar la distribución de Zipf: P(rango k) ~ 1 / k^theta
+static int preparar_zipf(void) {
+    if (theta <= 0) {
+        return 0;
+    }
+    acumulada = malloc(libros * sizeof(double));
+    if (!acumulada) {
+        return -1;
+    }
+    double suma = 0;
+    for (int k = 0; k < libros; k++) {
+        suma += 1.0 / pow(k + 1, theta);
+        acumulada[k] = suma;
+    }
+    for (int k = 0; k < libros; k++) {
+        acumulada[k] /= suma;
+    }
+    return 0;
+}
+
+// ISBN de la próxima solicitud: el rango k es el ISBN k + 1
+static int elegir_isbn(void) {
+    double u = uniforme();
+    if (!acumulada) {
+        return 1 + (int)(u * libros);
+    }
+    int desde = 0, hasta = libros - 1;
+    while (desde < hasta) {
+        int medio = desde + (hasta - desde) / 2;
+        if (acumulada[medio] < u) {
+            desde = medio + 1;
+        } else {
+            hasta = medio;
+        }
+    }
+    return desde + 1;
+}
+
+static int elegir_operacion(void) {
+    int r = (int)(aleatorio() % 100);
+    for (int op = 0; op < NUM_OPS_BENCH - 1; op++) {
+        if (r < mezcla[op]) {
+            return op;
+        }
+        r -= mezcla[op];
+    }
+    return NUM_OPS_BENCH - 1;
+}
+
+// Función para copiar tramas en el anillo de solicitudes, esperando espacio
+// si hace falta; al receptor se le avisa una sola vez por tanda
+static int escribir_en_memoria(struct iovec *iov, int num) {
+    int avisar = 0;
+    for (int k = 0; k < num; k++) {
+        int aviso;
+        while ((aviso = memoria_escribir(&memoria->solicitudes, iov[k].iov_base, iov[k].iov_len)) == -1) {
+            if (__atomic_load_n(&memoria->respuestas.cerrado, __ATOMIC_ACQUIRE)) {
+                return -1;
+            }
+            memoria_esperar_espacio(&memoria->solicitudes, iov[k].iov_len);
+        }
+        avisar |= aviso;
+    }
+    return avisar ? eventfd_write(aviso_fd, 1) : 0;
+}
+
+static int enviar(solicitud_t *sol) {
+    uint8_t buf[PROTO_MAX_TRAMA];
+    sol->pid_solicitante = getpid();
+    sol->sesion = -1;
+    size_t largo = protocolo_codificar_solicitud(sol, FORMATO_BINARIO, buf);
+    if (usar_memoria) {
+        struct iovec iov = { .iov_base = buf, .iov_len = largo };
+        return escribir_en_memoria(&iov, 1);
+    }
+    return write(pipe_fd, buf, largo) == (ssize_t)largo ? 0 : -1;
+}
+
+// Función para escribir varias tramas con writev, siguiendo si queda corto
+static int enviar_tramas(struct iovec *iov, int num) {
+    while (num > 0) {
+        ssize_t n = writev(pipe_fd, iov, num);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        while (num > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            num--;
+        }
+        if (num > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+// Función para conectarse al socket del receptor: la conexión ya es la sesión
+static int conectar_socket(void) {
+    struct sockaddr_un direccion = { .sun_family = AF_UNIX };
+    snprintf(direccion.sun_path, sizeof(direccion.sun_path), "%s", ruta_socket);
+    pipe_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (pipe_fd == -1 || connect(pipe_fd, (struct sockaddr *)&direccion, sizeof(direccion)) != 0) {
+        return -1;
+    }
+    resp_fd = pipe_fd;
+    return 0;
+}
+
+// Función para pasarle al receptor el segmento compartido y el eventfd (como
+// compartir_memoria del solicitante)
+static int compartir_memoria(void) {
+    int segmento_fd = memfd_create("bench_receptor", MFD_CLOEXEC);
+    if (segmento_fd == -1 || ftruncate(segmento_fd, sizeof(memoria_t)) != 0) {
+        return -1;
+    }
+    memoria = mmap(NULL, sizeof(memoria_t), PROT_READ | PROT_WRITE, MAP_SHARED, segmento_fd, 0);
+    aviso_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (memoria == MAP_FAILED || aviso_fd == -1) {
+        close(segmento_fd);
+        return -1;
+    }
+    memoria->magia = MEMORIA_MAGIA;
+    memoria->solicitudes.esperando_datos = 1;
+
+    uint8_t marca = 0;
+    struct iovec iov = { .iov_base = &marca, .iov_len = 1 };
+    union {
+        struct cmsghdr cabecera;
+        char datos[CMSG_SPACE(2 * sizeof(int))];
+    } mensaje_control;
+    memset(&mensaje_control, 0, sizeof(mensaje_control));
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = mensaje_control.datos,
+                          .msg_controllen = sizeof(mensaje_control.datos) };
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    int fds[2] = { segmento_fd, aviso_fd };
+    memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+    ssize_t n = sendmsg(pipe_fd, &msg, 0);
+    close(segmento_fd);
+    if (n != 1) {
+        return -1;
+    }
+
+    for (int i = 0; i < SEGUNDOS_ESPERA_RECEPTOR * 1000 / MEMORIA_ESPERA_MS &&
+                    !__atomic_load_n(&memoria->listo, __ATOMIC_ACQUIRE); i++) {
+        memoria_esperar(&memoria->listo, 0);
+    }
+    return __atomic_load_n(&memoria->listo, __ATOMIC_ACQUIRE) ? 0 : -1;
+}
+
+// Función para sacar la siguiente respuesta del anillo. Devuelve -1 cuando
+// el receptor cerró la sesión y ya no queda nada.
+static int leer_de_memoria(lector_t *lector, respuesta_t *resp) {
+    anillo_bytes_t *anillo = &memoria->respuestas;
+    for (;;) {
+        int r = lector_siguiente_respuesta(lector, FORMATO_BINARIO, resp);
+        if (r != 0) {
+            return r == 1 ? 0 : -1;
+        }
+        size_t espacio;
+        uint8_t *destino = lector_espacio(lector, &espacio);
+        int cerrado = __atomic_load_n(&anillo->cerrado, __ATOMIC_ACQUIRE);
+        size_t n = memoria_leer(anillo, destino, espacio);
+        if (n > 0) {
+            lector_agregar(lector, n);
+        } else if (cerrado) {
+            return -1;
+        } else {
+            memoria_esperar_datos(anillo);
+        }
+    }
+}
+
+// Función para abrir la sesión del cliente (como abrir_sesion del solicitante)
+static int abrir_sesion(void) {
+    char pipe_respuesta[MAX_STRING];
+    snprintf(pipe_respuesta, sizeof(pipe_respuesta), FORMATO_PIPE_RESPUESTA, getpid());
+    if (mkfifo(pipe_respuesta, 0666) == -1 && errno != EEXIST) {
+        perror("Error creando pipe de respuesta");
+        return -1;
+    }
+    resp_fd = open(pipe_respuesta, O_RDONLY | O_NONBLOCK);
+    if (resp_fd == -1) {
+        unlink(pipe_respuesta);
+        return -1;
+    }
+
+    solicitud_t sol = {0};
+    sol.operacion = OP_CONECTAR;
+    strcpy(sol.nombre_libro, "Conectar");
+    struct pollfd pfd = { .fd = resp_fd, .events = POLLIN };
+    if (enviar(&sol) != 0 || poll(&pfd, 1, SEGUNDOS_ESPERA_RECEPTOR * 1000) <= 0) {
+        unlink(pipe_respuesta);
+        return -1;
+    }
+    unlink(pipe_respuesta);
+    fcntl(resp_fd, F_SETFL, fcntl(resp_fd, F_GETFL) & ~O_NONBLOCK);
+
+    respuesta_t resp = {0};
+    if (protocolo_leer_respuesta(resp_fd, FORMATO_BINARIO, &resp) != 0 ||
+        resp.codigo != RES_SESION_ESTABLECIDA) {
+        return -1;
+    }
+    return 0;
+}
+
+// Hilo que recibe las respuestas del cliente hasta que el receptor cierra la sesión
+static void *hilo_respuestas(void *arg) {
+    (void)arg;
+    respuesta_t resp = {0};
+    static lector_t lector;
+    lector_init(&lector);
+
+    while ((usar_memoria ? leer_de_memoria(&lector, &resp)
+                         : lector_leer_respuesta(&lector, resp_fd, FORMATO_BINARIO, &resp)) == 0) {
+        uint64_t llegada = ahora_ns();
+        unsigned casilla = resp.id_solicitud % MAX_EN_VUELO_BENCH;
+        pendiente_t *p = &pendientes[casilla];
+        if (casilla >= (unsigned)en_vuelo || p->id != resp.id_solicitud) {
+            continue;
+        }
+
+        // Solo cuentan las solicitudes enviadas dentro del período medido
+        if (resp.codigo == RES_OCUPADO) {
+            // Como el solicitante: el cliente se retira un tiempo creciente
+            uint64_t espera = espera_reintento_us(rechazos_seguidos++, &semilla_reintentos) * 1000ull;
+            __atomic_store_n(&pausa_hasta, llegada + espera, __ATOMIC_RELAXED);
+            if (p->enviada >= control->inicio_medicion) {
+                resultado->rechazadas++;
+            }
+        } else if (p->enviada >= control->inicio_medicion) {
+            resultado->enviadas[p->op]++;
+            resultado->exitosas[p->op] += resultado_exitoso(resp.codigo);
+            if (resultado->num_muestras < muestras_por_cliente) {
+                uint64_t ns = llegada - p->enviada;
+                muestra_t *m = &mis_muestras[resultado->num_muestras++];
+                m->ns = ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+                m->op = p->op;
+            } else {
+                resultado->perdidas++;
+            }
+        }
+        if (resp.codigo != RES_OCUPADO) {
+            rechazos_seguidos = 0;
+        }
+
+        pthread_mutex_lock(&mutex_pendientes);
+        p->id = 0;
+        libres[num_libres++] = casilla;
+        pthread_cond_signal(&cond_pendientes);
+        pthread_mutex_unlock(&mutex_pendientes);
+    }
+    return NULL;
+}
+
+// Función que ejecuta cada proceso cliente: el hilo principal envía mientras
+// haya casillas libres y el de respuestas las libera
+static void ejecutar_cliente(int c) {
+    resultado = &control->clientes[c];
+    mis_muestras = muestras + c * muestras_por_cliente;
+    estado_rng = 0x9E3779B97F4A7C15ull * (c + 1);
+    semilla_reintentos = (unsigned)getpid();
+
+    if (usar_socket ? conectar_socket() != 0 || (usar_memoria && compartir_memoria() != 0)
+                    : ((pipe_fd = open(pipe_receptor, O_WRONLY)) == -1 || abrir_sesion() != 0)) {
+        resultado->error = 1;
+        exit(1);
+    }
+    for (int i = 0; i < en_vuelo; i++) {
+        libres[num_libres++] = i;
+    }
+    pthread_t hilo;
+    pthread_create(&hilo, NULL, hilo_respuestas, NULL);
+
+    unsigned secuencia = 0;
+    while (!__atomic_load_n(&control->detener, __ATOMIC_RELAXED)) {
+        uint64_t pausa = __atomic_load_n(&pausa_hasta, __ATOMIC_RELAXED);
+        uint64_t ahora = ahora_ns();
+        if (pausa > ahora) {
+            usleep((useconds_t)((pausa - ahora) / 1000));
+            continue;
+        }
+
+        // Por el pipe, una trama por write (atómica); por el socket, todas
+        // las casillas libres en un solo writev (o seguidas en el anillo)
+        int casillas[MAX_EN_VUELO_BENCH];
+        int tomadas = 0;
+        pthread_mutex_lock(&mutex_pendientes);
+        while (num_libres == 0) {
+            pthread_cond_wait(&cond_pendientes, &mutex_pendientes);
+        }
+        do {
+            casillas[tomadas++] = libres[--num_libres];
+        } while (usar_socket && num_libres > 0);
+        pthread_mutex_unlock(&mutex_pendientes);
+
+        struct iovec iov[MAX_EN_VUELO_BENCH];
+        for (int k = 0; k < tomadas; k++) {
+            int casilla = casillas[k];
+            solicitud_t sol = {0};
+            int op = elegir_operacion();
+            sol.operacion = OPERACIONES[op];
+            sol.isbn = elegir_isbn();
+            sol.pid_solicitante = getpid();
+            sol.sesion = -1;
+            strcpy(sol.nombre_libro, "Bench");
+            sol.id_solicitud = (++secuencia * MAX_EN_VUELO_BENCH) + casilla;
+
+            pendientes[casilla].op = op;
+            pendientes[casilla].id = sol.id_solicitud;
+            pendientes[casilla].enviada = ahora_ns();
+            iov[k].iov_base = tramas[k];
+            iov[k].iov_len = protocolo_codificar_solicitud(&sol, FORMATO_BINARIO, tramas[k]);
+        }
+        if ((usar_memoria ? escribir_en_memoria(iov, tomadas) : enviar_tramas(iov, tomadas)) != 0) {
+            resultado->error = 1;
+            break;
+        }
+    }
+
+    // Esperar las respuestas que faltan antes de cerrar la sesión
+    pthread_mutex_lock(&mutex_pendientes);
+    while (num_libres < en_vuelo && !resultado->error) {
+        pthread_cond_wait(&cond_pendientes, &mutex_pendientes);
+    }
+    pthread_mutex_unlock(&mutex_pendientes);
+
+    solicitud_t salir = {0};
+    salir.operacion = OP_SALIR;
+    strcpy(salir.nombre_libro, "Salir");
+    enviar(&salir);
+    pthread_join(hilo, NULL);
+    exit(0);
+}
+
+// Función para arrancar el receptor con su entrada en un pipe (por el que
+// después se le manda 's') y su salida descartada
+static pid_t arrancar_receptor(int *consola) {
+    char *args[MAX_ARGS_RECEPTOR + 8];
+    int n = 0;
+    args[n++] = "./receptor";
+    args[n++] = "-p";
+    args[n++] = pipe_receptor;
+    args[n++] = "-f";
+    args[n++] = ARCHIVO_BENCH;
+    if (usar_socket) {
+        args[n++] = "-u";
+        args[n++] = ruta_socket;
+    }
+    for (char *tok = strtok(opciones_receptor, " "); tok && n < MAX_ARGS_RECEPTOR + 5;
+         tok = strtok(NULL, " ")) {
+        args[n++] = tok;
+    }
+    args[n] = NULL;
+
+    int tubo[2];
+    if (pipe(tubo) != 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        int nulo = open("/dev/null", O_WRONLY);
+        dup2(tubo[0], STDIN_FILENO);
+        dup2(nulo, STDOUT_FILENO);
+        close(tubo[0]);
+        close(tubo[1]);
+        execv(args[0], args);
+        perror("Error ejecutando ./receptor");
+        exit(1);
+    }
+    close(tubo[0]);
+    *consola = tubo[1];
+    return pid;
+}
+
+// Función para esperar un proceso con límite de tiempo (si no termina, se mata)
+static void esperar_proceso(pid_t pid, int segundos_limite) {
+    for (int i = 0; i < segundos_limite * 100; i++) {
+        if (waitpid(pid, NULL, WNOHANG) == pid) {
+            return;
+        }
+        usleep(10000);
+    }
+    fprintf(stderr, "El proceso %d no terminó a tiempo\n", pid);
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
+static int comparar_muestras(const void *a, const void *b) {
+    uint32_t x = ((const muestra_t *)a)->ns, y = ((const muestra_t *)b)->ns;
+    return (x > y) - (x < y);
+}
+
+static void imprimir_fila(const char *nombre, uint32_t *ns, long n, uint64_t enviadas,
+                          uint64_t exitosas) {
+    if (n == 0) {
+        printf("%-10s %10llu %12.0f %9s %9s %9s %9s %9s\n", nombre,
+               (unsigned long long)enviadas, enviadas / segundos, "-", "-", "-", "-", "-");
+        return;
+    }
+    printf("%-10s %10llu %12.0f %8.1f%% %9.1f %9.1f %9.1f %9.1f\n", nombre,
+           (unsigned long long)enviadas, enviadas / segundos,
+           enviadas ? 100.0 * exitosas / enviadas : 0.0,
+           ns[n / 2] / 1e3, ns[(long)(n * 0.99)] / 1e3, ns[(long)(n * 0.999)] / 1e3,
+           ns[n - 1] / 1e3);
+}
+
+// Función para juntar las muestras de todos los clientes y mostrar la tabla
+static void informar(void) {
+    long total = 0, perdidas = 0;
+    uint64_t rechazadas = 0;
+    uint64_t enviadas[NUM_OPS_BENCH] = {0}, exitosas[NUM_OPS_BENCH] = {0};
+    for (int c = 0; c < num_clientes; c++) {
+        total += control->clientes[c].num_muestras;
+        perdidas += control->clientes[c].perdidas;
+        rechazadas += control->clientes[c].rechazadas;
+        for (int op = 0; op < NUM_OPS_BENCH; op++) {
+            enviadas[op] += control->clientes[c].enviadas[op];
+            exitosas[op] += control->clientes[c].exitosas[op];
+        }
+    }
+
+    muestra_t *todas = malloc((total > 0 ? total : 1) * sizeof(muestra_t));
+    uint32_t *ns = malloc((total > 0 ? total : 1) * sizeof(uint32_t));
+    if (!todas || !ns) {
+        fprintf(stderr, "Sin memoria para las muestras\n");
+        return;
+    }
+    long n = 0;
+    for (int c = 0; c < num_clientes; c++) {
+        memcpy(todas + n, muestras + c * muestras_por_cliente,
+               control->clientes[c].num_muestras * sizeof(muestra_t));
+        n += control->clientes[c].num_muestras;
+    }
+    qsort(todas, total, sizeof(muestra_t), comparar_muestras);
+
+    printf("%-10s %10s %12s %9s %9s %9s %9s %9s\n", "operación", "cantidad", "op/s",
+           "exitosas", "P50 us", "P99 us", "P99.9 us", "max us");
+    uint64_t total_enviadas = 0, total_exitosas = 0;
+    for (int op = 0; op < NUM_OPS_BENCH; op++) {
+        long k = 0;
+        for (long i = 0; i < total; i++) {
+            if (todas[i].op == (uint32_t)op) {
+                ns[k++] = todas[i].ns;
+            }
+        }
+        imprimir_fila(NOMBRES_OPS[op], ns, k, enviadas[op], exitosas[op]);
+        total_enviadas += enviadas[op];
+        total_exitosas += exitosas[op];
+    }
+    for (long i = 0; i < total; i++) {
+        ns[i] = todas[i].ns;
+    }
+    imprimir_fila("total", ns, total, total_enviadas, total_exitosas);
+    if (perdidas > 0) {
+        printf("(%ld respuestas no cupieron en el arreglo de muestras; cuentan solo en cantidad)\n",
+               perdidas);
+    }
+    if (rechazadas > 0) {
+        printf("(%llu solicitudes rechazadas por receptor ocupado, %.0f/s; no cuentan en la tabla)\n",
+               (unsigned long long)rechazadas, rechazadas / segundos);
+    }
+    free(todas);
+    free(ns);
+}
+
+static int leer_mezcla(const char *texto) {
+    if (sscanf(texto, "%d:%d:%d", &mezcla[0], &mezcla[1], &mezcla[2]) != 3 ||
+        mezcla[0] < 0 || mezcla[1] < 0 || mezcla[2] < 0 ||
+        mezcla[0] + mezcla[1] + mezcla[2] != 100) {
+        printf("Error: -m espera porcentajes P:R:D que sumen 100 (p. ej. 50:25:25)\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printf("Falta el valor de %s\n", argv[i]);
+            exit(1);
+        }
+        if (strcmp(argv[i], "-c") == 0) {
+            num_clientes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0) {
+            en_vuelo = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            segundos = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0) {
+            calentamiento = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            libros = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-e") == 0) {
+            ejemplares = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-m") == 0) {
+            if (leer_mezcla(argv[++i]) != 0) {
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "-z") == 0) {
+            theta = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0) {
+            i++;
+            usar_memoria = (strcmp(argv[i], "memoria") == 0);
+            usar_socket = usar_memoria || (strcmp(argv[i], "socket") == 0);
+        } else if (strcmp(argv[i], "-a") == 0) {
+            snprintf(opciones_receptor, sizeof(opciones_receptor), "%s", argv[++i]);
+        } else {
+            printf("Opción desconocida: %s\n", argv[i]);
+            exit(1);
+        }
+    }
+    if (num_clientes < 1 || num_clientes > MAX_CLIENTES || en_vuelo < 1 ||
+        en_vuelo > MAX_EN_VUELO_BENCH || segundos <= 0 || calentamiento < 0 ||
+        libros < 1 || ejemplares < 1) {
+        printf("Error: se espera 1 <= -c <= %d, 1 <= -n <= %d, -s > 0, -w >= 0, -l y -e positivos\n",
+               MAX_CLIENTES, MAX_EN_VUELO_BENCH);
+        exit(1);
+    }
+
+    // Memoria compartida con los clientes (se reserva a medida que se usa)
+    muestras_por_cliente = MAX_MUESTRAS_TOTAL / num_clientes;
+    control = mmap(NULL, sizeof(control_t), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    muestras = mmap(NULL, (size_t)MAX_MUESTRAS_TOTAL * sizeof(muestra_t), PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    // En el catálogo la mitad de los ejemplares empieza prestada
+    if (control == MAP_FAILED || muestras == MAP_FAILED || preparar_zipf() != 0 ||
+        generar_catalogo(ARCHIVO_BENCH, libros, ejemplares, 2) != 0) {
+        fprintf(stderr, "Error preparando el benchmark\n");
+        exit(1);
+    }
+    memset(control, 0, sizeof(control_t));
+    snprintf(pipe_receptor, sizeof(pipe_receptor), "/tmp/bench_receptor_%d", getpid());
+    snprintf(ruta_socket, sizeof(ruta_socket), "/tmp/bench_receptor_%d.sock", getpid());
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Receptor con %d libros x %d ejemplares; %d clientes con %d en vuelo; "
+           "mezcla P/R/D %d/%d/%d; %s; ISBN %s",
+           libros, ejemplares, num_clientes, en_vuelo, mezcla[0], mezcla[1], mezcla[2],
+           usar_memoria ? "memoria compartida" : usar_socket ? "socket" : "pipe",
+           theta > 0 ? "Zipf" : "uniformes");
+    if (theta > 0) {
+        printf(" (theta %.2f)", theta);
+    }
+    printf("\n");
+    fflush(stdout); // los hijos no deben repetir lo que quedó en el buffer
+
+    int consola;
+    pid_t receptor = arrancar_receptor(&consola);
+    if (receptor < 0) {
+        exit(1);
+    }
+
+    // El receptor crea el pipe después de cargar el catálogo. Este proceso lo
+    // mantiene abierto para escribir, así el receptor no ve fin de archivo
+    // entre que se va un cliente y llega la 's'.
+    struct stat st;
+    int propio_fd = -1;
+    for (int i = 0; i < SEGUNDOS_ESPERA_RECEPTOR * 100 &&
+                    (stat(pipe_receptor, &st) != 0 || (usar_socket && stat(ruta_socket, &st) != 0)); i++) {
+        if (waitpid(receptor, NULL, WNOHANG) == receptor) {
+            fprintf(stderr, "El receptor terminó antes de crear el pipe\n");
+            exit(1);
+        }
+        usleep(10000);
+    }
+    if ((propio_fd = open(pipe_receptor, O_WRONLY)) == -1) {
+        perror("Error abriendo el pipe del receptor");
+        kill(receptor, SIGKILL);
+        exit(1);
+    }
+
+    uint64_t arranque = ahora_ns();
+    control->inicio_medicion = arranque + (uint64_t)(calentamiento * 1e9);
+    pid_t clientes[MAX_CLIENTES];
+    for (int c = 0; c < num_clientes; c++) {
+        if ((clientes[c] = fork()) == 0) {
+            ejecutar_cliente(c);
+        }
+    }
+
+    usleep((useconds_t)((calentamiento + segundos) * 1e6));
+    __atomic_store_n(&control->detener, 1, __ATOMIC_RELAXED);
+    for (int c = 0; c < num_clientes; c++) {
+        esperar_proceso(clientes[c], SEGUNDOS_ESPERA_CLIENTES);
+    }
+
+    if (write(consola, "s\n", 2) != 2) {
+        perror("Error enviando 's' al receptor");
+    }
+    close(consola);
+    close(propio_fd);
+    esperar_proceso(receptor, SEGUNDOS_ESPERA_CLIENTES);
+
+    int errores = 0;
+    for (int c = 0; c < num_clientes; c++) {
+        errores += control->clientes[c].error;
+    }
+    if (errores > 0) {
+        printf("%d clientes no pudieron completar la prueba\n", errores);
+    }
+    printf("\n");
+    informar();
+
+    unlink(ARCHIVO_BENCH);
+    return 0;
+}
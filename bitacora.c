@@ -0,0 +1,195 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: bitacora.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Bitácora de operaciones (ver bitacora.h). Cada hilo es el único
+ *              que escribe en sus bloques: llena las entradas y después publica
+ *              la cantidad con un store de liberación; un bloque solo se enlaza
+ *              al siguiente cuando está lleno. Quien lee toma la cantidad con
+ *              un load de adquisición y nunca ve entradas a medio escribir.
+ *              Mientras agrega, el hilo deja impar su contador en_curso; así el
+ *              corte de un reporte sabe a quién esperar.
+ * =============================================================================
+ */
+
+#include <sched.h>
+
+#include "bitacora.h"
+
+typedef struct bitacora_hilo {
+    bloque_bitacora_t *primero;
+    bloque_bitacora_t *ultimo;
+    unsigned en_curso;          // impar mientras agrega entradas
+    struct bitacora_hilo *siguiente;
+} bitacora_hilo_t;
+
+// Posición de lectura dentro de la bitácora de un hilo
+typedef struct {
+    bloque_bitacora_t *bloque;
+    int pos;
+} cursor_bitacora_t;
+
+static bitacora_hilo_t *hilos_bitacora = NULL;  // lista de todas las bitácoras
+static uint64_t proxima_secuencia = 0;
+static __thread bitacora_hilo_t *bitacora_propia = NULL;
+
+static bloque_bitacora_t *nuevo_bloque(void) {
+    bloque_bitacora_t *bloque = malloc(sizeof(bloque_bitacora_t));
+    if (bloque) {
+        bloque->siguiente = NULL;
+        bloque->usadas = 0;
+    }
+    return bloque;
+}
+
+// Función para crear la bitácora del hilo que llama y anotarla en la lista
+static bitacora_hilo_t *registrar_hilo(void) {
+    bitacora_hilo_t *hilo = malloc(sizeof(bitacora_hilo_t));
+    if (!hilo) {
+        return NULL;
+    }
+    hilo->en_curso = 0;
+    hilo->primero = hilo->ultimo = nuevo_bloque();
+    if (!hilo->primero) {
+        free(hilo);
+        return NULL;
+    }
+
+    hilo->siguiente = __atomic_load_n(&hilos_bitacora, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&hilos_bitacora, &hilo->siguiente, hilo, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    return hilo;
+}
+
+void bitacora_agregar(const reporte_entry_t *entradas, int n) {
+    if (n <= 0) {
+        return;
+    }
+    if (!bitacora_propia && !(bitacora_propia = registrar_hilo())) {
+        return;
+    }
+
+    // en_curso se marca antes de tomar los números: quien tome un corte que
+    // incluya alguno de ellos lo verá impar y esperará a que se publiquen
+    unsigned en_curso = bitacora_propia->en_curso;
+    __atomic_store_n(&bitacora_propia->en_curso, en_curso + 1, __ATOMIC_SEQ_CST);
+    uint64_t secuencia = __atomic_fetch_add(&proxima_secuencia, n, __ATOMIC_SEQ_CST);
+    bloque_bitacora_t *bloque = bitacora_propia->ultimo;
+
+    for (int i = 0; i < n; i++) {
+        if (bloque->usadas == ENTRADAS_POR_BLOQUE) {
+            bloque_bitacora_t *nuevo = nuevo_bloque();
+            if (!nuevo) {
+                break;
+            }
+            __atomic_store_n(&bloque->siguiente, nuevo, __ATOMIC_RELEASE);
+            bitacora_propia->ultimo = bloque = nuevo;
+        }
+        int pos = bloque->usadas;
+        bloque->secuencia[pos] = secuencia + i;
+        bloque->entradas[pos] = entradas[i];
+        __atomic_store_n(&bloque->usadas, pos + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&bitacora_propia->en_curso, en_curso + 2, __ATOMIC_RELEASE);
+}
+
+uint64_t bitacora_corte(void) {
+    uint64_t corte = __atomic_load_n(&proxima_secuencia, __ATOMIC_SEQ_CST);
+
+    // Un hilo que está agregando puede tener números anteriores al corte sin
+    // publicar; basta con que termine esa escritura (la siguiente ya tomará
+    // números posteriores al corte)
+    for (bitacora_hilo_t *h = __atomic_load_n(&hilos_bitacora, __ATOMIC_ACQUIRE); h;
+         h = h->siguiente) {
+        unsigned en_curso = __atomic_load_n(&h->en_curso, __ATOMIC_SEQ_CST);
+        if (en_curso & 1) {
+            while (__atomic_load_n(&h->en_curso, __ATOMIC_ACQUIRE) == en_curso) {
+                sched_yield();
+            }
+        }
+    }
+    return corte;
+}
+
+// Función para dejar el cursor en la próxima entrada publicada; devuelve 0
+// si por ahora no hay más
+static int cursor_valido(cursor_bitacora_t *c) {
+    while (c->bloque) {
+        if (c->pos < __atomic_load_n(&c->bloque->usadas, __ATOMIC_ACQUIRE)) {
+            return 1;
+        }
+        if (c->pos < ENTRADAS_POR_BLOQUE) {
+            return 0;  // el bloque no está lleno: no hay siguiente todavía
+        }
+        c->bloque = __atomic_load_n(&c->bloque->siguiente, __ATOMIC_ACQUIRE);
+        c->pos = 0;
+    }
+    return 0;
+}
+
+void bitacora_recorrer(uint64_t corte,
+                       void (*visitar)(const reporte_entry_t *entrada, void *ctx), void *ctx) {
+    int num_hilos = 0;
+    bitacora_hilo_t *cabeza = __atomic_load_n(&hilos_bitacora, __ATOMIC_ACQUIRE);
+    for (bitacora_hilo_t *h = cabeza; h; h = h->siguiente) {
+        num_hilos++;
+    }
+    if (num_hilos == 0) {
+        return;
+    }
+
+    cursor_bitacora_t *cursores = malloc(num_hilos * sizeof(cursor_bitacora_t));
+    if (!cursores) {
+        return;
+    }
+    int k = 0;
+    for (bitacora_hilo_t *h = cabeza; h; h = h->siguiente, k++) {
+        cursores[k].bloque = h->primero;
+        cursores[k].pos = 0;
+    }
+
+    // Mezcla de las listas de cada hilo; son pocas, basta con buscar el menor
+    for (;;) {
+        int menor = -1;
+        uint64_t secuencia_menor = 0;
+        for (int i = 0; i < num_hilos; i++) {
+            if (!cursor_valido(&cursores[i])) {
+                continue;
+            }
+            uint64_t s = cursores[i].bloque->secuencia[cursores[i].pos];
+            if (s >= corte) {
+                continue;  // lo que sigue en este hilo es posterior al corte
+            }
+            if (menor == -1 || s < secuencia_menor) {
+                menor = i;
+                secuencia_menor = s;
+            }
+        }
+        if (menor == -1) {
+            break;
+        }
+        visitar(&cursores[menor].bloque->entradas[cursores[menor].pos], ctx);
+        cursores[menor].pos++;
+    }
+
+    free(cursores);
+}
+
+void bitacora_liberar(void) {
+    bitacora_hilo_t *h = hilos_bitacora;
+    while (h) {
+        bloque_bitacora_t *b = h->primero;
+        while (b) {
+            bloque_bitacora_t *sig = b->siguiente;
+            free(b);
+            b = sig;
+        }
+        bitacora_hilo_t *sig_hilo = h->siguiente;
+        free(h);
+        h = sig_hilo;
+    }
+    hilos_bitacora = NULL;
+}
@@ -0,0 +1,48 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: bitacora.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Bitácora de operaciones para el reporte (reemplaza al arreglo
+ *              reportes[1000]). Cada hilo agrega en su propia lista de bloques,
+ *              sin mutex y sin límite de entradas; un contador global atómico
+ *              numera las entradas para que el reporte las mezcle en el mismo
+ *              orden en que se aplicaron. Un reporte se hace sobre un corte de
+ *              esa numeración: incluye exactamente las entradas anteriores al
+ *              corte aunque otros hilos sigan agregando mientras se recorre.
+ * =============================================================================
+ */
+
+#ifndef BITACORA_H
+#define BITACORA_H
+
+#include <stdint.h>
+
+#include "estructuras.h"
+
+#define ENTRADAS_POR_BLOQUE 1024
+
+typedef struct bloque_bitacora {
+    struct bloque_bitacora *siguiente;
+    int usadas;                 // se publica después de escribir las entradas
+    uint64_t secuencia[ENTRADAS_POR_BLOQUE];
+    reporte_entry_t entradas[ENTRADAS_POR_BLOQUE];
+} bloque_bitacora_t;
+
+// Agrega n entradas numeradas de forma consecutiva. Se llama con la franja
+// de los libros bloqueada, así el orden coincide con el de los cambios.
+void bitacora_agregar(const reporte_entry_t *entradas, int n);
+
+// Toma el corte para un reporte: espera a que terminen de publicarse las
+// entradas que ya tenían número (es una espera de pocas instrucciones)
+uint64_t bitacora_corte(void);
+
+// Recorre en orden de secuencia las entradas anteriores al corte
+void bitacora_recorrer(uint64_t corte,
+                       void (*visitar)(const reporte_entry_t *entrada, void *ctx), void *ctx);
+
+// Libera todos los bloques (sin hilos agregando)
+void bitacora_liberar(void);
+
+#endif // BITACORA_H
@@ -0,0 +1,349 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: busqueda.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Índice invertido de títulos (ver busqueda.h). Las palabras se
+ *              guardan en una tabla hash con direccionamiento abierto y sus
+ *              listas de libros en una arena. La construcción hace dos pasadas
+ *              como la carga del catálogo: la primera cuenta los libros de cada
+ *              palabra y la segunda llena listas reservadas de una sola vez.
+ *              Una búsqueda recorre la lista más corta y busca cada candidato
+ *              en las demás avanzando a saltos, así el costo depende de la
+ *              palabra menos frecuente y no del tamaño del catálogo.
+ * =============================================================================
+ */
+
+#include "busqueda.h"
+#include "catalogo.h"
+
+typedef struct {
+    const char *texto;      // en la arena, sin '\0'
+    uint32_t hash;
+    int largo;
+    int num;                // libros en la lista
+    int capacidad;
+    int ultimo;             // último libro contado en la primera pasada
+    int *libros;            // posiciones en biblioteca, en orden creciente
+} termino_t;
+
+static termino_t *terminos = NULL;      // tabla hash; texto NULL = casilla libre
+static size_t capacidad_terminos = 0;   // potencia de dos
+static size_t num_terminos = 0;
+static arena_t arena_busqueda;
+static pthread_rwlock_t bloqueo_busqueda = PTHREAD_RWLOCK_INITIALIZER;
+
+// Letra sin tilde para el segundo byte de los caracteres UTF-8 U+00C0..U+00FF
+// ('?' se conserva tal cual, ' ' separa palabras como × y ÷)
+static const char SIN_TILDE[64 + 1] =
+    "aaaaaa?ceeeeiiii?nooooo ouuuuy??"
+    "aaaaaa?ceeeeiiii?nooooo ouuuuy?y";
+
+// Función para leer la próxima palabra de *texto en minúsculas y sin tildes.
+// Devuelve su largo (a lo sumo MAX_STRING - 1) o 0 si no quedan palabras.
+static int siguiente_termino(const char **texto, char *termino) {
+    const unsigned char *c = (const unsigned char *)*texto;
+    int largo = 0;
+
+    while (*c) {
+        char letra[2];
+        int n = 0, avance = 1;
+
+        if ((*c >= 'a' && *c <= 'z') || (*c >= '0' && *c <= '9')) {
+            letra[n++] = (char)*c;
+        } else if (*c >= 'A' && *c <= 'Z') {
+            letra[n++] = (char)(*c + ('a' - 'A'));
+        } else if (*c == 0xC3 && c[1] >= 0x80 && c[1] <= 0xBF) {
+            char sin_tilde = SIN_TILDE[c[1] - 0x80];
+            avance = 2;
+            if (sin_tilde == '?') {
+                letra[n++] = (char)c[0];
+                letra[n++] = (char)c[1];
+            } else if (sin_tilde != ' ') {
+                letra[n++] = sin_tilde;
+            }
+        } else if (*c >= 0x80) {
+            letra[n++] = (char)*c;  // otros caracteres UTF-8 forman parte de la palabra
+        }
+        c += avance;
+
+        if (n == 0) {
+            if (largo > 0) {
+                break;
+            }
+            continue;
+        }
+        for (int i = 0; i < n && largo < MAX_STRING - 1; i++) {
+            termino[largo++] = letra[i];
+        }
+    }
+    *texto = (const char *)c;
+    return largo;
+}
+
+// Hash FNV-1a de una palabra
+static uint32_t hash_termino(const char *texto, int largo) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < largo; i++) {
+        h = (h ^ (unsigned char)texto[i]) * 16777619u;
+    }
+    return h;
+}
+
+static termino_t *buscar_termino(const char *texto, int largo, uint32_t hash) {
+    if (!terminos) {
+        return NULL;
+    }
+    size_t mascara = capacidad_terminos - 1;
+    for (size_t i = hash & mascara; terminos[i].texto; i = (i + 1) & mascara) {
+        if (terminos[i].hash == hash && terminos[i].largo == largo &&
+            memcmp(terminos[i].texto, texto, largo) == 0) {
+            return &terminos[i];
+        }
+    }
+    return NULL;
+}
+
+// Función para duplicar la tabla de palabras (las listas no se mueven)
+static int agrandar_tabla(void) {
+    size_t capacidad = capacidad_terminos ? capacidad_terminos * 2 : 1024;
+    termino_t *nueva = calloc(capacidad, sizeof(termino_t));
+    if (!nueva) {
+        return -1;
+    }
+    for (size_t i = 0; i < capacidad_terminos; i++) {
+        if (terminos[i].texto) {
+            size_t j = terminos[i].hash & (capacidad - 1);
+            while (nueva[j].texto) {
+                j = (j + 1) & (capacidad - 1);
+            }
+            nueva[j] = terminos[i];
+        }
+    }
+    free(terminos);
+    terminos = nueva;
+    capacidad_terminos = capacidad;
+    return 0;
+}
+
+// Función para obtener la entrada de una palabra, creándola si no existe
+static termino_t *insertar_termino(const char *texto, int largo) {
+    uint32_t hash = hash_termino(texto, largo);
+    termino_t *t = buscar_termino(texto, largo, hash);
+    if (t) {
+        return t;
+    }
+
+    // Factor de carga máximo 1/2
+    if ((num_terminos + 1) * 2 > capacidad_terminos && agrandar_tabla() != 0) {
+        return NULL;
+    }
+    char *copia = arena_reservar(&arena_busqueda, largo);
+    if (!copia) {
+        return NULL;
+    }
+    memcpy(copia, texto, largo);
+
+    size_t mascara = capacidad_terminos - 1;
+    size_t i = hash & mascara;
+    while (terminos[i].texto) {
+        i = (i + 1) & mascara;
+    }
+    t = &terminos[i];
+    memset(t, 0, sizeof(*t));
+    t->texto = copia;
+    t->hash = hash;
+    t->largo = largo;
+    t->ultimo = -1;
+    num_terminos++;
+    return t;
+}
+
+// Un libro entra al índice solo si es el que resuelve su ISBN (los duplicados
+// que la carga ignora tampoco aparecen en las búsquedas)
+static int indexable(int libro_idx) {
+    return encontrar_libro(biblioteca[libro_idx].isbn) == libro_idx;
+}
+
+int busqueda_iniciar(void) {
+    char termino[MAX_STRING];
+    int largo;
+
+    pthread_rwlock_wrlock(&bloqueo_busqueda);
+
+    // Pasada 1: crear las palabras y contar sus libros
+    for (int i = 0; i < num_libros; i++) {
+        if (!indexable(i)) {
+            continue;
+        }
+        const char *texto = biblioteca[i].nombre;
+        while ((largo = siguiente_termino(&texto, termino)) > 0) {
+            termino_t *t = insertar_termino(termino, largo);
+            if (!t) {
+                pthread_rwlock_unlock(&bloqueo_busqueda);
+                return -1;
+            }
+            if (t->ultimo != i) {
+                t->ultimo = i;
+                t->capacidad++;
+            }
+        }
+    }
+
+    // Una sola reserva para todas las listas
+    size_t total = 0;
+    for (size_t i = 0; i < capacidad_terminos; i++) {
+        total += terminos[i].capacidad;
+    }
+    int *listas = arena_reservar(&arena_busqueda, total > 0 ? total * sizeof(int) : 1);
+    if (!listas) {
+        pthread_rwlock_unlock(&bloqueo_busqueda);
+        return -1;
+    }
+    for (size_t i = 0; i < capacidad_terminos; i++) {
+        terminos[i].libros = listas;
+        listas += terminos[i].capacidad;
+    }
+
+    // Pasada 2: llenar (en orden de catálogo, así cada lista queda ordenada)
+    for (int i = 0; i < num_libros; i++) {
+        if (!indexable(i)) {
+            continue;
+        }
+        const char *texto = biblioteca[i].nombre;
+        while ((largo = siguiente_termino(&texto, termino)) > 0) {
+            termino_t *t = buscar_termino(termino, largo, hash_termino(termino, largo));
+            if (t->num == 0 || t->libros[t->num - 1] != i) {
+                t->libros[t->num++] = i;
+            }
+        }
+    }
+
+    pthread_rwlock_unlock(&bloqueo_busqueda);
+    return 0;
+}
+
+void busqueda_liberar(void) {
+    pthread_rwlock_wrlock(&bloqueo_busqueda);
+    free(terminos);
+    terminos = NULL;
+    capacidad_terminos = 0;
+    num_terminos = 0;
+    arena_liberar(&arena_busqueda);
+    pthread_rwlock_unlock(&bloqueo_busqueda);
+}
+
+int busqueda_agregar(int libro_idx) {
+    char termino[MAX_STRING];
+    const char *texto = biblioteca[libro_idx].nombre;
+    int largo, resultado = 0;
+
+    // Igual que al construir: un ISBN duplicado no entra
+    if (!indexable(libro_idx)) {
+        return 0;
+    }
+
+    pthread_rwlock_wrlock(&bloqueo_busqueda);
+    while ((largo = siguiente_termino(&texto, termino)) > 0) {
+        termino_t *t = insertar_termino(termino, largo);
+        if (!t) {
+            resultado = -1;
+            break;
+        }
+        if (t->num > 0 && t->libros[t->num - 1] == libro_idx) {
+            continue;
+        }
+        // Lista llena: se copia a una el doble de grande (la vieja queda en la arena)
+        if (t->num == t->capacidad) {
+            int capacidad = t->capacidad ? t->capacidad * 2 : 4;
+            int *libros = arena_reservar(&arena_busqueda, capacidad * sizeof(int));
+            if (!libros) {
+                resultado = -1;
+                break;
+            }
+            memcpy(libros, t->libros, t->num * sizeof(int));
+            t->libros = libros;
+            t->capacidad = capacidad;
+        }
+        t->libros[t->num++] = libro_idx;
+    }
+    pthread_rwlock_unlock(&bloqueo_busqueda);
+    return resultado;
+}
+
+// Función para encontrar la primera posición desde 'desde' con libro >= libro:
+// avanza a saltos que se duplican y termina con una búsqueda binaria
+static int primera_posicion(const termino_t *t, int desde, int libro) {
+    int salto = 1, hasta = desde;
+    while (hasta < t->num && t->libros[hasta] < libro) {
+        desde = hasta + 1;
+        hasta += salto;
+        salto *= 2;
+    }
+    if (hasta > t->num) {
+        hasta = t->num;
+    }
+    while (desde < hasta) {
+        int medio = desde + (hasta - desde) / 2;
+        if (t->libros[medio] < libro) {
+            desde = medio + 1;
+        } else {
+            hasta = medio;
+        }
+    }
+    return desde;
+}
+
+int busqueda_buscar(const char *texto, int *libros, int max, int *hay_mas) {
+    const termino_t *listas[MAX_TERMINOS_BUSQUEDA];
+    int cursores[MAX_TERMINOS_BUSQUEDA];
+    char termino[MAX_STRING];
+    int num_listas = 0, largo, encontrados = 0;
+
+    *hay_mas = 0;
+    pthread_rwlock_rdlock(&bloqueo_busqueda);
+
+    while (num_listas < MAX_TERMINOS_BUSQUEDA &&
+           (largo = siguiente_termino(&texto, termino)) > 0) {
+        const termino_t *t = buscar_termino(termino, largo, hash_termino(termino, largo));
+        if (!t || t->num == 0) {
+            pthread_rwlock_unlock(&bloqueo_busqueda);
+            return 0;  // una palabra que ningún título tiene
+        }
+        // Ordenadas de la lista más corta a la más larga
+        int k = num_listas++;
+        while (k > 0 && listas[k - 1]->num > t->num) {
+            listas[k] = listas[k - 1];
+            k--;
+        }
+        listas[k] = t;
+    }
+
+    for (int k = 0; k < num_listas; k++) {
+        cursores[k] = 0;
+    }
+    for (int i = 0; num_listas > 0 && i < listas[0]->num; i++) {
+        int libro = listas[0]->libros[i];
+        int k;
+        for (k = 1; k < num_listas; k++) {
+            cursores[k] = primera_posicion(listas[k], cursores[k], libro);
+            if (cursores[k] == listas[k]->num || listas[k]->libros[cursores[k]] != libro) {
+                break;
+            }
+        }
+        if (k < num_listas && cursores[k] == listas[k]->num) {
+            break;  // una lista se terminó: no puede haber más coincidencias
+        }
+        if (k == num_listas) {
+            if (encontrados == max) {
+                *hay_mas = 1;
+                break;
+            }
+            libros[encontrados++] = libro;
+        }
+    }
+
+    pthread_rwlock_unlock(&bloqueo_busqueda);
+    return encontrados;
+}
@@ -0,0 +1,35 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: busqueda.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Índice invertido de palabras de los títulos del catálogo para
+ *              buscar libros por nombre. Cada palabra (en minúsculas y sin
+ *              tildes) tiene la lista ordenada de los libros que la contienen;
+ *              una búsqueda devuelve los libros que contienen todas las
+ *              palabras del texto, intersecando las listas de menor a mayor.
+ * =============================================================================
+ */
+
+#ifndef BUSQUEDA_H
+#define BUSQUEDA_H
+
+#include "estructuras.h"
+
+#define MAX_TERMINOS_BUSQUEDA 16    // palabras de un texto de búsqueda
+
+// Se llama con el catálogo cargado: arma el índice con todos los títulos
+int busqueda_iniciar(void);
+void busqueda_liberar(void);
+
+// Agrega al índice el título de un libro nuevo (su posición debe ser mayor
+// que la de todos los ya indexados). Puede correr junto con búsquedas.
+int busqueda_agregar(int libro_idx);
+
+// Deja en libros (hasta max, en orden del catálogo) los libros cuyo título
+// contiene todas las palabras de texto y devuelve cuántos son. *hay_mas
+// queda en 1 si hubo más coincidencias que no cupieron.
+int busqueda_buscar(const char *texto, int *libros, int max, int *hay_mas);
+
+#endif // BUSQUEDA_H
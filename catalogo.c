@@ -0,0 +1,875 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: catalogo.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Implementa el catálogo de libros del receptor. Los libros, sus
+ *              nombres y todos los ejemplares viven en una arena; los
+ *              ejemplares de cada libro son un tramo contiguo de un único pool.
+ *              La carga mapea el archivo y lo reparte entre varios hilos en
+ *              tramos que empiezan en un encabezado de libro. Hace dos pasadas:
+ *              la primera cuenta libros, ejemplares y bytes de nombres, y la
+ *              segunda llena la memoria reservada de una sola vez (sin malloc
+ *              por registro). Las líneas se interpretan con un analizador
+ *              propio que informa cada error con su número de línea.
+ *              Cada libro lleva además contadores de disponibles y prestados y
+ *              un mapa de bits de ejemplares libres: elegir el ejemplar de un
+ *              préstamo o de una devolución es buscar el primer bit, no
+ *              recorrer los ejemplares.
+ * =============================================================================
+ */
+
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "catalogo.h"
+#include "instantanea.h"
+#include "metricas.h"
+
+// Variables globales del catálogo
+libro_t *biblioteca = NULL;
+int num_libros = 0;
+ejemplar_t *pool_ejemplares = NULL;
+int num_ejemplares_total = 0;
+indice_t indice_libros;  // ISBN -> posición en biblioteca
+
+static arena_t arena_catalogo;
+static void *mapeo_catalogo = NULL;  // instantánea mapeada (ejemplares y nombres)
+static size_t largo_mapeo = 0;
+
+static franja_bloqueo_t *franjas = NULL;
+static int mascara_franjas = 0;
+
+// Alineación de todas las reservas de la arena
+#define ARENA_ALINEACION 16
+
+static size_t alinear(size_t bytes) {
+    return (bytes + ARENA_ALINEACION - 1) & ~(size_t)(ARENA_ALINEACION - 1);
+}
+
+// Función para reservar memoria de la arena (pide un bloque nuevo si no cabe)
+void *arena_reservar(arena_t *arena, size_t bytes) {
+    bytes = alinear(bytes);
+
+    if (!arena->actual || arena->actual->tam - arena->actual->usado < bytes) {
+        size_t tam = bytes > ARENA_BLOQUE_MINIMO ? bytes : ARENA_BLOQUE_MINIMO;
+        arena_bloque_t *bloque = malloc(alinear(sizeof(arena_bloque_t)) + tam);
+        if (!bloque) {
+            return NULL;
+        }
+        bloque->siguiente = arena->actual;
+        bloque->tam = tam;
+        bloque->usado = 0;
+        arena->actual = bloque;
+        arena->total_reservado += tam;
+    }
+
+    void *ptr = arena->actual->datos + arena->actual->usado;
+    arena->actual->usado += bytes;
+    return ptr;
+}
+
+void arena_liberar(arena_t *arena) {
+    arena_bloque_t *bloque = arena->actual;
+    while (bloque) {
+        arena_bloque_t *siguiente = bloque->siguiente;
+        free(bloque);
+        bloque = siguiente;
+    }
+    arena->actual = NULL;
+    arena->total_reservado = 0;
+}
+
+// Resultado de clasificar una línea del archivo de datos
+typedef enum {
+    LINEA_VACIA,
+    LINEA_EJEMPLAR,
+    LINEA_ENCABEZADO,
+    LINEA_INVALIDA
+} tipo_linea_t;
+
+typedef struct {
+    tipo_linea_t tipo;
+    const char *error;          // LINEA_INVALIDA: motivo
+    // Encabezado
+    const char *nombre;
+    size_t largo_nombre;
+    int isbn;
+    int num_ejemplares;
+    // Ejemplar
+    int numero;
+    char status;
+    int fecha;
+} linea_datos_t;
+
+// Error de carga con su número de línea (se imprimen en orden al final)
+typedef struct {
+    long linea;
+    const char *mensaje;
+} error_carga_t;
+
+// Tramo del archivo que procesa un hilo. Empieza siempre en un encabezado,
+// así cada tramo se interpreta igual que si se leyera el archivo entero.
+typedef struct {
+    const char *inicio;
+    const char *fin;
+    int llenar;                 // 0: contar, 1: llenar la memoria reservada
+    // Resultados de la pasada de conteo
+    long lineas;
+    int libros;
+    long ejemplares;
+    size_t bytes_nombres;
+    // Posiciones asignadas para la pasada de llenado
+    long linea_base;
+    int libro_base;
+    long ejemplar_base;
+    char *nombres;
+    error_carga_t *errores;
+    int num_errores;
+    int capacidad_errores;
+} tramo_carga_t;
+
+#define MAX_ERRORES_MOSTRADOS 50
+#define BYTES_MINIMOS_POR_HILO (1 << 20)
+
+static const char *saltar_espacios(const char *p, const char *fin) {
+    while (p < fin && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
+
+// Función para leer un entero decimal de [p, fin) sin espacios alrededor
+static int leer_entero(const char *p, const char *fin, int *valor) {
+    int negativo = 0;
+    long v = 0;
+
+    if (p < fin && *p == '-') {
+        negativo = 1;
+        p++;
+    }
+    if (p == fin) {
+        return 0;
+    }
+    for (; p < fin; p++) {
+        if (*p < '0' || *p > '9' || v > 100000000000L) {
+            return 0;
+        }
+        v = v * 10 + (*p - '0');
+    }
+    v = negativo ? -v : v;
+    if (v < -2147483647L - 1 || v > 2147483647L) {
+        return 0;
+    }
+    *valor = (int)v;
+    return 1;
+}
+
+// Función para recortar espacios a ambos lados de [*p, *fin)
+static void recortar(const char **p, const char **fin) {
+    *p = saltar_espacios(*p, *fin);
+    while (*fin > *p && ((*fin)[-1] == ' ' || (*fin)[-1] == '\t')) {
+        (*fin)--;
+    }
+}
+
+// Función para clasificar y descomponer una línea [p, fin) sin el '\n'.
+// Ejemplar: "numero, D|P, dd-mm-aaaa". Encabezado: "nombre, ISBN, ejemplares",
+// donde el nombre es todo lo que precede a las dos últimas comas.
+static void clasificar_linea(const char *p, const char *fin, linea_datos_t *ld) {
+    if (fin > p && fin[-1] == '\r') {
+        fin--;
+    }
+    recortar(&p, &fin);
+    if (p == fin) {
+        ld->tipo = LINEA_VACIA;
+        return;
+    }
+
+    const char *coma1 = memchr(p, ',', fin - p);
+    const char *coma2 = coma1 ? memchr(coma1 + 1, ',', fin - coma1 - 1) : NULL;
+
+    // ¿Ejemplar? Primer campo entero y segundo campo de una sola letra
+    if (coma2) {
+        const char *c1 = p, *f1 = coma1;
+        const char *c2 = coma1 + 1, *f2 = coma2;
+        recortar(&c1, &f1);
+        recortar(&c2, &f2);
+        if (f2 - c2 == 1 && ((*c2 >= 'A' && *c2 <= 'Z') || (*c2 >= 'a' && *c2 <= 'z')) &&
+            leer_entero(c1, f1, &ld->numero)) {
+            const char *c3 = coma2 + 1, *f3 = fin;
+            recortar(&c3, &f3);
+            ld->tipo = LINEA_INVALIDA;
+            if (*c2 != STATUS_DISPONIBLE && *c2 != STATUS_PRESTADO) {
+                ld->error = "estado de ejemplar inválido (se espera D o P)";
+            } else if ((ld->fecha = fecha_de_texto(c3, f3 - c3)) == SIN_FECHA) {
+                ld->error = "fecha de ejemplar inválida (se espera dd-mm-aaaa)";
+            } else {
+                ld->tipo = LINEA_EJEMPLAR;
+                ld->status = *c2;
+            }
+            return;
+        }
+    }
+
+    // ¿Encabezado? Las dos últimas comas separan ISBN y número de ejemplares
+    const char *ultima = fin;
+    while (ultima > p && ultima[-1] != ',') {
+        ultima--;
+    }
+    const char *penultima = ultima > p ? ultima - 1 : p;
+    while (penultima > p && penultima[-1] != ',') {
+        penultima--;
+    }
+    ld->tipo = LINEA_INVALIDA;
+    if (ultima == p || penultima == p) {
+        ld->error = "línea no reconocida (se espera 'nombre, ISBN, ejemplares')";
+        return;
+    }
+
+    const char *cn = p, *fn = penultima - 1;
+    const char *ci = penultima, *fi = ultima - 1;
+    const char *ce = ultima, *fe = fin;
+    recortar(&cn, &fn);
+    recortar(&ci, &fi);
+    recortar(&ce, &fe);
+    if (cn == fn) {
+        ld->error = "nombre de libro vacío";
+    } else if (!leer_entero(ci, fi, &ld->isbn) || ld->isbn <= 0) {
+        ld->error = "ISBN inválido";
+    } else if (!leer_entero(ce, fe, &ld->num_ejemplares) || ld->num_ejemplares < 0) {
+        ld->error = "número de ejemplares inválido";
+    } else {
+        ld->tipo = LINEA_ENCABEZADO;
+        ld->nombre = cn;
+        ld->largo_nombre = fn - cn;
+    }
+}
+
+static void anotar_error(tramo_carga_t *t, long linea, const char *mensaje) {
+    if (!t->llenar) {
+        return;  // los errores se anotan una sola vez, en la pasada de llenado
+    }
+    if (t->num_errores == t->capacidad_errores) {
+        int capacidad = t->capacidad_errores ? t->capacidad_errores * 2 : 16;
+        error_carga_t *nuevos = realloc(t->errores, capacidad * sizeof(error_carga_t));
+        if (!nuevos) {
+            return;
+        }
+        t->errores = nuevos;
+        t->capacidad_errores = capacidad;
+    }
+    t->errores[t->num_errores].linea = linea;
+    t->errores[t->num_errores].mensaje = mensaje;
+    t->num_errores++;
+}
+
+// Función que recorre un tramo. Al contar solo acumula totales; al llenar
+// escribe libros, ejemplares y nombres en las posiciones asignadas.
+static void *procesar_tramo(void *arg) {
+    tramo_carga_t *t = arg;
+    const char *p = t->inicio;
+    long linea = t->linea_base;
+    libro_t *libro = NULL;
+    long linea_libro = 0;
+    int faltan = 0;
+    int libros = 0;
+    long ejemplares = 0;
+    size_t bytes_nombres = 0;
+    linea_datos_t ld;
+
+    while (p < t->fin) {
+        const char *fin_linea = memchr(p, '\n', t->fin - p);
+        if (!fin_linea) {
+            fin_linea = t->fin;
+        }
+        linea++;
+        clasificar_linea(p, fin_linea, &ld);
+        p = fin_linea + 1;
+
+        switch (ld.tipo) {
+            case LINEA_VACIA:
+                break;
+
+            case LINEA_EJEMPLAR:
+                if (faltan == 0) {
+                    anotar_error(t, linea, "ejemplar fuera de un libro o sobrante, se ignora");
+                    break;
+                }
+                faltan--;
+                if (t->llenar) {
+                    ejemplar_t *e = &pool_ejemplares[t->ejemplar_base + ejemplares];
+                    e->numero = ld.numero;
+                    e->status = (status_t)ld.status;
+                    e->fecha = ld.fecha;
+                    libro->num_ejemplares++;
+                }
+                ejemplares++;
+                break;
+
+            case LINEA_ENCABEZADO:
+                if (faltan > 0) {
+                    anotar_error(t, linea_libro, "el libro tiene menos ejemplares de los declarados");
+                }
+                if (ld.largo_nombre > MAX_STRING - 1) {
+                    anotar_error(t, linea, "nombre de libro truncado a 255 caracteres");
+                    ld.largo_nombre = MAX_STRING - 1;
+                }
+                if (t->llenar) {
+                    libro = &biblioteca[t->libro_base + libros];
+                    libro->isbn = ld.isbn;
+                    libro->num_ejemplares = 0;
+                    libro->ejemplares = &pool_ejemplares[t->ejemplar_base + ejemplares];
+                    libro->nombre = t->nombres + bytes_nombres;
+                    memcpy(libro->nombre, ld.nombre, ld.largo_nombre);
+                    libro->nombre[ld.largo_nombre] = '\0';
+                }
+                libros++;
+                bytes_nombres += ld.largo_nombre + 1;
+                faltan = ld.num_ejemplares;
+                linea_libro = linea;
+                break;
+
+            case LINEA_INVALIDA:
+                anotar_error(t, linea, ld.error);
+                if (faltan > 0) {
+                    faltan--;  // probablemente era un ejemplar: ocupa su lugar
+                }
+                break;
+        }
+    }
+    if (faltan > 0) {
+        anotar_error(t, linea_libro, "el libro tiene menos ejemplares de los declarados");
+    }
+
+    t->lineas = linea - t->linea_base;
+    t->libros = libros;
+    t->ejemplares = ejemplares;
+    t->bytes_nombres = bytes_nombres;
+    return NULL;
+}
+
+// Función para correr una pasada con un hilo por tramo
+static void correr_pasada(tramo_carga_t *tramos, int n, int llenar) {
+    pthread_t hilos[n];
+    int creado[n];
+
+    for (int i = 0; i < n; i++) {
+        tramos[i].llenar = llenar;
+        creado[i] = (i > 0 && pthread_create(&hilos[i], NULL, procesar_tramo, &tramos[i]) == 0);
+    }
+    procesar_tramo(&tramos[0]);  // el hilo que carga también trabaja
+    for (int i = 1; i < n; i++) {
+        if (creado[i]) {
+            pthread_join(hilos[i], NULL);
+        } else {
+            procesar_tramo(&tramos[i]);
+        }
+    }
+}
+
+// Función para dividir [datos, datos + largo) en tramos que empiezan en un
+// encabezado de libro. Devuelve cuántos tramos quedaron.
+static int dividir_en_tramos(const char *datos, size_t largo, int hilos, tramo_carga_t *tramos) {
+    const char *fin = datos + largo;
+    const char *anterior = datos;
+    int n = 0;
+
+    for (int i = 1; i < hilos; i++) {
+        const char *p = datos + largo / hilos * i;
+        if (p < anterior) {
+            continue;
+        }
+        // Avanzar al comienzo de la siguiente línea y luego hasta un encabezado
+        const char *salto = memchr(p, '\n', fin - p);
+        p = salto ? salto + 1 : fin;
+        while (p < fin) {
+            const char *fin_linea = memchr(p, '\n', fin - p);
+            if (!fin_linea) {
+                fin_linea = fin;
+            }
+            linea_datos_t ld;
+            clasificar_linea(p, fin_linea, &ld);
+            if (ld.tipo == LINEA_ENCABEZADO) {
+                break;
+            }
+            p = fin_linea + 1;
+        }
+        if (p >= fin) {
+            break;
+        }
+        tramos[n].inicio = anterior;
+        tramos[n].fin = p;
+        n++;
+        anterior = p;
+    }
+    tramos[n].inicio = anterior;
+    tramos[n].fin = fin;
+    return n + 1;
+}
+
+// Función para armar los contadores y el mapa de bits de ejemplares libres de
+// todos los libros a partir del estado de sus ejemplares (al final de la carga)
+static int preparar_disponibilidad(void) {
+    size_t palabras = 0;
+    for (int i = 0; i < num_libros; i++) {
+        palabras += PALABRAS_LIBRES(biblioteca[i].num_ejemplares);
+    }
+    uint64_t *libres = arena_reservar(&arena_catalogo, palabras > 0 ? palabras * sizeof(uint64_t) : 1);
+    if (!libres) {
+        fprintf(stderr, "Error reservando el mapa de ejemplares libres\n");
+        return -1;
+    }
+    memset(libres, 0, palabras * sizeof(uint64_t));
+
+    for (int i = 0; i < num_libros; i++) {
+        libro_t *libro = &biblioteca[i];
+        libro->libres = libres;
+        libro->disponibles = 0;
+        libro->prestados = 0;
+        for (int j = 0; j < libro->num_ejemplares; j++) {
+            if (libro->ejemplares[j].status == STATUS_DISPONIBLE) {
+                libres[j / 64] |= 1ULL << (j % 64);
+                libro->disponibles++;
+            } else {
+                libro->prestados++;
+            }
+        }
+        libres += PALABRAS_LIBRES(libro->num_ejemplares);
+    }
+    return 0;
+}
+
+// Función para cargar la base de datos desde el archivo de datos con n hilos.
+// El archivo se mapea en memoria y se divide en tramos que empiezan en un
+// encabezado; una pasada en paralelo cuenta, se reserva todo de una vez y una
+// segunda pasada en paralelo llena libros, ejemplares y nombres. Las líneas
+// mal formadas se informan con su número y se ignoran.
+int catalogo_cargar_paralelo(const char *archivo, int hilos) {
+    int fd = open(archivo, O_RDONLY);
+    if (fd == -1) {
+        perror("Error abriendo archivo de datos");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Error leyendo archivo de datos");
+        close(fd);
+        return -1;
+    }
+
+    size_t largo = st.st_size;
+    const char *datos = "";
+    if (largo > 0) {
+        datos = mmap(NULL, largo, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (datos == MAP_FAILED) {
+            perror("Error mapeando archivo de datos");
+            close(fd);
+            return -1;
+        }
+        madvise((void *)datos, largo, MADV_SEQUENTIAL | MADV_WILLNEED);
+    }
+    close(fd);
+
+    catalogo_liberar();
+
+    // Tramos de al menos 1 MiB: en archivos chicos no vale la pena paralelizar
+    if (hilos < 1) {
+        hilos = 1;
+    }
+    if ((size_t)hilos > largo / BYTES_MINIMOS_POR_HILO + 1) {
+        hilos = (int)(largo / BYTES_MINIMOS_POR_HILO + 1);
+    }
+    tramo_carga_t *tramos = calloc(hilos, sizeof(tramo_carga_t));
+    if (!tramos) {
+        if (largo > 0) {
+            munmap((void *)datos, largo);
+        }
+        return -1;
+    }
+    int num_tramos = dividir_en_tramos(datos, largo, hilos, tramos);
+
+    // Pasada 1: contar
+    correr_pasada(tramos, num_tramos, 0);
+
+    long libros = 0, ejemplares = 0, lineas = 0;
+    size_t bytes_nombres = 0;
+    for (int i = 0; i < num_tramos; i++) {
+        tramos[i].linea_base = lineas;
+        tramos[i].libro_base = (int)libros;
+        tramos[i].ejemplar_base = ejemplares;
+        lineas += tramos[i].lineas;
+        libros += tramos[i].libros;
+        ejemplares += tramos[i].ejemplares;
+        bytes_nombres += tramos[i].bytes_nombres;
+    }
+
+    // Una sola reserva para libros, ejemplares y nombres
+    size_t total = alinear(libros * sizeof(libro_t)) +
+                   alinear(ejemplares * sizeof(ejemplar_t)) +
+                   alinear(bytes_nombres);
+    char *memoria = arena_reservar(&arena_catalogo, total > 0 ? total : 1);
+    if (!memoria || indice_init(&indice_libros, libros) != 0) {
+        fprintf(stderr, "Error reservando memoria para %ld libros y %ld ejemplares\n",
+                libros, ejemplares);
+        free(tramos);
+        if (largo > 0) {
+            munmap((void *)datos, largo);
+        }
+        catalogo_liberar();
+        return -1;
+    }
+
+    biblioteca = (libro_t *)memoria;
+    pool_ejemplares = (ejemplar_t *)(memoria + alinear(libros * sizeof(libro_t)));
+    char *nombres = (char *)pool_ejemplares + alinear(ejemplares * sizeof(ejemplar_t));
+    for (int i = 0; i < num_tramos; i++) {
+        tramos[i].nombres = nombres;
+        nombres += tramos[i].bytes_nombres;
+    }
+
+    // Pasada 2: llenar
+    correr_pasada(tramos, num_tramos, 1);
+    num_libros = (int)libros;
+    num_ejemplares_total = (int)ejemplares;
+
+    int num_errores = 0;
+    for (int i = 0; i < num_tramos; i++) {
+        for (int e = 0; e < tramos[i].num_errores; e++, num_errores++) {
+            if (num_errores < MAX_ERRORES_MOSTRADOS) {
+                fprintf(stderr, "%s:%ld: %s\n", archivo,
+                        tramos[i].errores[e].linea, tramos[i].errores[e].mensaje);
+            }
+        }
+        free(tramos[i].errores);
+    }
+    if (num_errores > MAX_ERRORES_MOSTRADOS) {
+        fprintf(stderr, "%s: %d errores más sin mostrar\n", archivo,
+                num_errores - MAX_ERRORES_MOSTRADOS);
+    }
+    free(tramos);
+    if (largo > 0) {
+        munmap((void *)datos, largo);
+    }
+
+    // Registrar los libros en el índice (el primero con un ISBN dado gana)
+    for (int i = 0; i < num_libros; i++) {
+        if (indice_insertar(&indice_libros, biblioteca[i].isbn, i) != 0) {
+            fprintf(stderr, "Advertencia: ISBN %d duplicado, se ignora '%s'\n",
+                    biblioteca[i].isbn, biblioteca[i].nombre);
+        }
+    }
+    if (preparar_disponibilidad() != 0) {
+        catalogo_liberar();
+        return -1;
+    }
+
+    printf("Base de datos cargada: %d libros, %d ejemplares\n",
+           num_libros, num_ejemplares_total);
+    return 0;
+}
+
+// Función para cargar la base de datos con un hilo por CPU
+int catalogo_cargar(const char *archivo) {
+    return catalogo_cargar_paralelo(archivo, (int)sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+// Función para cargar el catálogo desde una instantánea binaria. El archivo se
+// mapea en privado: los ejemplares y los nombres se usan en su lugar y las
+// páginas que se modifiquen se copian recién al escribirlas. Solo la tabla de
+// libros se arma en la arena. Deja en *lsn el corte del WAL que incluye.
+int catalogo_cargar_instantanea(const char *archivo, uint64_t *lsn) {
+    int fd = open(archivo, O_RDONLY);
+    if (fd == -1) {
+        perror("Error abriendo instantánea");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(cabecera_instantanea_t)) {
+        fprintf(stderr, "Instantánea %s vacía o ilegible\n", archivo);
+        close(fd);
+        return -1;
+    }
+
+    char *mapa = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapa == MAP_FAILED) {
+        perror("Error mapeando instantánea");
+        return -1;
+    }
+
+    const cabecera_instantanea_t *cab = (const cabecera_instantanea_t *)mapa;
+    if (memcmp(cab->magia, INSTANTANEA_MAGIA, sizeof(cab->magia)) != 0 ||
+        cab->version != INSTANTANEA_VERSION || cab->tam_ejemplar != sizeof(ejemplar_t) ||
+        cab->tam_total != (uint64_t)st.st_size || cab->num_libros < 0 || cab->num_ejemplares < 0 ||
+        cab->desp_libros + cab->num_libros * sizeof(libro_instantanea_t) > cab->desp_ejemplares ||
+        cab->desp_ejemplares + cab->num_ejemplares * sizeof(ejemplar_t) > cab->desp_nombres ||
+        cab->desp_nombres > cab->tam_total || cab->desp_ejemplares % sizeof(int) != 0) {
+        fprintf(stderr, "Instantánea %s inválida o de otra versión\n", archivo);
+        munmap(mapa, st.st_size);
+        return -1;
+    }
+
+    catalogo_liberar();
+
+    const libro_instantanea_t *libros = (const libro_instantanea_t *)(mapa + cab->desp_libros);
+    const char *nombres = mapa + cab->desp_nombres;
+    size_t bytes_nombres = cab->tam_total - cab->desp_nombres;
+    int n = (int)cab->num_libros;
+
+    biblioteca = arena_reservar(&arena_catalogo, n > 0 ? n * sizeof(libro_t) : 1);
+    if (!biblioteca || indice_init(&indice_libros, n) != 0) {
+        fprintf(stderr, "Error reservando memoria para %d libros\n", n);
+        munmap(mapa, st.st_size);
+        catalogo_liberar();
+        return -1;
+    }
+    mapeo_catalogo = mapa;
+    largo_mapeo = st.st_size;
+    pool_ejemplares = (ejemplar_t *)(mapa + cab->desp_ejemplares);
+    num_ejemplares_total = (int)cab->num_ejemplares;
+
+    for (num_libros = 0; num_libros < n; num_libros++) {
+        const libro_instantanea_t *origen = &libros[num_libros];
+        libro_t *libro = &biblioteca[num_libros];
+
+        if (origen->primer_ejemplar < 0 || origen->num_ejemplares < 0 ||
+            origen->primer_ejemplar + origen->num_ejemplares > cab->num_ejemplares ||
+            origen->nombre < 0 || (uint64_t)origen->nombre >= bytes_nombres ||
+            memchr(nombres + origen->nombre, '\0', bytes_nombres - origen->nombre) == NULL) {
+            fprintf(stderr, "Instantánea %s: libro %d corrupto\n", archivo, num_libros);
+            catalogo_liberar();
+            return -1;
+        }
+        libro->isbn = origen->isbn;
+        libro->num_ejemplares = origen->num_ejemplares;
+        libro->ejemplares = &pool_ejemplares[origen->primer_ejemplar];
+        libro->nombre = (char *)nombres + origen->nombre;
+        // Misma regla que la carga de texto: el primero con un ISBN dado gana
+        if (indice_insertar(&indice_libros, libro->isbn, num_libros) != 0) {
+            fprintf(stderr, "Advertencia: ISBN %d duplicado, se ignora '%s'\n",
+                    libro->isbn, libro->nombre);
+        }
+    }
+    if (preparar_disponibilidad() != 0) {
+        catalogo_liberar();
+        return -1;
+    }
+
+    *lsn = cab->lsn;
+    printf("Instantánea cargada: %d libros, %d ejemplares\n", num_libros, num_ejemplares_total);
+    return 0;
+}
+
+void catalogo_liberar(void) {
+    indice_destruir(&indice_libros);
+    arena_liberar(&arena_catalogo);
+    if (mapeo_catalogo) {
+        munmap(mapeo_catalogo, largo_mapeo);
+        mapeo_catalogo = NULL;
+        largo_mapeo = 0;
+    }
+    biblioteca = NULL;
+    pool_ejemplares = NULL;
+    num_libros = 0;
+    num_ejemplares_total = 0;
+}
+
+// Función para encontrar un libro por ISBN (O(1) vía indice_libros)
+int encontrar_libro(int isbn) {
+    return indice_buscar(&indice_libros, isbn);
+}
+
+// Función para crear las franjas de bloqueo (se redondea a potencia de dos)
+int catalogo_init_bloqueos(int num_franjas) {
+    int n = 1;
+    while (n < num_franjas) {
+        n <<= 1;
+    }
+
+    franjas = aligned_alloc(TAM_LINEA_CACHE, n * sizeof(franja_bloqueo_t));
+    if (!franjas) {
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        pthread_rwlock_init(&franjas[i].rwlock, NULL);
+        franjas[i].secuencia = 0;
+    }
+    mascara_franjas = n - 1;
+    return n;
+}
+
+void catalogo_destruir_bloqueos(void) {
+    if (!franjas) {
+        return;
+    }
+    for (int i = 0; i <= mascara_franjas; i++) {
+        pthread_rwlock_destroy(&franjas[i].rwlock);
+    }
+    free(franjas);
+    franjas = NULL;
+}
+
+// Función para marcar que un escritor tomó la franja (secuencia impar). El
+// fence hace que quien lea un dato ya modificado vea también la marca.
+// 'pedida' es el momento en que se pidió el rwlock (para medir la espera).
+static void abrir_escritura(franja_bloqueo_t *f, uint64_t pedida) {
+    __atomic_store_n(&f->secuencia, f->secuencia + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    metricas_registrar(MET_ESPERA_FRANJA, pedida);
+    f->tomada = metricas_ahora();
+}
+
+// Función para cerrar la escritura si la había: solo un escritor puede ver la
+// secuencia impar al soltar la franja; un lector la ve siempre par.
+static void cerrar_escritura(franja_bloqueo_t *f) {
+    unsigned secuencia = __atomic_load_n(&f->secuencia, __ATOMIC_RELAXED);
+    if (secuencia & 1) {
+        metricas_registrar(MET_TENENCIA_FRANJA, f->tomada);
+        __atomic_store_n(&f->secuencia, secuencia + 1, __ATOMIC_RELEASE);
+    }
+}
+
+// Función para bloquear un libro para modificarlo
+void catalogo_bloquear(int libro_idx) {
+    franja_bloqueo_t *f = &franjas[libro_idx & mascara_franjas];
+    uint64_t pedida = metricas_ahora();
+    pthread_rwlock_wrlock(&f->rwlock);
+    abrir_escritura(f, pedida);
+}
+
+// Función para bloquear un libro solo para leerlo (no excluye otros lectores)
+void catalogo_bloquear_lectura(int libro_idx) {
+    pthread_rwlock_rdlock(&franjas[libro_idx & mascara_franjas].rwlock);
+}
+
+void catalogo_desbloquear(int libro_idx) {
+    franja_bloqueo_t *f = &franjas[libro_idx & mascara_franjas];
+    cerrar_escritura(f);
+    pthread_rwlock_unlock(&f->rwlock);
+}
+
+int catalogo_num_franjas(void) {
+    return mascara_franjas + 1;
+}
+
+int catalogo_franja(int libro_idx) {
+    return libro_idx & mascara_franjas;
+}
+
+// Función para bloquear una franja completa solo para leerla
+void catalogo_bloquear_franja_lectura(int franja) {
+    pthread_rwlock_rdlock(&franjas[franja].rwlock);
+}
+
+void catalogo_desbloquear_franja(int franja) {
+    pthread_rwlock_unlock(&franjas[franja].rwlock);
+}
+
+// Función para leer los contadores de un libro sin tomar su franja: se repite
+// la lectura si un escritor la tuvo mientras tanto. Con escrituras seguidas,
+// después de REINTENTOS_SECUENCIA intentos se toma la franja para lectura.
+void catalogo_leer_disponibilidad(int libro_idx, int *disponibles, int *prestados) {
+    const libro_t *libro = &biblioteca[libro_idx];
+    franja_bloqueo_t *f = &franjas[libro_idx & mascara_franjas];
+
+    for (int intento = 0; intento < REINTENTOS_SECUENCIA; intento++) {
+        unsigned antes = __atomic_load_n(&f->secuencia, __ATOMIC_ACQUIRE);
+        if (antes & 1) {
+            continue;
+        }
+        *disponibles = __atomic_load_n(&libro->disponibles, __ATOMIC_RELAXED);
+        *prestados = __atomic_load_n(&libro->prestados, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&f->secuencia, __ATOMIC_RELAXED) == antes) {
+            return;
+        }
+    }
+
+    pthread_rwlock_rdlock(&f->rwlock);
+    *disponibles = libro->disponibles;
+    *prestados = libro->prestados;
+    pthread_rwlock_unlock(&f->rwlock);
+}
+
+static int comparar_enteros(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Función para bloquear de una vez las franjas de un conjunto de libros. Se
+// toman en orden ascendente y sin repetir, así dos lotes nunca se interbloquean.
+// Los índices -1 se ignoran. Devuelve cuántas franjas quedaron en franjas_tomadas.
+int catalogo_bloquear_varios(const int *libros, int n, int *franjas_tomadas) {
+    int num = 0;
+    for (int i = 0; i < n; i++) {
+        if (libros[i] >= 0) {
+            franjas_tomadas[num++] = libros[i] & mascara_franjas;
+        }
+    }
+    qsort(franjas_tomadas, num, sizeof(int), comparar_enteros);
+
+    int unicas = 0;
+    for (int i = 0; i < num; i++) {
+        if (unicas == 0 || franjas_tomadas[unicas - 1] != franjas_tomadas[i]) {
+            franjas_tomadas[unicas++] = franjas_tomadas[i];
+        }
+    }
+
+    for (int i = 0; i < unicas; i++) {
+        uint64_t pedida = metricas_ahora();
+        pthread_rwlock_wrlock(&franjas[franjas_tomadas[i]].rwlock);
+        abrir_escritura(&franjas[franjas_tomadas[i]], pedida);
+    }
+    return unicas;
+}
+
+void catalogo_desbloquear_varios(const int *franjas_tomadas, int num_franjas) {
+    for (int i = num_franjas - 1; i >= 0; i--) {
+        cerrar_escritura(&franjas[franjas_tomadas[i]]);
+        pthread_rwlock_unlock(&franjas[franjas_tomadas[i]].rwlock);
+    }
+}
+
+// Función para encontrar el primer ejemplar con el estado dado (-1 si no hay).
+// Los contadores descartan enseguida el caso sin ejemplares; si no, es buscar
+// el primer bit encendido (disponible) o apagado (prestado) del mapa.
+int libro_primer_ejemplar(const libro_t *libro, status_t status) {
+    int buscar_libre = (status == STATUS_DISPONIBLE);
+    if ((buscar_libre ? libro->disponibles : libro->prestados) == 0) {
+        return -1;
+    }
+
+    int palabras = PALABRAS_LIBRES(libro->num_ejemplares);
+    for (int p = 0; p < palabras; p++) {
+        uint64_t bits = buscar_libre ? libro->libres[p] : ~libro->libres[p];
+        if (bits) {
+            int i = p * 64 + __builtin_ctzll(bits);
+            return i < libro->num_ejemplares ? i : -1;
+        }
+    }
+    return -1;
+}
+
+// Función para cambiar el estado de un ejemplar manteniendo la disponibilidad
+void libro_cambiar_estado(libro_t *libro, int ejemplar, status_t status) {
+    ejemplar_t *e = &libro->ejemplares[ejemplar];
+    uint64_t bit = 1ULL << (ejemplar % 64);
+
+    if (e->status == status) {
+        return;
+    }
+    // Los contadores se escriben atómicamente: catalogo_leer_disponibilidad
+    // los lee sin tomar la franja
+    int cambio = (status == STATUS_DISPONIBLE) ? 1 : -1;
+    e->status = status;
+    if (cambio > 0) {
+        libro->libres[ejemplar / 64] |= bit;
+    } else {
+        libro->libres[ejemplar / 64] &= ~bit;
+    }
+    __atomic_store_n(&libro->disponibles, libro->disponibles + cambio, __ATOMIC_RELAXED);
+    __atomic_store_n(&libro->prestados, libro->prestados - cambio, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,97 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: catalogo.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Declaraciones del catálogo de libros del receptor: arena de
+ *              memoria para libros y nombres, pool contiguo de ejemplares,
+ *              índice por ISBN y carga desde el archivo de datos o desde una
+ *              instantánea binaria.
+ * =============================================================================
+ */
+
+#ifndef CATALOGO_H
+#define CATALOGO_H
+
+#include <stdint.h>
+
+#include "estructuras.h"
+#include "indice.h"
+
+// Tamaño mínimo de cada bloque que la arena pide al sistema
+#define ARENA_BLOQUE_MINIMO (1 << 20)
+
+// Bloque de la arena: memoria contigua que se reparte con un puntero que avanza
+typedef struct arena_bloque {
+    struct arena_bloque *siguiente;
+    size_t tam;
+    size_t usado;
+    char datos[];
+} arena_bloque_t;
+
+// Arena: lista de bloques. Nunca libera objetos individuales, solo todo junto.
+typedef struct {
+    arena_bloque_t *actual;
+    size_t total_reservado;
+} arena_t;
+
+void *arena_reservar(arena_t *arena, size_t bytes);
+void arena_liberar(arena_t *arena);
+
+// Número de franjas de bloqueo por defecto (potencia de dos)
+#define FRANJAS_POR_DEFECTO 64
+
+// Franja de bloqueo: protege a todos los libros cuyo índice cae en ella.
+// Se rellena hasta una línea de caché para que franjas vecinas no compartan.
+// La secuencia es impar mientras un escritor tiene la franja: las consultas de
+// disponibilidad la leen antes y después, sin tomar el rwlock (seqlock).
+typedef struct {
+    pthread_rwlock_t rwlock;
+    unsigned secuencia;
+    uint64_t tomada;        // metricas_ahora() al tomarla para escritura
+} __attribute__((aligned(TAM_LINEA_CACHE))) franja_bloqueo_t;
+
+// Lecturas fallidas de la secuencia antes de tomar la franja para lectura
+#define REINTENTOS_SECUENCIA 64
+
+// Catálogo global (definido en catalogo.c)
+extern ejemplar_t *pool_ejemplares;
+extern int num_ejemplares_total;
+extern indice_t indice_libros;
+
+int catalogo_cargar(const char *archivo);
+int catalogo_cargar_paralelo(const char *archivo, int hilos);
+int catalogo_cargar_instantanea(const char *archivo, uint64_t *lsn);
+void catalogo_liberar(void);
+int encontrar_libro(int isbn);
+
+// Bloqueo por libro mediante franjas. Con una sola franja el comportamiento
+// equivale al antiguo bd_mutex global.
+int catalogo_init_bloqueos(int num_franjas);
+void catalogo_destruir_bloqueos(void);
+void catalogo_bloquear(int libro_idx);
+void catalogo_bloquear_lectura(int libro_idx);
+void catalogo_desbloquear(int libro_idx);
+int catalogo_bloquear_varios(const int *libros, int n, int *franjas_tomadas);
+void catalogo_desbloquear_varios(const int *franjas_tomadas, int num_franjas);
+
+// Franja de un libro y bloqueo de franjas enteras (recorridos por franja)
+int catalogo_num_franjas(void);
+int catalogo_franja(int libro_idx);
+void catalogo_bloquear_franja_lectura(int franja);
+void catalogo_desbloquear_franja(int franja);
+
+// Disponibilidad de un libro leída sin bloquear (coherente entre los campos)
+void catalogo_leer_disponibilidad(int libro_idx, int *disponibles, int *prestados);
+
+// Palabras del mapa de bits de ejemplares libres de un libro
+#define PALABRAS_LIBRES(num_ejemplares) (((num_ejemplares) + 63) / 64)
+
+// Operaciones sobre ejemplares (el llamador debe tener el bloqueo del libro).
+// El estado de un ejemplar solo se cambia con libro_cambiar_estado para que
+// los contadores y el mapa de bits sigan al día.
+int libro_primer_ejemplar(const libro_t *libro, status_t status);
+void libro_cambiar_estado(libro_t *libro, int ejemplar, status_t status);
+
+#endif // CATALOGO_H
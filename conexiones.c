@@ -0,0 +1,324 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: conexiones.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Socket Unix del receptor (ver conexiones.h). La tabla de
+ *              conexiones solo la toca el hilo lector, como el índice de
+ *              sesiones. Los sockets no bloquean; cada aviso del bucle de
+ *              eventos lee hasta LECTURAS_POR_EVENTO veces, y cada read() trae
+ *              todas las tramas que el cliente haya mandado juntas. Se lee
+ *              con recvmsg() para recibir, si vienen, el segmento de memoria
+ *              compartida y el eventfd del cliente (ver memoria.h).
+ * =============================================================================
+ */
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "conexiones.h"
+#include "eventos.h"
+#include "memoria.h"
+#include "protocolo.h"
+#include "sesiones.h"
+
+typedef struct {
+    int fd;                 // -1: casilla libre
+    int pid;                // del proceso al otro lado del socket
+    lector_t *lector;
+    memoria_t *memoria;     // segmento compartido del cliente (NULL: solo socket)
+    int aviso_fd;           // eventfd con el que avisa que escribió (-1: ninguno)
+    int sesion;             // casilla de su sesión (-1: todavía ninguna)
+    unsigned sesion_gen;    // generación de la casilla al abrirla
+} conexion_t;
+
+static int escucha_fd = -1;
+static char ruta_socket[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static conexion_t *conexiones = NULL;
+static int max_conexiones = 0;
+static int *conexiones_libres = NULL;
+static int num_libres = 0;
+
+// Cada conexión usa dos descriptores (el suyo y la copia de la sesión):
+// se sube el límite blando de descriptores hasta el duro
+static void subir_limite_descriptores(void) {
+    struct rlimit limite;
+    if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < limite.rlim_max) {
+        limite.rlim_cur = limite.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limite);
+    }
+}
+
+int conexiones_iniciar(const char *ruta, int max) {
+    struct sockaddr_un direccion = { .sun_family = AF_UNIX };
+    if (strlen(ruta) >= sizeof(direccion.sun_path)) {
+        fprintf(stderr, "Ruta de socket demasiado larga: %s\n", ruta);
+        return -1;
+    }
+    strcpy(direccion.sun_path, ruta);
+    strcpy(ruta_socket, ruta);
+
+    conexiones = malloc(max * sizeof(conexion_t));
+    conexiones_libres = malloc(max * sizeof(int));
+    if (!conexiones || !conexiones_libres) {
+        fprintf(stderr, "Sin memoria para la tabla de conexiones\n");
+        return -1;
+    }
+    max_conexiones = max;
+    for (int i = 0; i < max; i++) {
+        conexiones[i].fd = -1;
+        conexiones_libres[i] = max - 1 - i;
+    }
+    num_libres = max;
+    subir_limite_descriptores();
+
+    // Un socket que quedó de una ejecución anterior se reemplaza (otro archivo no)
+    struct stat st;
+    if (stat(ruta, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(ruta);
+    }
+    escucha_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (escucha_fd == -1 ||
+        bind(escucha_fd, (struct sockaddr *)&direccion, sizeof(direccion)) != 0 ||
+        listen(escucha_fd, SOMAXCONN) != 0 ||
+        eventos_agregar(escucha_fd, EPOLLIN, EVENTO_DATO(EVENTO_ESCUCHA, 0)) != 0) {
+        perror("Error creando socket");
+        return -1;
+    }
+    return 0;
+}
+
+static void cerrar_conexion(int i) {
+    conexion_t *c = &conexiones[i];
+
+    // La sesión tiene una copia del descriptor: hay que quitarlo a mano
+    eventos_quitar(c->fd);
+    close(c->fd);
+    if (c->aviso_fd != -1) {
+        eventos_quitar(c->aviso_fd);
+        close(c->aviso_fd);
+        c->aviso_fd = -1;
+    }
+    // Los trabajadores escriben en el anillo con el mutex de la sesión: una
+    // vez cerrada, ya nadie lo toca y se puede desmapear. Se cierra solo la
+    // sesión de esta conexión, aunque el mismo PID tenga otras.
+    if (c->sesion != -1) {
+        sesiones_cerrar_conexion(c->sesion, c->sesion_gen, 1);
+        c->sesion = -1;
+    }
+    if (c->memoria) {
+        munmap(c->memoria, sizeof(memoria_t));
+        c->memoria = NULL;
+    }
+    free(c->lector);
+    c->fd = -1;
+    c->lector = NULL;
+    conexiones_libres[num_libres++] = i;
+}
+
+void conexiones_destruir(void) {
+    for (int i = 0; i < max_conexiones; i++) {
+        if (conexiones[i].fd != -1) {
+            cerrar_conexion(i);
+        }
+    }
+    if (escucha_fd != -1) {
+        close(escucha_fd);
+        unlink(ruta_socket);
+        escucha_fd = -1;
+    }
+    free(conexiones);
+    free(conexiones_libres);
+    conexiones = NULL;
+    conexiones_libres = NULL;
+    max_conexiones = 0;
+}
+
+void conexiones_aceptar(void) {
+    for (;;) {
+        int fd = accept4(escucha_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN) {
+                perror("Error aceptando conexión");
+            }
+            return;
+        }
+
+        struct ucred credenciales;
+        socklen_t largo = sizeof(credenciales);
+        lector_t *lector = NULL;
+        if (num_libres == 0 ||
+            getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credenciales, &largo) != 0 ||
+            !(lector = malloc(sizeof(lector_t)))) {
+            fprintf(stderr, "Conexión rechazada: sin casillas libres\n");
+            close(fd);
+            continue;
+        }
+
+        int i = conexiones_libres[--num_libres];
+        conexiones[i].fd = fd;
+        conexiones[i].pid = credenciales.pid;
+        conexiones[i].lector = lector;
+        conexiones[i].memoria = NULL;
+        conexiones[i].aviso_fd = -1;
+        lector_init(lector);
+        // La conexión es la sesión: no hace falta esperar OP_CONECTAR
+        conexiones[i].sesion = sesiones_abrir_conexion(credenciales.pid, fd,
+                                                       &conexiones[i].sesion_gen);
+        if (conexiones[i].sesion == -1 ||
+            eventos_agregar(fd, EPOLLIN, EVENTO_DATO(EVENTO_CONEXION, i)) != 0) {
+            perror("Error vigilando conexión");
+            cerrar_conexion(i);
+        }
+    }
+}
+
+// Función para adoptar el segmento de memoria y el eventfd que mandó el
+// cliente. Desde aquí sus respuestas van por el anillo y sus solicitudes se
+// leen cuando avisa por el eventfd.
+static void adoptar_memoria(int i, int segmento_fd, int aviso_fd) {
+    conexion_t *c = &conexiones[i];
+    struct stat st;
+    memoria_t *m = MAP_FAILED;
+
+    if (c->memoria == NULL && fstat(segmento_fd, &st) == 0 && st.st_size == sizeof(memoria_t)) {
+        m = mmap(NULL, sizeof(memoria_t), PROT_READ | PROT_WRITE, MAP_SHARED, segmento_fd, 0);
+    }
+    close(segmento_fd);
+    if (m == MAP_FAILED || m->magia != MEMORIA_MAGIA ||
+        eventos_agregar(aviso_fd, EPOLLIN, EVENTO_DATO(EVENTO_MEMORIA, i)) != 0) {
+        fprintf(stderr, "Memoria compartida de %d rechazada\n", c->pid);
+        if (m != MAP_FAILED) {
+            munmap(m, sizeof(memoria_t));
+        }
+        close(aviso_fd);
+        return;
+    }
+
+    // El eventfd es del cliente: si lo creó bloqueante, un eventfd_read sin
+    // avisos pendientes dejaría al hilo lector esperando
+    fcntl(aviso_fd, F_SETFL, fcntl(aviso_fd, F_GETFL) | O_NONBLOCK);
+    c->memoria = m;
+    c->aviso_fd = aviso_fd;
+    sesiones_usar_memoria(c->sesion, c->sesion_gen, &m->respuestas);
+    __atomic_store_n(&m->listo, 1, __ATOMIC_SEQ_CST);
+    memoria_despertar(&m->listo);
+}
+
+// Función para leer del socket con recvmsg(), como lector_llenar pero
+// recogiendo los descriptores que vengan adjuntos
+static ssize_t recibir(int i) {
+    conexion_t *c = &conexiones[i];
+    size_t espacio;
+    struct iovec iov;
+    iov.iov_base = lector_espacio(c->lector, &espacio);
+    iov.iov_len = espacio;
+
+    union {
+        struct cmsghdr cabecera;
+        char datos[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = control.datos, .msg_controllen = sizeof(control.datos) };
+
+    ssize_t n = recvmsg(c->fd, &msg, MSG_CMSG_CLOEXEC);
+    if (n > 0) {
+        lector_agregar(c->lector, n);
+    }
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        int fds[2];
+        size_t num = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        memcpy(fds, CMSG_DATA(cm), (num < 2 ? num : 2) * sizeof(int));
+        if (num == 2) {
+            adoptar_memoria(i, fds[0], fds[1]);
+        } else {
+            for (size_t f = 0; f < num && f < 2; f++) {
+                close(fds[f]);
+            }
+        }
+    }
+    return n;
+}
+
+// Función para pasar a 'atender' las solicitudes del anillo de una conexión.
+// En el bucle de eventos se lee como mucho un lector lleno por aviso, para
+// no acaparar el bucle; al cerrar la conexión ('vaciar') se lee hasta que el
+// anillo quede vacío, porque ya no habrá otro aviso.
+static void leer_memoria(int i, void (*atender)(solicitud_t *sol), int vaciar) {
+    conexion_t *c = &conexiones[i];
+    anillo_bytes_t *anillo = &c->memoria->solicitudes;
+    solicitud_t sol;
+    size_t leidos;
+
+    do {
+        size_t espacio;
+        uint8_t *destino = lector_espacio(c->lector, &espacio);
+        leidos = memoria_leer(anillo, destino, espacio);
+        lector_agregar(c->lector, leidos);
+        while (lector_siguiente_solicitud(c->lector, &sol)) {
+            sol.pid_solicitante = c->pid;
+            sol.conexion = c->fd;
+            sol.sesion = c->sesion;
+            sol.sesion_gen = c->sesion_gen;
+            atender(&sol);
+        }
+    } while (vaciar && leidos > 0);
+}
+
+void conexiones_leer(int i, void (*atender)(solicitud_t *sol)) {
+    if (i < 0 || i >= max_conexiones || conexiones[i].fd == -1) {
+        return;
+    }
+    conexion_t *c = &conexiones[i];
+    solicitud_t sol;
+    ssize_t n = 0;
+
+    for (int l = 0; l < LECTURAS_POR_EVENTO && (n = recibir(i)) > 0; l++) {
+        while (lector_siguiente_solicitud(c->lector, &sol)) {
+            sol.pid_solicitante = c->pid;
+            sol.conexion = c->fd;
+            sol.sesion = c->sesion;
+            sol.sesion_gen = c->sesion_gen;
+            atender(&sol);
+        }
+        // Una lectura que no llenó el lector vació el socket: no hace falta
+        // otro read() solo para ver EAGAIN
+        if (c->lector->fin < LECTOR_CAPACIDAD) {
+            break;
+        }
+    }
+    if (n == 0 || (n == -1 && errno != EAGAIN && errno != EINTR)) {
+        // Lo último que escribió el cliente (OP_SALIR) puede seguir en el anillo
+        if (c->memoria) {
+            leer_memoria(i, atender, 1);
+        }
+        cerrar_conexion(i);
+    }
+}
+
+void conexiones_memoria(int i, void (*atender)(solicitud_t *sol)) {
+    if (i < 0 || i >= max_conexiones || conexiones[i].memoria == NULL) {
+        return;
+    }
+    conexion_t *c = &conexiones[i];
+    eventfd_t avisos;
+    eventfd_read(c->aviso_fd, &avisos);
+
+    leer_memoria(i, atender, 0);
+
+    // Si quedó algo, o llegó mientras se anunciaba la espera, el cliente no
+    // va a avisar: el aviso se lo da el receptor a sí mismo
+    if (memoria_preparar_espera(&c->memoria->solicitudes) != 0) {
+        eventfd_write(c->aviso_fd, 1);
+    }
+}
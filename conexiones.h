@@ -0,0 +1,39 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: conexiones.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Transporte por socket Unix de flujo (-u ruta), junto al pipe
+ *              de solicitudes. Cada conexión tiene su propio lector de tramas,
+ *              así las solicitudes de un cliente nunca se mezclan con las de
+ *              otro aunque superen PIPE_BUF, y las respuestas vuelven por el
+ *              mismo socket (la sesión, que se abre al aceptar, usa una copia
+ *              del descriptor). El PID del cliente se toma del socket
+ *              (SO_PEERCRED), no de la trama. Un cliente puede mandar por el
+ *              socket un segmento de memoria compartida (ver memoria.h); el
+ *              socket sigue sirviendo para saber si el cliente vive.
+ * =============================================================================
+ */
+
+#ifndef CONEXIONES_H
+#define CONEXIONES_H
+
+#include "estructuras.h"
+
+// Crea el socket en 'ruta' y lo registra en el bucle de eventos
+int conexiones_iniciar(const char *ruta, int max_conexiones);
+void conexiones_destruir(void);
+
+// Acepta las conexiones pendientes (aviso del socket de escucha)
+void conexiones_aceptar(void);
+
+// Lee lo que haya en una conexión y pasa cada solicitud completa a 'atender'.
+// Si el cliente se fue, cierra su sesión y la conexión.
+void conexiones_leer(int conexion, void (*atender)(solicitud_t *sol));
+
+// Lee las solicitudes del anillo de memoria compartida de una conexión
+// (aviso por su eventfd)
+void conexiones_memoria(int conexion, void (*atender)(solicitud_t *sol));
+
+#endif // CONEXIONES_H
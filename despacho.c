@@ -0,0 +1,324 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: despacho.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Implementación del pool de trabajadores declarado en despacho.h.
+ *              El hilo lector encola cada solicitud en el fragmento de su ISBN.
+ *              Un fragmento con tareas y sin dueño está "listo"; un trabajador
+ *              lo reclama, procesa hasta LOTE_POR_FRAGMENTO tareas en orden y
+ *              lo suelta. Cada trabajador revisa primero sus propios fragmentos
+ *              (k % num_trabajadores == id) y luego roba los del resto.
+ *
+ *              Una solicitud con ISBN de varios fragmentos (un lote) entra como
+ *              barrera en la cola de cada uno, en el mismo paso. Un fragmento
+ *              que llega a su barrera queda bloqueado; el trabajador que llega
+ *              último la procesa y desbloquea a todos, así va detrás de lo que
+ *              ya estaba encolado en cada fragmento y delante de lo que venga.
+ * =============================================================================
+ */
+
+#include <stdint.h>
+
+#include "despacho.h"
+
+#define CAPACIDAD_INICIAL_FRAGMENTO 16
+
+// Solicitud que espera a llegar al frente de todos sus fragmentos
+typedef struct {
+    solicitud_t sol;
+    uint64_t fragmentos;    // un bit por fragmento
+    int faltan;             // fragmentos que todavía no llegaron a la barrera
+} barrera_t;
+
+// Tarea encolada: una solicitud o su lugar en una barrera
+typedef struct {
+    solicitud_t sol;
+    barrera_t *barrera;     // NULL: solicitud de un solo fragmento
+} tarea_t;
+
+// Cola FIFO creciente de un fragmento
+typedef struct {
+    pthread_mutex_t mutex;
+    tarea_t *tareas;
+    int capacidad;
+    int inicio;
+    int cuenta;
+    int ocupado;    // 1 mientras un trabajador lo procesa
+    int bloqueado;  // 1 mientras su primera tarea espera en una barrera
+} __attribute__((aligned(64))) fragmento_t;
+
+static fragmento_t fragmentos[FRAGMENTOS_DESPACHO];
+static pthread_t *trabajadores = NULL;
+static int num_trabajadores = 0;
+static procesar_solicitud_fn procesar_fn = NULL;
+static int max_encoladas = 0;
+static int encoladas = 0;  // en todos los fragmentos; la suben el lector y la bajan los trabajadores
+
+// Espera de trabajadores ociosos. Orden de bloqueo: fragmento -> espera_mutex.
+static pthread_mutex_t espera_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t espera_cond = PTHREAD_COND_INITIALIZER;
+static int fragmentos_listos = 0;
+static int detener_despacho = 0;
+
+static inline int fragmento_de(int isbn) {
+    return (int)(((uint32_t)isbn * 2654435769u) >> 26) & (FRAGMENTOS_DESPACHO - 1);
+}
+
+// Función para marcar un fragmento como listo (se llama con su mutex tomado)
+static void marcar_listo(void) {
+    pthread_mutex_lock(&espera_mutex);
+    fragmentos_listos++;
+    pthread_cond_signal(&espera_cond);
+    pthread_mutex_unlock(&espera_mutex);
+}
+
+// Función para duplicar la cola de un fragmento conservando el orden
+static int crecer_fragmento(fragmento_t *f) {
+    int nueva_capacidad = f->capacidad ? f->capacidad * 2 : CAPACIDAD_INICIAL_FRAGMENTO;
+    tarea_t *nuevas = malloc(nueva_capacidad * sizeof(tarea_t));
+    if (!nuevas) {
+        return -1;
+    }
+    for (int i = 0; i < f->cuenta; i++) {
+        nuevas[i] = f->tareas[(f->inicio + i) % f->capacidad];
+    }
+    free(f->tareas);
+    f->tareas = nuevas;
+    f->capacidad = nueva_capacidad;
+    f->inicio = 0;
+    return 0;
+}
+
+// Función para encolar una solicitud en el fragmento de su ISBN
+int despacho_encolar(const solicitud_t *sol) {
+    return despacho_encolar_varios(sol, &sol->isbn, 1);
+}
+
+// Función para encolar una solicitud que toca varios ISBN. Si caen en un
+// solo fragmento es una tarea común; si no, se toman los mutex de todos sus
+// fragmentos en orden ascendente y la barrera entra en todos a la vez.
+int despacho_encolar_varios(const solicitud_t *sol, const int *isbns, int num) {
+    uint64_t mascara = 0;
+    for (int i = 0; i < num; i++) {
+        mascara |= 1ULL << fragmento_de(isbns[i]);
+    }
+
+    // Solo el hilo lector encola: nadie más puede pasar el límite entre la
+    // comprobación y el incremento
+    if (max_encoladas > 0 && __atomic_load_n(&encoladas, __ATOMIC_RELAXED) >= max_encoladas) {
+        return -1;
+    }
+
+    barrera_t *barrera = NULL;
+    if (__builtin_popcountll(mascara) > 1) {
+        barrera = malloc(sizeof(barrera_t));
+        if (!barrera) {
+            fprintf(stderr, "Sin memoria para encolar solicitud de %d\n", sol->pid_solicitante);
+            return -1;
+        }
+        barrera->sol = *sol;
+        barrera->fragmentos = mascara;
+        barrera->faltan = __builtin_popcountll(mascara);
+    }
+
+    int error = 0;
+    for (int k = 0; k < FRAGMENTOS_DESPACHO; k++) {
+        fragmento_t *f = &fragmentos[k];
+        if (!(mascara & (1ULL << k))) {
+            continue;
+        }
+        pthread_mutex_lock(&f->mutex);
+        if (f->cuenta == f->capacidad && crecer_fragmento(f) != 0) {
+            error = 1;
+        }
+    }
+    for (int k = 0; k < FRAGMENTOS_DESPACHO; k++) {
+        fragmento_t *f = &fragmentos[k];
+        if (!(mascara & (1ULL << k))) {
+            continue;
+        }
+        if (!error) {
+            tarea_t *t = &f->tareas[(f->inicio + f->cuenta) % f->capacidad];
+            t->sol = *sol;
+            t->barrera = barrera;
+            f->cuenta++;
+            if (f->cuenta == 1 && !f->ocupado && !f->bloqueado) {
+                marcar_listo();
+            }
+        }
+        pthread_mutex_unlock(&f->mutex);
+    }
+    if (error) {
+        free(barrera);
+        fprintf(stderr, "Sin memoria para encolar solicitud de %d\n", sol->pid_solicitante);
+        return -1;
+    }
+    __atomic_add_fetch(&encoladas, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+// Función para llegar a una barrera desde uno de sus fragmentos, que queda
+// bloqueado. Quien llega último procesa la solicitud y desbloquea a todos.
+static void llegar_a_barrera(barrera_t *barrera) {
+    if (__atomic_sub_fetch(&barrera->faltan, 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+    __atomic_sub_fetch(&encoladas, 1, __ATOMIC_RELAXED);
+    procesar_fn(&barrera->sol);
+
+    for (int k = 0; k < FRAGMENTOS_DESPACHO; k++) {
+        if (!(barrera->fragmentos & (1ULL << k))) {
+            continue;
+        }
+        fragmento_t *f = &fragmentos[k];
+        pthread_mutex_lock(&f->mutex);
+        f->bloqueado = 0;
+        if (f->cuenta > 0 && !f->ocupado) {
+            marcar_listo();
+        }
+        pthread_mutex_unlock(&f->mutex);
+    }
+    free(barrera);
+}
+
+// Función para reclamar un fragmento listo y procesar un lote de sus tareas.
+// Devuelve 1 si procesó algo.
+static int procesar_fragmento(fragmento_t *f) {
+    // Lectura sin bloqueo solo como pista para saltar fragmentos vacíos
+    if (__atomic_load_n(&f->cuenta, __ATOMIC_RELAXED) == 0 ||
+        __atomic_load_n(&f->ocupado, __ATOMIC_RELAXED) ||
+        __atomic_load_n(&f->bloqueado, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&f->mutex);
+    if (f->cuenta == 0 || f->ocupado || f->bloqueado) {
+        pthread_mutex_unlock(&f->mutex);
+        return 0;
+    }
+    f->ocupado = 1;
+    pthread_mutex_lock(&espera_mutex);
+    fragmentos_listos--;
+    pthread_mutex_unlock(&espera_mutex);
+
+    for (int n = 0; n < LOTE_POR_FRAGMENTO && f->cuenta > 0 && !f->bloqueado; n++) {
+        tarea_t tarea = f->tareas[f->inicio];
+        f->inicio = (f->inicio + 1) % f->capacidad;
+        f->cuenta--;
+        if (tarea.barrera) {
+            // Nada de este fragmento pasa hasta que la barrera se procese
+            f->bloqueado = 1;
+            f->ocupado = 0;
+            pthread_mutex_unlock(&f->mutex);
+            llegar_a_barrera(tarea.barrera);
+            return 1;
+        }
+        __atomic_sub_fetch(&encoladas, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&f->mutex);
+
+        procesar_fn(&tarea.sol);
+
+        pthread_mutex_lock(&f->mutex);
+    }
+
+    // Si quedan tareas, el fragmento vuelve a estar disponible para cualquiera
+    f->ocupado = 0;
+    if (f->cuenta > 0) {
+        marcar_listo();
+    }
+    pthread_mutex_unlock(&f->mutex);
+    return 1;
+}
+
+// Hilo trabajador: sus fragmentos primero, después roba los de los demás
+static void *hilo_trabajador(void *arg) {
+    int id = (int)(intptr_t)arg;
+
+    while (1) {
+        int trabajo = 0;
+
+        for (int k = id; k < FRAGMENTOS_DESPACHO; k += num_trabajadores) {
+            trabajo |= procesar_fragmento(&fragmentos[k]);
+        }
+        if (!trabajo) {
+            for (int j = 1; j < FRAGMENTOS_DESPACHO; j++) {
+                int k = (id + j) % FRAGMENTOS_DESPACHO;
+                if (k % num_trabajadores != id && procesar_fragmento(&fragmentos[k])) {
+                    trabajo = 1;
+                    break;
+                }
+            }
+        }
+        if (trabajo) {
+            continue;
+        }
+
+        pthread_mutex_lock(&espera_mutex);
+        while (fragmentos_listos == 0 && !detener_despacho) {
+            pthread_cond_wait(&espera_cond, &espera_mutex);
+        }
+        int salir = (fragmentos_listos == 0 && detener_despacho);
+        pthread_mutex_unlock(&espera_mutex);
+        if (salir) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+// Función para crear los fragmentos y lanzar los trabajadores
+int despacho_iniciar(int n, procesar_solicitud_fn procesar, int max) {
+    for (int k = 0; k < FRAGMENTOS_DESPACHO; k++) {
+        pthread_mutex_init(&fragmentos[k].mutex, NULL);
+        fragmentos[k].tareas = NULL;
+        fragmentos[k].capacidad = 0;
+        fragmentos[k].inicio = 0;
+        fragmentos[k].cuenta = 0;
+        fragmentos[k].ocupado = 0;
+        fragmentos[k].bloqueado = 0;
+    }
+
+    trabajadores = malloc(n * sizeof(pthread_t));
+    if (!trabajadores) {
+        return -1;
+    }
+    num_trabajadores = n;
+    procesar_fn = procesar;
+    max_encoladas = max;
+    encoladas = 0;
+    detener_despacho = 0;
+    fragmentos_listos = 0;
+
+    for (int i = 0; i < n; i++) {
+        if (pthread_create(&trabajadores[i], NULL, hilo_trabajador, (void *)(intptr_t)i) != 0) {
+            num_trabajadores = i;
+            despacho_detener();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Función para detener el pool: los trabajadores vacían las colas y terminan
+void despacho_detener(void) {
+    pthread_mutex_lock(&espera_mutex);
+    detener_despacho = 1;
+    pthread_cond_broadcast(&espera_cond);
+    pthread_mutex_unlock(&espera_mutex);
+
+    for (int i = 0; i < num_trabajadores; i++) {
+        pthread_join(trabajadores[i], NULL);
+    }
+    free(trabajadores);
+    trabajadores = NULL;
+    num_trabajadores = 0;
+
+    for (int k = 0; k < FRAGMENTOS_DESPACHO; k++) {
+        free(fragmentos[k].tareas);
+        fragmentos[k].tareas = NULL;
+        pthread_mutex_destroy(&fragmentos[k].mutex);
+    }
+}
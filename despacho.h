@@ -0,0 +1,41 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: despacho.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Pool de hilos trabajadores que procesa solicitudes en paralelo.
+ *              Las solicitudes se reparten por ISBN en fragmentos (colas FIFO);
+ *              cada fragmento lo atiende un solo trabajador a la vez, lo que
+ *              preserva el orden por ISBN, y los trabajadores ociosos roban
+ *              fragmentos pendientes de los demás. Una solicitud que toca
+ *              ISBN de varios fragmentos espera su turno en todos. El total
+ *              de tareas encoladas tiene un límite: por encima,
+ *              despacho_encolar rechaza la solicitud en lugar de dejar crecer
+ *              la espera.
+ * =============================================================================
+ */
+
+#ifndef DESPACHO_H
+#define DESPACHO_H
+
+#include "estructuras.h"
+
+#define TRABAJADORES_POR_DEFECTO 4
+#define FRAGMENTOS_DESPACHO 64      // potencia de dos, mayor que el número de trabajadores
+#define LOTE_POR_FRAGMENTO 32       // tareas seguidas antes de soltar un fragmento
+#define COLA_DESPACHO_POR_DEFECTO 8192  // tareas encoladas como máximo (0: sin límite)
+
+typedef void (*procesar_solicitud_fn)(solicitud_t *sol);
+
+int despacho_iniciar(int num_trabajadores, procesar_solicitud_fn procesar, int max_encoladas);
+
+// Devuelve -1 si la cola está llena (o sin memoria): la solicitud no se encoló
+int despacho_encolar(const solicitud_t *sol);
+
+// Como despacho_encolar, para una solicitud que toca varios ISBN (un lote):
+// se procesa después de todo lo encolado antes para cualquiera de ellos
+int despacho_encolar_varios(const solicitud_t *sol, const int *isbns, int num);
+void despacho_detener(void);
+
+#endif // DESPACHO_H
@@ -11,7 +11,7 @@
  *   - Definiciones de tipos de datos para libros y ejemplares
  *   - Estructuras para comunicación IPC (solicitudes y respuestas)
  *   - Buffer circular para sincronización entre hilos
- *   - Funciones utilitarias para manejo de fechas y validaciones
+ *   - Funciones utilitarias de validación (las fechas están en fechas.h)
  * =============================================================================
  */
 
@@ -29,19 +29,30 @@
 #include <time.h>
 #include <signal.h>
 
+#include "fechas.h"
+
 // Definiciones de constantes
 #define MAX_STRING 256
-#define MAX_BOOKS 100
-#define MAX_COPIES 10
-#define BUFFER_SIZE 10
 #define MAX_LINE 512
+#define MAX_LOTE 512    // operaciones por solicitud en lote
+#define MAX_CONSULTA 256  // ISBN por consulta de disponibilidad
+#define MAX_ENCONTRADOS 64  // títulos por respuesta de búsqueda
+#define TAM_LINEA_CACHE 64
+
+// Pipe de respuesta de cada solicitante (se formatea con su PID)
+#define FORMATO_PIPE_RESPUESTA "/tmp/resp_%d"
 
 // Tipos de operaciones
 typedef enum {
     OP_DEVOLVER = 'D',
     OP_RENOVAR = 'R',
     OP_PRESTAR = 'P',
-    OP_SALIR = 'Q'
+    OP_SALIR = 'Q',
+    OP_CONECTAR = 'C',  // abre la sesión: el receptor conserva el pipe de respuesta
+    OP_LOTE = 'L',      // varias operaciones P/R/D en un solo mensaje
+    OP_VENCIDOS = 'V',  // lista de ejemplares prestados con la devolución vencida
+    OP_CONSULTAR = 'A', // disponibilidad de uno o varios ISBN (no modifica nada)
+    OP_BUSCAR = 'B'     // libros cuyo título contiene las palabras de nombre_libro
 } operation_t;
 
 // Estados de los ejemplares
@@ -50,70 +61,143 @@ typedef enum {
     STATUS_PRESTADO = 'P'
 } status_t;
 
+// Códigos de resultado que el receptor devuelve (los textos se arman en el
+// solicitante, ver formatear_mensaje en protocolo.c)
+typedef enum {
+    RES_PRESTADO = 0,
+    RES_RENOVADO = 1,
+    RES_DEVOLUCION_RECIBIDA = 2,
+    RES_SESION_ESTABLECIDA = 3,
+    RES_DEVUELTO = 4,
+    RES_DISPONIBILIDAD = 5,
+    RES_BUSQUEDA = 6,
+    RES_NO_ENCONTRADO = 16,
+    RES_SIN_DISPONIBLES = 17,
+    RES_SIN_PRESTADOS = 18,
+    RES_NADA_QUE_DEVOLVER = 19,
+    RES_OCUPADO = 20,          // sobrecarga: no se procesó, se puede reintentar
+    RES_ERROR = 31
+} codigo_resultado_t;
+
+// Formato en que viaja un mensaje (ver protocolo.h)
+typedef enum {
+    FORMATO_BINARIO = 0,
+    FORMATO_LEGADO = 1
+} formato_t;
+
 // Estructura para un ejemplar de libro
 typedef struct {
     int numero;
     status_t status;
-    char fecha[12];  // formato: dd-mm-yyyy
+    int fecha;       // número de día (ver fechas.h)
 } ejemplar_t;
 
-// Estructura para un libro
+// Estructura para un libro. El nombre y los ejemplares viven en la arena del
+// catálogo (ver catalogo.c); los ejemplares son un tramo del pool global.
+// Los contadores y el mapa de bits se mantienen con libro_cambiar_estado.
 typedef struct {
-    char nombre[MAX_STRING];
+    char *nombre;
     int isbn;
     int num_ejemplares;
-    ejemplar_t ejemplares[MAX_COPIES];
+    ejemplar_t *ejemplares;
+    int disponibles;
+    int prestados;
+    uint64_t *libres;       // bit i encendido: el ejemplar i está disponible
 } libro_t;
 
+// Operación dentro de una solicitud en lote
+typedef struct {
+    operation_t operacion;
+    int isbn;
+} operacion_lote_t;
+
+typedef struct {
+    int num;
+    operacion_lote_t ops[MAX_LOTE];
+} lote_t;
+
+// ISBN de una consulta de disponibilidad
+typedef struct {
+    int num;
+    int isbn[MAX_CONSULTA];
+} consulta_t;
+
+// Disponibilidad de un ISBN consultado (RES_DISPONIBILIDAD o RES_NO_ENCONTRADO)
+typedef struct {
+    codigo_resultado_t codigo;
+    int disponibles;
+    int prestados;
+} disponibilidad_t;
+
+// Libro encontrado por una búsqueda por título
+typedef struct {
+    int isbn;
+    char nombre[MAX_STRING];
+} libro_encontrado_t;
+
+// Resultado de una operación dentro de un lote
+typedef struct {
+    codigo_resultado_t codigo;
+    int fecha_devolucion;   // número de día; SIN_FECHA si no aplica
+} resultado_lote_t;
+
+// Ejemplar vencido (respuesta a OP_VENCIDOS y comando de consola)
+typedef struct {
+    int isbn;
+    int ejemplar;           // número del ejemplar
+    int fecha;              // fecha de devolución (número de día)
+} vencido_t;
+
 // Estructura para una solicitud
 typedef struct {
+    unsigned id_solicitud;  // elegido por el solicitante; se copia en la respuesta
     operation_t operacion;
     char nombre_libro[MAX_STRING];
     int isbn;
     int pid_solicitante;
+    int conexion;           // socket por el que llegó (-1: pipe de solicitudes)
+    int sesion;             // casilla de sesión (la asigna el receptor)
+    unsigned sesion_gen;    // generación de la casilla al recibir la solicitud
+    formato_t formato;      // formato en que llegó; la respuesta usa el mismo
+    lote_t *lote;           // solo OP_LOTE: operaciones a aplicar
+    int fecha_corte;        // solo OP_VENCIDOS: vencidos antes de este día (SIN_FECHA: hoy)
+    consulta_t *consulta;   // solo OP_CONSULTAR: ISBN a consultar
+    uint64_t recibida;      // metricas_ahora() al leerla (0: sin métricas)
 } solicitud_t;
 
 // Estructura para respuesta
 typedef struct {
-    int exito;  // 1 si éxito, 0 si fallo
-    char mensaje[MAX_STRING];
-    char fecha_devolucion[12];  // Para renovaciones
+    unsigned id_solicitud;  // id de la solicitud que se responde
+    codigo_resultado_t codigo;
+    int fecha_devolucion;       // Para préstamos y renovaciones (número de día)
+    int num_resultados;         // solo lotes: un resultado por operación
+    resultado_lote_t *resultados;
+    int num_vencidos;           // solo vencidos: la lista llega en varios tramos
+    vencido_t *vencidos;
+    int ultimo_tramo;
+    int num_disponibilidades;   // solo consultas: una por ISBN, en el mismo orden
+    disponibilidad_t *disponibilidades;
+    int num_encontrados;        // solo búsquedas: títulos que coinciden
+    libro_encontrado_t *encontrados;
+    int hay_mas;                // hubo más coincidencias que no se enviaron
 } respuesta_t;
 
-// Estructura para el buffer productor-consumidor
-typedef struct {
-    solicitud_t buffer[BUFFER_SIZE];
-    int in;
-    int out;
-    int count;
-    pthread_mutex_t mutex;
-    pthread_cond_t not_full;
-    pthread_cond_t not_empty;
-} circular_buffer_t;
-
 // Estructura para reporte
 typedef struct {
     char status;
-    char nombre[MAX_STRING];
+    const char *nombre;     // apunta al nombre del libro en el catálogo
     int isbn;
     int ejemplar;
-    char fecha[12];
+    int fecha;              // número de día
 } reporte_entry_t;
 
 // Variables globales compartidas
-extern libro_t biblioteca[MAX_BOOKS];
+extern libro_t *biblioteca;
 extern int num_libros;
-extern circular_buffer_t buffer_renovaciones;
-extern reporte_entry_t reportes[1000];
-extern int num_reportes;
-extern pthread_mutex_t bd_mutex;
-extern pthread_mutex_t reporte_mutex;
 extern int verbose_mode;
 extern int terminar_programa;
 
 // Funciones comunes
-void obtener_fecha_actual(char *fecha);
-void agregar_dias_fecha(char *fecha, int dias);
 int validar_isbn(int isbn);
 void imprimir_verbose(const char *mensaje, solicitud_t *sol);
 
@@ -0,0 +1,75 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: eventos.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Envoltorio de epoll y del canal de control (ver eventos.h). El
+ *              canal es un eventfd que nadie lee: una vez escrito queda
+ *              legible, así lo ven tanto el bucle del hilo lector como el
+ *              poll() de la consola, y una segunda señal no hace falta.
+ * =============================================================================
+ */
+
+#include <sys/eventfd.h>
+
+#include "eventos.h"
+
+static int epoll_fd = -1;
+static int control_fd = -1;
+
+int eventos_iniciar(void) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    control_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd == -1 || control_fd == -1 ||
+        eventos_agregar(control_fd, EPOLLIN, EVENTO_DATO(EVENTO_CONTROL, 0)) != 0) {
+        perror("Error creando el bucle de eventos");
+        return -1;
+    }
+    return 0;
+}
+
+void eventos_destruir(void) {
+    if (control_fd != -1) {
+        close(control_fd);
+    }
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+    }
+    control_fd = epoll_fd = -1;
+}
+
+int eventos_agregar(int fd, uint32_t eventos, uint64_t dato) {
+    struct epoll_event ev = { .events = eventos, .data.u64 = dato };
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+int eventos_modificar(int fd, uint32_t eventos, uint64_t dato) {
+    struct epoll_event ev = { .events = eventos, .data.u64 = dato };
+    return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void eventos_quitar(int fd) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+int eventos_esperar(struct epoll_event *eventos, int max) {
+    int n = epoll_wait(epoll_fd, eventos, max, -1);
+    if (n == -1) {
+        if (errno != EINTR) {
+            perror("Error esperando eventos");
+        }
+        return 0;
+    }
+    return n;
+}
+
+void eventos_detener(void) {
+    uint64_t uno = 1;
+    ssize_t escritos = write(control_fd, &uno, sizeof(uno));
+    (void)escritos; // si el contador estuviera lleno, ya es legible
+}
+
+int eventos_fd_control(void) {
+    return control_fd;
+}
@@ -0,0 +1,56 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: eventos.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Bucle de eventos del hilo lector sobre epoll. Vigila el pipe
+ *              de solicitudes, un canal de control (eventfd) para terminar y
+ *              los pipes de respuesta de las sesiones que tienen salida
+ *              pendiente y, con -u, el socket Unix, sus conexiones y los
+ *              avisos de las que usan memoria compartida. Cada descriptor se
+ *              registra con una etiqueta que dice de qué se trata; las
+ *              sesiones llevan además su casilla.
+ * =============================================================================
+ */
+
+#ifndef EVENTOS_H
+#define EVENTOS_H
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#include "estructuras.h"
+
+#define MAX_EVENTOS 64
+#define LECTURAS_POR_EVENTO 16   // read() del pipe de solicitudes por cada aviso
+
+// Etiquetas (los 8 bits bajos del dato de cada evento)
+#define EVENTO_PIPE 1
+#define EVENTO_CONTROL 2
+#define EVENTO_SESION 3
+#define EVENTO_ESCUCHA 4     // socket Unix de escucha (-u)
+#define EVENTO_CONEXION 5    // valor: índice de la conexión
+#define EVENTO_MEMORIA 6     // eventfd de una conexión con memoria compartida
+
+#define EVENTO_DATO(etiqueta, valor) (((uint64_t)(valor) << 8) | (etiqueta))
+#define EVENTO_ETIQUETA(dato) ((int)((dato) & 0xFF))
+#define EVENTO_VALOR(dato) ((int)((dato) >> 8))
+
+int eventos_iniciar(void);
+void eventos_destruir(void);
+
+// Registra, cambia o quita un descriptor (se puede llamar desde cualquier hilo)
+int eventos_agregar(int fd, uint32_t eventos, uint64_t dato);
+int eventos_modificar(int fd, uint32_t eventos, uint64_t dato);
+void eventos_quitar(int fd);
+
+// Espera eventos; devuelve cuántos dejó en 'eventos' (0 si lo interrumpió una señal)
+int eventos_esperar(struct epoll_event *eventos, int max);
+
+// Pide terminar: despierta al bucle y a la consola. Se puede llamar desde
+// un manejador de señales. El canal queda legible para siempre.
+void eventos_detener(void);
+int eventos_fd_control(void);
+
+#endif // EVENTOS_H
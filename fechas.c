@@ -0,0 +1,122 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: fechas.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Conversión entre número de día y fecha civil (ver fechas.h).
+ *              Las conversiones son aritméticas (algoritmo de días desde el
+ *              civil de H. Hinnant), sin mktime ni zona horaria. Solo fecha_hoy
+ *              usa localtime_r, y a lo sumo una vez por segundo.
+ * =============================================================================
+ */
+
+#include <time.h>
+
+#include "fechas.h"
+
+// Segundo en que se calculó el día de hoy (40 bits altos) y el día (24 bajos),
+// en una sola palabra para leerlos juntos sin bloqueo
+static uint64_t hoy_en_cache = 0;
+
+int fecha_desde_civil(int anio, int mes, int dia) {
+    anio -= mes <= 2;
+    int era = (anio >= 0 ? anio : anio - 399) / 400;
+    int anio_de_era = anio - era * 400;
+    int dia_del_anio = (153 * (mes + (mes > 2 ? -3 : 9)) + 2) / 5 + dia - 1;
+    int dia_de_era = anio_de_era * 365 + anio_de_era / 4 - anio_de_era / 100 + dia_del_anio;
+    return era * 146097 + dia_de_era - 719468;
+}
+
+void fecha_a_civil(int fecha, int *anio, int *mes, int *dia) {
+    fecha += 719468;
+    int era = (fecha >= 0 ? fecha : fecha - 146096) / 146097;
+    int dia_de_era = fecha - era * 146097;
+    int anio_de_era = (dia_de_era - dia_de_era / 1460 + dia_de_era / 36524 -
+                       dia_de_era / 146096) / 365;
+    int dia_del_anio = dia_de_era - (365 * anio_de_era + anio_de_era / 4 - anio_de_era / 100);
+    int mp = (5 * dia_del_anio + 2) / 153;
+    *dia = dia_del_anio - (153 * mp + 2) / 5 + 1;
+    *mes = mp < 10 ? mp + 3 : mp - 9;
+    *anio = anio_de_era + era * 400 + (*mes <= 2);
+}
+
+int fecha_hoy(void) {
+    time_t ahora = time(NULL);
+    uint64_t cache = __atomic_load_n(&hoy_en_cache, __ATOMIC_RELAXED);
+    if ((cache >> 24) == (uint64_t)ahora) {
+        return (int)(cache & 0xFFFFFF);
+    }
+
+    struct tm tm_info;
+    localtime_r(&ahora, &tm_info);
+    int hoy = fecha_desde_civil(tm_info.tm_year + 1900, tm_info.tm_mon + 1, tm_info.tm_mday);
+    __atomic_store_n(&hoy_en_cache, ((uint64_t)ahora << 24) | (uint32_t)hoy, __ATOMIC_RELAXED);
+    return hoy;
+}
+
+// Función para leer exactamente n dígitos
+static int leer_digitos(const char *p, int n, int *valor) {
+    *valor = 0;
+    for (int i = 0; i < n; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return 0;
+        }
+        *valor = *valor * 10 + (p[i] - '0');
+    }
+    return 1;
+}
+
+int fecha_de_texto(const char *texto, size_t largo) {
+    int dia, mes, anio;
+    if (largo != 10 || texto[2] != '-' || texto[5] != '-' ||
+        !leer_digitos(texto, 2, &dia) || !leer_digitos(texto + 3, 2, &mes) ||
+        !leer_digitos(texto + 6, 4, &anio)) {
+        return SIN_FECHA;
+    }
+    if (mes < 1 || mes > 12 || dia < 1 || dia > 31) {
+        return SIN_FECHA;
+    }
+
+    // Descarta días que no existen en ese mes (31-04, 29-02 de año no bisiesto)
+    int fecha = fecha_desde_civil(anio, mes, dia);
+    int a, m, d;
+    fecha_a_civil(fecha, &a, &m, &d);
+    return (d == dia) ? fecha : SIN_FECHA;
+}
+
+void fecha_a_texto(int fecha, char *texto) {
+    if (fecha == SIN_FECHA) {
+        texto[0] = '\0';
+        return;
+    }
+    int anio, mes, dia;
+    fecha_a_civil(fecha, &anio, &mes, &dia);
+    texto[0] = '0' + dia / 10;
+    texto[1] = '0' + dia % 10;
+    texto[2] = '-';
+    texto[3] = '0' + mes / 10;
+    texto[4] = '0' + mes % 10;
+    texto[5] = '-';
+    texto[6] = '0' + anio / 1000 % 10;
+    texto[7] = '0' + anio / 100 % 10;
+    texto[8] = '0' + anio / 10 % 10;
+    texto[9] = '0' + anio % 10;
+    texto[10] = '\0';
+}
+
+uint32_t fecha_a_aaaammdd(int fecha) {
+    if (fecha == SIN_FECHA) {
+        return 0;
+    }
+    int anio, mes, dia;
+    fecha_a_civil(fecha, &anio, &mes, &dia);
+    return (uint32_t)(anio * 10000 + mes * 100 + dia);
+}
+
+int fecha_de_aaaammdd(uint32_t numero) {
+    if (numero == 0) {
+        return SIN_FECHA;
+    }
+    return fecha_desde_civil(numero / 10000, numero / 100 % 100, numero % 100);
+}
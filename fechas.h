@@ -0,0 +1,39 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: fechas.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Fechas como número de día (días desde el 01-01-1970, en el
+ *              calendario civil y sin hora). En memoria, en el WAL y en las
+ *              instantáneas se guardan así; el texto dd-mm-aaaa solo aparece
+ *              al leer la base de datos y al escribir reportes, respuestas y el
+ *              estado final. El día de hoy se calcula una vez por segundo.
+ * =============================================================================
+ */
+
+#ifndef FECHAS_H
+#define FECHAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SIN_FECHA 0         // el 01-01-1970 no se usa como fecha real
+#define LARGO_FECHA 12      // "dd-mm-aaaa" con su '\0' (y margen)
+
+// Día local de hoy
+int fecha_hoy(void);
+
+int fecha_desde_civil(int anio, int mes, int dia);
+void fecha_a_civil(int fecha, int *anio, int *mes, int *dia);
+
+// Texto dd-mm-aaaa. fecha_de_texto devuelve SIN_FECHA si no es válido;
+// fecha_a_texto escribe "" para SIN_FECHA.
+int fecha_de_texto(const char *texto, size_t largo);
+void fecha_a_texto(int fecha, char *texto);
+
+// Entero aaaammdd del protocolo binario (0 = sin fecha)
+uint32_t fecha_a_aaaammdd(int fecha);
+int fecha_de_aaaammdd(uint32_t numero);
+
+#endif // FECHAS_H
@@ -0,0 +1,168 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: indice.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Implementación de la tabla hash de direccionamiento abierto
+ *              declarada en indice.h. Usa hashing multiplicativo (Fibonacci)
+ *              y sondeo lineal; la tabla se duplica al superar el 70% de
+ *              ocupación para mantener las búsquedas en O(1).
+ * =============================================================================
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "indice.h"
+
+#define INDICE_CAPACIDAD_MINIMA 16
+
+// Función hash multiplicativa: toma los bits altos del producto
+static inline size_t indice_hash(const indice_t *indice, int clave) {
+    return (size_t)(((uint32_t)clave * 2654435769u) >> (32 - indice->bits));
+}
+
+// Función para reservar una tabla vacía de la capacidad dada
+static int indice_reservar(indice_t *indice, size_t capacidad) {
+    unsigned bits = 0;
+    while (((size_t)1 << bits) < capacidad) {
+        bits++;
+    }
+
+    indice->capacidad = (size_t)1 << bits;
+    indice->bits = bits;
+    indice->ocupados = 0;
+    indice->claves = calloc(indice->capacidad, sizeof(int));
+    indice->valores = malloc(indice->capacidad * sizeof(int));
+
+    if (!indice->claves || !indice->valores) {
+        free(indice->claves);
+        free(indice->valores);
+        indice->claves = NULL;
+        indice->valores = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Función para duplicar la tabla reinsertando todas las claves
+static int indice_crecer(indice_t *indice) {
+    indice_t nuevo;
+    if (indice_reservar(&nuevo, indice->capacidad * 2) != 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < indice->capacidad; i++) {
+        if (indice->claves[i] != 0) {
+            indice_insertar(&nuevo, indice->claves[i], indice->valores[i]);
+        }
+    }
+
+    indice_destruir(indice);
+    *indice = nuevo;
+    return 0;
+}
+
+// Función para inicializar el índice dimensionado para n elementos
+int indice_init(indice_t *indice, size_t elementos_esperados) {
+    size_t capacidad = INDICE_CAPACIDAD_MINIMA;
+    while (capacidad * 7 < elementos_esperados * 10) {
+        capacidad *= 2;
+    }
+    return indice_reservar(indice, capacidad);
+}
+
+void indice_destruir(indice_t *indice) {
+    free(indice->claves);
+    free(indice->valores);
+    indice->claves = NULL;
+    indice->valores = NULL;
+    indice->capacidad = 0;
+    indice->ocupados = 0;
+}
+
+// Función para insertar una clave. Devuelve 0 si se insertó, 1 si la clave ya
+// existía (se conserva el valor original) y -1 si la clave no es válida o no
+// hubo memoria.
+int indice_insertar(indice_t *indice, int clave, int valor) {
+    if (clave <= 0) {
+        return -1;
+    }
+    if ((indice->ocupados + 1) * 10 > indice->capacidad * 7) {
+        if (indice_crecer(indice) != 0) {
+            return -1;
+        }
+    }
+
+    size_t mascara = indice->capacidad - 1;
+    size_t pos = indice_hash(indice, clave);
+
+    while (indice->claves[pos] != 0) {
+        if (indice->claves[pos] == clave) {
+            return 1;
+        }
+        pos = (pos + 1) & mascara;
+    }
+
+    indice->claves[pos] = clave;
+    indice->valores[pos] = valor;
+    indice->ocupados++;
+    return 0;
+}
+
+// Función para buscar una clave. Devuelve su valor o INDICE_NO_ENCONTRADO.
+int indice_buscar(const indice_t *indice, int clave) {
+    if (clave <= 0 || indice->capacidad == 0) {
+        return INDICE_NO_ENCONTRADO;
+    }
+
+    size_t mascara = indice->capacidad - 1;
+    size_t pos = indice_hash(indice, clave);
+
+    while (indice->claves[pos] != 0) {
+        if (indice->claves[pos] == clave) {
+            return indice->valores[pos];
+        }
+        pos = (pos + 1) & mascara;
+    }
+    return INDICE_NO_ENCONTRADO;
+}
+
+// Función para eliminar una clave. Usa borrado con desplazamiento hacia atrás
+// para no dejar lápidas que alarguen las búsquedas. Devuelve 0 si la eliminó.
+int indice_eliminar(indice_t *indice, int clave) {
+    if (clave <= 0 || indice->capacidad == 0) {
+        return -1;
+    }
+
+    size_t mascara = indice->capacidad - 1;
+    size_t hueco = indice_hash(indice, clave);
+
+    while (indice->claves[hueco] != clave) {
+        if (indice->claves[hueco] == 0) {
+            return -1;
+        }
+        hueco = (hueco + 1) & mascara;
+    }
+
+    // Mover hacia el hueco las claves cuya posición ideal no queda entre el
+    // hueco y su posición actual
+    size_t j = hueco;
+    while (1) {
+        j = (j + 1) & mascara;
+        if (indice->claves[j] == 0) {
+            break;
+        }
+        size_t ideal = indice_hash(indice, indice->claves[j]);
+        if (((j - ideal) & mascara) >= ((j - hueco) & mascara)) {
+            indice->claves[hueco] = indice->claves[j];
+            indice->valores[hueco] = indice->valores[j];
+            hueco = j;
+        }
+    }
+
+    indice->claves[hueco] = 0;
+    indice->ocupados--;
+    return 0;
+}
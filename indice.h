@@ -0,0 +1,39 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: indice.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Tabla hash de direccionamiento abierto (sondeo lineal) que
+ *              asocia claves enteras positivas con enteros. El receptor la usa
+ *              para ubicar un libro por ISBN en tiempo constante en lugar de
+ *              recorrer toda la biblioteca, y para ubicar la sesión de un
+ *              solicitante por su PID.
+ * =============================================================================
+ */
+
+#ifndef INDICE_H
+#define INDICE_H
+
+#include <stddef.h>
+
+// Valor devuelto por indice_buscar cuando la clave no existe
+#define INDICE_NO_ENCONTRADO -1
+
+// Tabla hash entera. La clave 0 marca una casilla vacía, por lo que solo se
+// admiten claves positivas (igual que validar_isbn).
+typedef struct {
+    int *claves;
+    int *valores;
+    size_t capacidad;   // siempre potencia de dos
+    size_t ocupados;
+    unsigned bits;      // log2(capacidad)
+} indice_t;
+
+int indice_init(indice_t *indice, size_t elementos_esperados);
+void indice_destruir(indice_t *indice);
+int indice_insertar(indice_t *indice, int clave, int valor);
+int indice_buscar(const indice_t *indice, int clave);
+int indice_eliminar(indice_t *indice, int clave);
+
+#endif // INDICE_H
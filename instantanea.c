@@ -0,0 +1,226 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: instantanea.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Escritura periódica de instantáneas (ver instantanea.h). Se
+ *              mantiene en memoria la imagen completa del archivo; cada ronda
+ *              copia a la imagen los ejemplares de los libros sucios, tomando
+ *              solo la franja de cada uno para lectura, y escribe la imagen sin
+ *              ningún bloqueo tomado. Con WAL, la ronda empieza rotándolo: la
+ *              instantánea incluye todo lo anterior al corte, y al quedar en
+ *              disco el segmento viejo se descarta.
+ * =============================================================================
+ */
+
+#include "instantanea.h"
+#include "catalogo.h"
+#include "wal.h"
+
+static char archivo_instantanea[MAX_STRING];
+static char archivo_temporal[MAX_STRING + 8];
+static int segundos_entre_rondas;
+
+static char *imagen = NULL;
+static size_t tam_imagen = 0;
+static ejemplar_t *ejemplares_imagen = NULL;
+static unsigned char *libros_sucios = NULL;
+static int hay_sucios = 0;
+
+static pthread_t hilo_instantanea;
+static pthread_mutex_t instantanea_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t instantanea_cond = PTHREAD_COND_INITIALIZER;
+static int detener_instantanea = 0;
+
+static size_t alinear8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+// Función para armar la imagen completa a partir del catálogo cargado
+static int construir_imagen(void) {
+    size_t bytes_nombres = 0;
+    for (int i = 0; i < num_libros; i++) {
+        bytes_nombres += strlen(biblioteca[i].nombre) + 1;
+    }
+
+    cabecera_instantanea_t cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magia, INSTANTANEA_MAGIA, sizeof(cab.magia));
+    cab.version = INSTANTANEA_VERSION;
+    cab.tam_ejemplar = sizeof(ejemplar_t);
+    cab.num_libros = num_libros;
+    cab.num_ejemplares = num_ejemplares_total;
+    cab.desp_libros = alinear8(sizeof(cab));
+    cab.desp_ejemplares = alinear8(cab.desp_libros + num_libros * sizeof(libro_instantanea_t));
+    cab.desp_nombres = cab.desp_ejemplares + num_ejemplares_total * sizeof(ejemplar_t);
+    cab.tam_total = cab.desp_nombres + bytes_nombres;
+
+    imagen = calloc(1, cab.tam_total);
+    libros_sucios = calloc(num_libros > 0 ? num_libros : 1, 1);
+    if (!imagen || !libros_sucios) {
+        return -1;
+    }
+    tam_imagen = cab.tam_total;
+    memcpy(imagen, &cab, sizeof(cab));
+
+    libro_instantanea_t *libros = (libro_instantanea_t *)(imagen + cab.desp_libros);
+    ejemplares_imagen = (ejemplar_t *)(imagen + cab.desp_ejemplares);
+    char *nombres = imagen + cab.desp_nombres;
+    size_t desp_nombre = 0;
+
+    for (int i = 0; i < num_libros; i++) {
+        libros[i].isbn = biblioteca[i].isbn;
+        libros[i].num_ejemplares = biblioteca[i].num_ejemplares;
+        libros[i].primer_ejemplar = biblioteca[i].ejemplares - pool_ejemplares;
+        libros[i].nombre = desp_nombre;
+        size_t largo = strlen(biblioteca[i].nombre) + 1;
+        memcpy(nombres + desp_nombre, biblioteca[i].nombre, largo);
+        desp_nombre += largo;
+    }
+    memcpy(ejemplares_imagen, pool_ejemplares, num_ejemplares_total * sizeof(ejemplar_t));
+    return 0;
+}
+
+// Función para escribir la imagen en el temporal y reemplazar la instantánea
+static int escribir_imagen(void) {
+    int fd = open(archivo_temporal, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        perror("Error creando instantánea");
+        return -1;
+    }
+
+    size_t escritos = 0;
+    while (escritos < tam_imagen) {
+        ssize_t r = write(fd, imagen + escritos, tam_imagen - escritos);
+        if (r == -1 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            break;
+        }
+        escritos += r;
+    }
+    if (escritos < tam_imagen || fsync(fd) != 0) {
+        perror("Error escribiendo instantánea");
+        close(fd);
+        unlink(archivo_temporal);
+        return -1;
+    }
+    close(fd);
+
+    if (rename(archivo_temporal, archivo_instantanea) != 0) {
+        perror("Error reemplazando instantánea");
+        unlink(archivo_temporal);
+        return -1;
+    }
+    return sincronizar_directorio(archivo_instantanea);
+}
+
+// Función para una ronda: copiar los libros sucios y escribir la imagen
+static void tomar_instantanea(void) {
+    if (!__atomic_exchange_n(&hay_sucios, 0, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+
+    // Todo cambio con LSN anterior al corte ya está aplicado en memoria
+    uint64_t corte = wal_rotar();
+
+    int copiados = 0;
+    for (int i = 0; i < num_libros; i++) {
+        if (!__atomic_load_n(&libros_sucios[i], __ATOMIC_RELAXED)) {
+            continue;
+        }
+        // Se limpia antes de copiar: un cambio posterior lo vuelve a marcar
+        __atomic_store_n(&libros_sucios[i], 0, __ATOMIC_RELAXED);
+
+        libro_t *libro = &biblioteca[i];
+        catalogo_bloquear_lectura(i);
+        memcpy(&ejemplares_imagen[libro->ejemplares - pool_ejemplares], libro->ejemplares,
+               libro->num_ejemplares * sizeof(ejemplar_t));
+        catalogo_desbloquear(i);
+        copiados++;
+    }
+
+    ((cabecera_instantanea_t *)imagen)->lsn = corte;
+    if (escribir_imagen() == 0) {
+        wal_descartar_anterior();
+        if (verbose_mode) {
+            printf("[VERBOSE] Instantánea escrita: %d libros modificados, LSN %llu\n",
+                   copiados, (unsigned long long)corte);
+        }
+    } else {
+        __atomic_store_n(&hay_sucios, 1, __ATOMIC_RELEASE);  // reintentar en la próxima ronda
+    }
+}
+
+static void *hilo_escritor_instantanea(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&instantanea_mutex);
+    while (!detener_instantanea) {
+        struct timespec limite;
+        clock_gettime(CLOCK_REALTIME, &limite);
+        limite.tv_sec += segundos_entre_rondas;
+        pthread_cond_timedwait(&instantanea_cond, &instantanea_mutex, &limite);
+        if (detener_instantanea) {
+            break;
+        }
+
+        pthread_mutex_unlock(&instantanea_mutex);
+        tomar_instantanea();
+        pthread_mutex_lock(&instantanea_mutex);
+    }
+    pthread_mutex_unlock(&instantanea_mutex);
+    return NULL;
+}
+
+int instantanea_iniciar(const char *archivo, int segundos) {
+    snprintf(archivo_instantanea, sizeof(archivo_instantanea), "%s", archivo);
+    snprintf(archivo_temporal, sizeof(archivo_temporal), "%s.tmp", archivo);
+    segundos_entre_rondas = segundos;
+
+    if (construir_imagen() != 0) {
+        fprintf(stderr, "Sin memoria para la imagen de la instantánea\n");
+        return -1;
+    }
+
+    // La primera instantánea deja en disco el estado recién cargado
+    hay_sucios = 1;
+    tomar_instantanea();
+
+    detener_instantanea = 0;
+    if (pthread_create(&hilo_instantanea, NULL, hilo_escritor_instantanea, NULL) != 0) {
+        fprintf(stderr, "Error creando el hilo de instantáneas\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Función para detener el hilo y escribir una última instantánea
+void instantanea_detener(void) {
+    if (!imagen) {
+        return;
+    }
+
+    pthread_mutex_lock(&instantanea_mutex);
+    detener_instantanea = 1;
+    pthread_cond_signal(&instantanea_cond);
+    pthread_mutex_unlock(&instantanea_mutex);
+    pthread_join(hilo_instantanea, NULL);
+
+    tomar_instantanea();
+
+    free(imagen);
+    free(libros_sucios);
+    imagen = NULL;
+    libros_sucios = NULL;
+    ejemplares_imagen = NULL;
+}
+
+void instantanea_marcar(int libro_idx) {
+    if (libros_sucios) {
+        __atomic_store_n(&libros_sucios[libro_idx], 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&hay_sucios, 1, __ATOMIC_RELEASE);
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: instantanea.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Instantáneas binarias del catálogo. Un hilo propio las escribe
+ *              cada cierto tiempo copiando solo los libros modificados desde la
+ *              anterior (marcados como sucios), a un archivo temporal que luego
+ *              reemplaza al anterior con rename. El formato está pensado para
+ *              cargarse con mmap: los ejemplares tienen la misma disposición
+ *              que en memoria y el receptor los usa directamente.
+ *
+ *   Archivo: cabecera | libros[num_libros] | ejemplares[num_ejemplares] | nombres
+ * =============================================================================
+ */
+
+#ifndef INSTANTANEA_H
+#define INSTANTANEA_H
+
+#include <stdint.h>
+
+#include "estructuras.h"
+
+#define INSTANTANEA_MAGIA "BIBSNAP1"
+#define INSTANTANEA_VERSION 2     // 2: fechas de ejemplar como número de día
+#define INSTANTANEA_SEGUNDOS_POR_DEFECTO 30
+
+typedef struct {
+    char magia[8];
+    uint32_t version;
+    uint32_t tam_ejemplar;      // sizeof(ejemplar_t) de quien la escribió
+    uint64_t lsn;               // incluye todos los cambios del WAL anteriores a este LSN
+    int64_t num_libros;
+    int64_t num_ejemplares;
+    uint64_t desp_libros;
+    uint64_t desp_ejemplares;
+    uint64_t desp_nombres;
+    uint64_t tam_total;
+} cabecera_instantanea_t;
+
+typedef struct {
+    int32_t isbn;
+    int32_t num_ejemplares;
+    int64_t primer_ejemplar;    // posición en la sección de ejemplares
+    int64_t nombre;             // desplazamiento en la sección de nombres
+} libro_instantanea_t;
+
+// Se llama con el catálogo ya cargado y antes de atender solicitudes
+int instantanea_iniciar(const char *archivo, int segundos);
+void instantanea_detener(void);
+
+// Marca un libro como modificado (con su franja bloqueada)
+void instantanea_marcar(int libro_idx);
+
+#endif // INSTANTANEA_H
@@ -0,0 +1,97 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: memoria.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Anillos de bytes en memoria compartida (ver memoria.h). Para no
+ *              perder avisos, quien se va a dormir marca su palabra de espera
+ *              y vuelve a mirar el anillo, y quien escribe publica el índice
+ *              antes de mirar la palabra; ambos pasos son secuencialmente
+ *              consistentes, así que al menos uno de los dos ve al otro.
+ * =============================================================================
+ */
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#include "memoria.h"
+
+void memoria_esperar(uint32_t *palabra, uint32_t valor) {
+    struct timespec espera = { 0, MEMORIA_ESPERA_MS * 1000000L };
+    syscall(SYS_futex, palabra, FUTEX_WAIT, valor, &espera, NULL, 0);
+}
+
+void memoria_despertar(uint32_t *palabra) {
+    syscall(SYS_futex, palabra, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+int memoria_escribir(anillo_bytes_t *anillo, const void *datos, size_t largo) {
+    uint64_t escritos = anillo->escritos;
+    uint64_t leidos = __atomic_load_n(&anillo->leidos, __ATOMIC_ACQUIRE);
+    if (MEMORIA_CAPACIDAD - (escritos - leidos) < largo) {
+        return -1;
+    }
+
+    size_t pos = escritos & (MEMORIA_CAPACIDAD - 1);
+    size_t primero = MEMORIA_CAPACIDAD - pos < largo ? MEMORIA_CAPACIDAD - pos : largo;
+    memcpy(anillo->datos + pos, datos, primero);
+    memcpy(anillo->datos, (const uint8_t *)datos + primero, largo - primero);
+
+    __atomic_store_n(&anillo->escritos, escritos + largo, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&anillo->esperando_datos, __ATOMIC_SEQ_CST) &&
+           __atomic_exchange_n(&anillo->esperando_datos, 0, __ATOMIC_SEQ_CST);
+}
+
+size_t memoria_leer(anillo_bytes_t *anillo, void *destino, size_t max) {
+    uint64_t leidos = anillo->leidos;
+    uint64_t escritos = __atomic_load_n(&anillo->escritos, __ATOMIC_ACQUIRE);
+    size_t largo = escritos - leidos < max ? escritos - leidos : max;
+    if (largo == 0) {
+        return 0;
+    }
+
+    size_t pos = leidos & (MEMORIA_CAPACIDAD - 1);
+    size_t primero = MEMORIA_CAPACIDAD - pos < largo ? MEMORIA_CAPACIDAD - pos : largo;
+    memcpy(destino, anillo->datos + pos, primero);
+    memcpy((uint8_t *)destino + primero, anillo->datos, largo - primero);
+
+    __atomic_store_n(&anillo->leidos, leidos + largo, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&anillo->esperando_espacio, __ATOMIC_SEQ_CST) &&
+        __atomic_exchange_n(&anillo->esperando_espacio, 0, __ATOMIC_SEQ_CST)) {
+        memoria_despertar(&anillo->esperando_espacio);
+    }
+    return largo;
+}
+
+int memoria_preparar_espera(anillo_bytes_t *anillo) {
+    __atomic_store_n(&anillo->esperando_datos, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&anillo->escritos, __ATOMIC_SEQ_CST) != anillo->leidos) {
+        __atomic_store_n(&anillo->esperando_datos, 0, __ATOMIC_RELAXED);
+        return 1;
+    }
+    return 0;
+}
+
+void memoria_esperar_datos(anillo_bytes_t *anillo) {
+    if (memoria_preparar_espera(anillo) == 0 &&
+        !__atomic_load_n(&anillo->cerrado, __ATOMIC_SEQ_CST)) {
+        memoria_esperar(&anillo->esperando_datos, 1);
+    }
+}
+
+void memoria_esperar_espacio(anillo_bytes_t *anillo, size_t largo) {
+    __atomic_store_n(&anillo->esperando_espacio, 1, __ATOMIC_SEQ_CST);
+    uint64_t leidos = __atomic_load_n(&anillo->leidos, __ATOMIC_SEQ_CST);
+    if (MEMORIA_CAPACIDAD - (anillo->escritos - leidos) >= largo) {
+        __atomic_store_n(&anillo->esperando_espacio, 0, __ATOMIC_RELAXED);
+        return;
+    }
+    memoria_esperar(&anillo->esperando_espacio, 1);
+}
+
+void memoria_cerrar(anillo_bytes_t *anillo) {
+    __atomic_store_n(&anillo->cerrado, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&anillo->esperando_datos, 0, __ATOMIC_SEQ_CST);
+    memoria_despertar(&anillo->esperando_datos);
+}
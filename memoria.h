@@ -0,0 +1,76 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: memoria.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Transporte por memoria compartida para solicitantes en la misma
+ *              máquina. El cliente crea un segmento (memfd) con dos anillos de
+ *              bytes de un productor y un consumidor: solicitudes (cliente ->
+ *              receptor) y respuestas (receptor -> cliente), y se lo pasa al
+ *              receptor por su socket Unix junto con un eventfd. Por los
+ *              anillos viajan las mismas tramas que por los pipes, escritas
+ *              directamente en la memoria del otro proceso.
+ *
+ *              Nadie hace llamadas al sistema mientras hay trabajo: solo se
+ *              avisa a quien anunció que se iba a dormir. El receptor duerme
+ *              en epoll, así que a él se le avisa por el eventfd; el cliente
+ *              duerme en un futex sobre la palabra de espera del anillo.
+ * =============================================================================
+ */
+
+#ifndef MEMORIA_H
+#define MEMORIA_H
+
+#include <stdint.h>
+
+#include "estructuras.h"
+
+#define MEMORIA_MAGIA 0x314D4942u          // "BIM1"
+#define MEMORIA_CAPACIDAD (1u << 20)       // bytes por anillo (potencia de dos)
+#define MEMORIA_ESPERA_MS 100              // cada cuánto revisa el cliente si el receptor sigue vivo
+
+// Anillo de bytes. 'escritos' y 'leidos' solo crecen; cada uno lo mueve un
+// solo proceso. Las palabras de espera son futex compartidos: valen 1 cuando
+// el consumidor (datos) o el productor (espacio) va a dormir.
+typedef struct {
+    uint64_t escritos __attribute__((aligned(TAM_LINEA_CACHE)));
+    uint32_t esperando_espacio;
+    uint64_t leidos __attribute__((aligned(TAM_LINEA_CACHE)));
+    uint32_t esperando_datos;
+    uint32_t cerrado;                      // el productor no va a escribir más
+    uint8_t datos[MEMORIA_CAPACIDAD] __attribute__((aligned(TAM_LINEA_CACHE)));
+} anillo_bytes_t;
+
+typedef struct {
+    uint32_t magia;
+    uint32_t listo;                        // el receptor adoptó el segmento (futex)
+    anillo_bytes_t solicitudes;
+    anillo_bytes_t respuestas;
+} memoria_t;
+
+// Productor: copia una trama entera o nada. Devuelve -1 si no cabe, 1 si el
+// consumidor estaba durmiendo (hay que avisarle) y 0 si no.
+int memoria_escribir(anillo_bytes_t *anillo, const void *datos, size_t largo);
+
+// Consumidor: copia hasta 'max' bytes y despierta al productor si esperaba
+// espacio. Devuelve cuántos copió.
+size_t memoria_leer(anillo_bytes_t *anillo, void *destino, size_t max);
+
+// Consumidor: anuncia que se va a dormir. Devuelve 0 si puede hacerlo y 1 si
+// mientras tanto llegaron datos y hay que seguir leyendo.
+int memoria_preparar_espera(anillo_bytes_t *anillo);
+
+// Esperas del cliente sobre un futex, como mucho MEMORIA_ESPERA_MS
+void memoria_esperar_datos(anillo_bytes_t *anillo);
+void memoria_esperar_espacio(anillo_bytes_t *anillo, size_t largo);
+
+// Productor: no habrá más datos; despierta al consumidor
+void memoria_cerrar(anillo_bytes_t *anillo);
+
+// Duerme mientras la palabra valga 'valor', como mucho MEMORIA_ESPERA_MS, y
+// despierta a quien duerme en ella (palabras de espera o 'listo')
+void memoria_esperar(uint32_t *palabra, uint32_t valor);
+void memoria_despertar(uint32_t *palabra);
+
+#endif // MEMORIA_H
@@ -0,0 +1,299 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: metricas.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Métricas del receptor (ver metricas.h). Como en la bitácora,
+ *              cada hilo tiene su bloque de histogramas, anotado en una lista
+ *              global la primera vez que mide, y es el único que lo escribe:
+ *              una medición son tres stores sin instrucciones atómicas de
+ *              lectura-modificación. Quien imprime suma los bloques con loads
+ *              atómicos; puede ver una medición a medias (la cantidad sí y la
+ *              suma todavía no), lo que no cambia los percentiles.
+ * =============================================================================
+ */
+
+#include "metricas.h"
+
+// Cubetas: los valores menores a SUBCUBETAS van uno por cubeta; desde ahí cada
+// potencia de dos se parte en SUBCUBETAS cubetas iguales
+#define BITS_SUBCUBETA 4
+#define SUBCUBETAS (1 << BITS_SUBCUBETA)
+#define MAX_EXPONENTE 40    // desde 2^41 ns (unos 36 minutos) todo va a la última
+#define NUM_CUBETAS ((MAX_EXPONENTE - BITS_SUBCUBETA + 2) * SUBCUBETAS)
+
+typedef struct metricas_hilo {
+    uint64_t cubetas[NUM_METRICAS][NUM_CUBETAS];
+    uint64_t suma[NUM_METRICAS];
+    uint64_t maximo[NUM_METRICAS];
+    struct metricas_hilo *siguiente;
+} metricas_hilo_t;
+
+// Histograma sumado de todos los hilos
+typedef struct {
+    uint64_t cubetas[NUM_CUBETAS];
+    uint64_t cantidad;
+    uint64_t suma;
+    uint64_t maximo;
+} histograma_t;
+
+static const char *NOMBRES[NUM_METRICAS] = {
+    "servicio prestar", "servicio renovar", "servicio devolver", "servicio lote",
+    "servicio vencidos", "servicio consultar", "servicio buscar",
+    "espera despacho", "espera anillo", "aplicar devolucion",
+    "espera franja", "tenencia franja", "envio respuesta", "rechazada"
+};
+
+int metricas_activas = 0;
+
+static metricas_hilo_t *hilos_metricas = NULL;
+static __thread metricas_hilo_t *metricas_propias = NULL;
+static uint64_t inicio_metricas;
+
+static char archivo_metricas[MAX_STRING];
+static char archivo_temporal[MAX_STRING + 8];
+static int segundos_entre_escrituras;
+static pthread_t hilo_metricas;
+static int hay_hilo_metricas = 0;
+static pthread_mutex_t metricas_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t metricas_cond = PTHREAD_COND_INITIALIZER;
+static int detener_metricas = 0;
+
+static int cubeta_de(uint64_t valor) {
+    if (valor < SUBCUBETAS) {
+        return (int)valor;
+    }
+    int exponente = 63 - __builtin_clzll(valor);
+    if (exponente > MAX_EXPONENTE) {
+        return NUM_CUBETAS - 1;
+    }
+    int sub = (int)(valor >> (exponente - BITS_SUBCUBETA)) & (SUBCUBETAS - 1);
+    return (exponente - BITS_SUBCUBETA + 1) * SUBCUBETAS + sub;
+}
+
+// Valor representativo de una cubeta: el punto medio de su rango
+static uint64_t valor_de(int cubeta) {
+    if (cubeta < SUBCUBETAS) {
+        return cubeta;
+    }
+    int desplazamiento = cubeta / SUBCUBETAS - 1;
+    uint64_t menor = (uint64_t)(SUBCUBETAS + cubeta % SUBCUBETAS) << desplazamiento;
+    return menor + ((1ull << desplazamiento) >> 1);
+}
+
+// Función para crear el bloque del hilo que llama y anotarlo en la lista
+static metricas_hilo_t *registrar_hilo(void) {
+    metricas_hilo_t *hilo = calloc(1, sizeof(metricas_hilo_t));
+    if (!hilo) {
+        return NULL;
+    }
+    hilo->siguiente = __atomic_load_n(&hilos_metricas, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&hilos_metricas, &hilo->siguiente, hilo, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    return hilo;
+}
+
+void metricas_registrar(metrica_t metrica, uint64_t inicio) {
+    if (!metricas_activas || inicio == 0) {
+        return;
+    }
+    if (!metricas_propias && !(metricas_propias = registrar_hilo())) {
+        return;
+    }
+    uint64_t valor = metricas_ahora() - inicio;
+    metricas_hilo_t *h = metricas_propias;
+    uint64_t *cubeta = &h->cubetas[metrica][cubeta_de(valor)];
+
+    __atomic_store_n(cubeta, *cubeta + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->suma[metrica], h->suma[metrica] + valor, __ATOMIC_RELAXED);
+    if (valor > h->maximo[metrica]) {
+        __atomic_store_n(&h->maximo[metrica], valor, __ATOMIC_RELAXED);
+    }
+}
+
+int metricas_de_operacion(operation_t operacion) {
+    switch (operacion) {
+        case OP_PRESTAR:   return MET_PRESTAR;
+        case OP_RENOVAR:   return MET_RENOVAR;
+        case OP_DEVOLVER:  return MET_DEVOLVER;
+        case OP_LOTE:      return MET_LOTE;
+        case OP_VENCIDOS:  return MET_VENCIDOS;
+        case OP_CONSULTAR: return MET_CONSULTAR;
+        case OP_BUSCAR:    return MET_BUSCAR;
+        default:           return -1;
+    }
+}
+
+// Función para sumar los bloques de todos los hilos
+static void sumar_hilos(histograma_t *histogramas) {
+    memset(histogramas, 0, NUM_METRICAS * sizeof(histograma_t));
+    metricas_hilo_t *h = __atomic_load_n(&hilos_metricas, __ATOMIC_ACQUIRE);
+    for (; h; h = h->siguiente) {
+        for (int m = 0; m < NUM_METRICAS; m++) {
+            histograma_t *total = &histogramas[m];
+            for (int c = 0; c < NUM_CUBETAS; c++) {
+                uint64_t n = __atomic_load_n(&h->cubetas[m][c], __ATOMIC_RELAXED);
+                total->cubetas[c] += n;
+                total->cantidad += n;
+            }
+            total->suma += __atomic_load_n(&h->suma[m], __ATOMIC_RELAXED);
+            uint64_t maximo = __atomic_load_n(&h->maximo[m], __ATOMIC_RELAXED);
+            if (maximo > total->maximo) {
+                total->maximo = maximo;
+            }
+        }
+    }
+}
+
+// Función para obtener el percentil p (entre 0 y 1) de un histograma en ns
+static uint64_t percentil(const histograma_t *h, double p) {
+    uint64_t objetivo = (uint64_t)(p * h->cantidad);
+    uint64_t acumulado = 0;
+    if (objetivo >= h->cantidad) {
+        objetivo = h->cantidad - 1;
+    }
+    for (int c = 0; c < NUM_CUBETAS; c++) {
+        acumulado += h->cubetas[c];
+        if (acumulado > objetivo) {
+            uint64_t valor = valor_de(c);
+            return valor < h->maximo ? valor : h->maximo;
+        }
+    }
+    return h->maximo;
+}
+
+// Función para escribir la tabla. Las tasas se calculan sobre 'segundos' con
+// las cantidades de 'anteriores' como punto de partida (NULL: desde cero).
+static void escribir_tabla(FILE *salida, const histograma_t *histogramas,
+                           const uint64_t *anteriores, double segundos) {
+    fprintf(salida, "%-20s %10s %10s %9s %9s %9s %9s %9s %9s\n", "metrica", "cantidad", "por seg",
+            "media us", "P50 us", "P90 us", "P99 us", "P99.9 us", "max us");
+    for (int m = 0; m < NUM_METRICAS; m++) {
+        const histograma_t *h = &histogramas[m];
+        uint64_t nuevas = h->cantidad - (anteriores ? anteriores[m] : 0);
+        double tasa = segundos > 0 ? nuevas / segundos : 0;
+
+        if (h->cantidad == 0) {
+            fprintf(salida, "%-20s %10d %10.1f %9s %9s %9s %9s %9s %9s\n", NOMBRES[m], 0, 0.0,
+                    "-", "-", "-", "-", "-", "-");
+            continue;
+        }
+        fprintf(salida, "%-20s %10llu %10.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", NOMBRES[m],
+                (unsigned long long)h->cantidad, tasa, (double)h->suma / h->cantidad / 1e3,
+                percentil(h, 0.50) / 1e3, percentil(h, 0.90) / 1e3, percentil(h, 0.99) / 1e3,
+                percentil(h, 0.999) / 1e3, h->maximo / 1e3);
+    }
+}
+
+void metricas_imprimir(FILE *salida) {
+    histograma_t *histogramas = malloc(NUM_METRICAS * sizeof(histograma_t));
+    if (!histogramas) {
+        fprintf(stderr, "Sin memoria para las métricas\n");
+        return;
+    }
+    sumar_hilos(histogramas);
+    double segundos = (metricas_ahora() - inicio_metricas) / 1e9;
+    fprintf(salida, "Métricas desde el arranque (hace %.1f s)\n", segundos);
+    escribir_tabla(salida, histogramas, NULL, segundos);
+    free(histogramas);
+}
+
+// Función para reescribir el archivo de estadísticas: las tasas son las del
+// intervalo desde la escritura anterior, los percentiles los de todo el período
+static void escribir_archivo(uint64_t *anteriores, uint64_t *momento_anterior) {
+    histograma_t *histogramas = malloc(NUM_METRICAS * sizeof(histograma_t));
+    if (!histogramas) {
+        return;
+    }
+    sumar_hilos(histogramas);
+    uint64_t ahora = metricas_ahora();
+
+    FILE *f = fopen(archivo_temporal, "w");
+    if (!f) {
+        perror("Error escribiendo estadísticas");
+        free(histogramas);
+        return;
+    }
+    time_t reloj = time(NULL);
+    struct tm tm_info;
+    char hora[32];
+    localtime_r(&reloj, &tm_info);
+    strftime(hora, sizeof(hora), "%d-%m-%Y %H:%M:%S", &tm_info);
+    fprintf(f, "Estadísticas del receptor %s (activo hace %.1f s, tasas de los últimos %.1f s)\n",
+            hora, (ahora - inicio_metricas) / 1e9, (ahora - *momento_anterior) / 1e9);
+    escribir_tabla(f, histogramas, anteriores, (ahora - *momento_anterior) / 1e9);
+    if (fclose(f) != 0 || rename(archivo_temporal, archivo_metricas) != 0) {
+        perror("Error escribiendo estadísticas");
+    }
+
+    for (int m = 0; m < NUM_METRICAS; m++) {
+        anteriores[m] = histogramas[m].cantidad;
+    }
+    *momento_anterior = ahora;
+    free(histogramas);
+}
+
+static void *hilo_escritor_metricas(void *arg) {
+    (void)arg;
+    uint64_t anteriores[NUM_METRICAS] = {0};
+    uint64_t momento_anterior = inicio_metricas;
+
+    pthread_mutex_lock(&metricas_mutex);
+    while (!detener_metricas) {
+        struct timespec limite;
+        clock_gettime(CLOCK_REALTIME, &limite);
+        limite.tv_sec += segundos_entre_escrituras;
+        pthread_cond_timedwait(&metricas_cond, &metricas_mutex, &limite);
+
+        pthread_mutex_unlock(&metricas_mutex);
+        escribir_archivo(anteriores, &momento_anterior);
+        pthread_mutex_lock(&metricas_mutex);
+    }
+    pthread_mutex_unlock(&metricas_mutex);
+    return NULL;
+}
+
+int metricas_iniciar(const char *archivo, int segundos) {
+    metricas_activas = 1;
+    inicio_metricas = metricas_ahora();
+    if (!archivo) {
+        return 0;
+    }
+
+    snprintf(archivo_metricas, sizeof(archivo_metricas), "%s", archivo);
+    snprintf(archivo_temporal, sizeof(archivo_temporal), "%s.tmp", archivo);
+    segundos_entre_escrituras = segundos;
+
+    detener_metricas = 0;
+    if (pthread_create(&hilo_metricas, NULL, hilo_escritor_metricas, NULL) != 0) {
+        fprintf(stderr, "Error creando el hilo de estadísticas\n");
+        return -1;
+    }
+    hay_hilo_metricas = 1;
+    return 0;
+}
+
+// Función para detener el hilo (que escribe el archivo una última vez) y
+// liberar los bloques. Se llama cuando los demás hilos ya terminaron.
+void metricas_detener(void) {
+    if (hay_hilo_metricas) {
+        pthread_mutex_lock(&metricas_mutex);
+        detener_metricas = 1;
+        pthread_cond_signal(&metricas_cond);
+        pthread_mutex_unlock(&metricas_mutex);
+        pthread_join(hilo_metricas, NULL);
+        hay_hilo_metricas = 0;
+    }
+
+    metricas_activas = 0;
+    metricas_hilo_t *h = hilos_metricas;
+    while (h) {
+        metricas_hilo_t *siguiente = h->siguiente;
+        free(h);
+        h = siguiente;
+    }
+    hilos_metricas = NULL;
+    metricas_propias = NULL;
+}
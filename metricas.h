@@ -0,0 +1,72 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: metricas.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Métricas de latencia y rendimiento del receptor. Cada medición
+ *              cae en un histograma logarítmico-lineal (16 subdivisiones por
+ *              potencia de dos, error relativo menor al 7%) del hilo que la
+ *              toma; la consola y el archivo de estadísticas suman los de todos
+ *              los hilos. Mientras no se llame metricas_iniciar las mediciones
+ *              no hacen nada, así los benchmarks del catálogo no las pagan.
+ * =============================================================================
+ */
+
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <stdint.h>
+
+#include "estructuras.h"
+
+#define METRICAS_SEGUNDOS_POR_DEFECTO 10
+
+typedef enum {
+    // Servicio por operación: desde que se lee la solicitud hasta que se
+    // escribe su respuesta (en una devolución, hasta el acuse)
+    MET_PRESTAR,
+    MET_RENOVAR,
+    MET_DEVOLVER,
+    MET_LOTE,
+    MET_VENCIDOS,
+    MET_CONSULTAR,
+    MET_BUSCAR,
+    // Etapas internas
+    MET_ESPERA_DESPACHO,    // desde que se lee hasta que la toma un trabajador del pool
+    MET_ESPERA_ANILLO,      // desde que se lee una devolución hasta que la saca un consumidor
+    MET_APLICAR_DEVOLUCION, // aplicar una devolución sacada del anillo
+    MET_ESPERA_FRANJA,      // esperando una franja para escritura
+    MET_TENENCIA_FRANJA,    // con una franja tomada para escritura
+    MET_ENVIO_RESPUESTA,    // codificar y escribir una respuesta
+    MET_RECHAZADA,          // solicitud rechazada por sobrecarga, hasta el aviso de ocupado
+    NUM_METRICAS
+} metrica_t;
+
+extern int metricas_activas;
+
+// Reloj monotónico en nanosegundos (0 si las métricas están apagadas)
+static inline uint64_t metricas_ahora(void) {
+    if (!metricas_activas) {
+        return 0;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Enciende las métricas. Con archivo != NULL, un hilo lo reescribe cada
+// 'segundos' (en un temporal que después se renombra).
+int metricas_iniciar(const char *archivo, int segundos);
+void metricas_detener(void);
+
+// Anota una duración en ns medida desde 'inicio' (un valor de metricas_ahora)
+void metricas_registrar(metrica_t metrica, uint64_t inicio);
+
+// Métrica de servicio de una operación (-1 si no tiene)
+int metricas_de_operacion(operation_t operacion);
+
+// Escribe la tabla de contadores y percentiles de todas las métricas
+void metricas_imprimir(FILE *salida);
+
+#endif // METRICAS_H
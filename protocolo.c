@@ -0,0 +1,717 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: protocolo.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Codificación y decodificación del protocolo descrito en
+ *              protocolo.h. Lo usan tanto el solicitante como el receptor.
+ *              El receptor distingue el formato de cada mensaje por su primer
+ *              byte: 0xB1 abre una trama binaria, mientras que una estructura
+ *              legada empieza con el carácter de la operación.
+ * =============================================================================
+ */
+
+#include "protocolo.h"
+
+// Tamaño fijo del cuerpo de una solicitud binaria sin el nombre
+#define CUERPO_SOLICITUD 15
+#define CUERPO_RESPUESTA 10
+#define CUERPO_LOTE 11
+#define CUERPO_LOTE_RESPUESTA 7
+#define OPERACION_LOTE 5
+#define RESULTADO_LOTE 5
+#define CUERPO_VENCIDOS 13
+#define CUERPO_VENCIDOS_RESPUESTA 8
+#define VENCIDO 12
+#define CUERPO_CONSULTA 11
+#define CUERPO_CONSULTA_RESPUESTA 7
+#define DISPONIBILIDAD 9
+#define CUERPO_BUSQUEDA_RESPUESTA 8
+#define ENCONTRADO 5
+
+static void escribir_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void escribir_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t leer_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t leer_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Función para leer exactamente n bytes (reintenta lecturas cortas)
+static int leer_completo(int fd, void *buf, size_t n) {
+    size_t leidos = 0;
+    while (leidos < n) {
+        ssize_t r = read(fd, (char *)buf + leidos, n - leidos);
+        if (r == -1 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return -1;
+        }
+        leidos += r;
+    }
+    return 0;
+}
+
+int resultado_exitoso(codigo_resultado_t codigo) {
+    return codigo < RES_NO_ENCONTRADO;
+}
+
+unsigned espera_reintento_us(int intento, unsigned *semilla) {
+    unsigned tope = intento < 16 ? REINTENTO_BASE_US << intento : REINTENTO_TOPE_US;
+    if (tope > REINTENTO_TOPE_US) {
+        tope = REINTENTO_TOPE_US;
+    }
+    return tope / 2 + rand_r(semilla) % (tope / 2 + 1);
+}
+
+// Función para armar el texto que ve el usuario a partir del código
+void formatear_mensaje(const respuesta_t *resp, char *buf, size_t largo) {
+    switch (resp->codigo) {
+        case RES_PRESTADO: {
+            char fecha[LARGO_FECHA];
+            fecha_a_texto(resp->fecha_devolucion, fecha);
+            snprintf(buf, largo, "Libro prestado exitosamente. Fecha de devolución: %s", fecha);
+            break;
+        }
+        case RES_RENOVADO:
+            snprintf(buf, largo, "Renovación exitosa");
+            break;
+        case RES_DEVOLUCION_RECIBIDA:
+            snprintf(buf, largo, "Libro recibido para devolución");
+            break;
+        case RES_SESION_ESTABLECIDA:
+            snprintf(buf, largo, "Sesión establecida");
+            break;
+        case RES_DEVUELTO:
+            snprintf(buf, largo, "Libro devuelto");
+            break;
+        case RES_DISPONIBILIDAD:
+            snprintf(buf, largo, "Disponibilidad consultada");
+            break;
+        case RES_BUSQUEDA:
+            snprintf(buf, largo, "Búsqueda realizada");
+            break;
+        case RES_NO_ENCONTRADO:
+            snprintf(buf, largo, "Libro no encontrado");
+            break;
+        case RES_SIN_DISPONIBLES:
+            snprintf(buf, largo, "No hay ejemplares disponibles");
+            break;
+        case RES_SIN_PRESTADOS:
+            snprintf(buf, largo, "No hay ejemplares prestados para renovar");
+            break;
+        case RES_NADA_QUE_DEVOLVER:
+            snprintf(buf, largo, "No hay ejemplares prestados para devolver");
+            break;
+        case RES_OCUPADO:
+            snprintf(buf, largo, "Receptor ocupado, reintente más tarde");
+            break;
+        default:
+            snprintf(buf, largo, "Error procesando la solicitud");
+            break;
+    }
+}
+
+// Función para recuperar el código de una respuesta legada a partir del texto
+static codigo_resultado_t codigo_desde_mensaje(const respuesta_legado_t *legado,
+                                               respuesta_t *resp) {
+    static const codigo_resultado_t codigos[] = {
+        RES_PRESTADO, RES_RENOVADO, RES_DEVOLUCION_RECIBIDA, RES_SESION_ESTABLECIDA,
+        RES_DEVUELTO, RES_NO_ENCONTRADO, RES_SIN_DISPONIBLES, RES_SIN_PRESTADOS,
+        RES_NADA_QUE_DEVOLVER, RES_OCUPADO
+    };
+    char texto[MAX_STRING];
+
+    for (size_t i = 0; i < sizeof(codigos) / sizeof(codigos[0]); i++) {
+        resp->codigo = codigos[i];
+        formatear_mensaje(resp, texto, sizeof(texto));
+        if (strcmp(texto, legado->mensaje) == 0) {
+            return codigos[i];
+        }
+    }
+    return RES_ERROR;
+}
+
+void lector_init(lector_t *lector) {
+    lector->inicio = 0;
+    lector->fin = 0;
+}
+
+// Función para dejar lugar al final del lector. Devuelve dónde escribir y
+// cuánto cabe; quien escribe avisa con lector_agregar.
+uint8_t *lector_espacio(lector_t *lector, size_t *espacio) {
+    if (lector->inicio > 0 && lector->inicio == lector->fin) {
+        lector->inicio = lector->fin = 0;
+    } else if (lector->fin == LECTOR_CAPACIDAD) {
+        memmove(lector->datos, lector->datos + lector->inicio, lector->fin - lector->inicio);
+        lector->fin -= lector->inicio;
+        lector->inicio = 0;
+    }
+    *espacio = LECTOR_CAPACIDAD - lector->fin;
+    return lector->datos + lector->fin;
+}
+
+void lector_agregar(lector_t *lector, size_t n) {
+    lector->fin += n;
+}
+
+// Función para leer del descriptor lo que haya disponible. Devuelve lo mismo
+// que read(); los bytes quedan acumulados hasta formar mensajes completos.
+ssize_t lector_llenar(lector_t *lector, int fd) {
+    size_t espacio;
+    uint8_t *destino = lector_espacio(lector, &espacio);
+    ssize_t n = read(fd, destino, espacio);
+    if (n > 0) {
+        lector_agregar(lector, n);
+    }
+    return n;
+}
+
+static int es_operacion(uint8_t c) {
+    return c == OP_DEVOLVER || c == OP_RENOVAR || c == OP_PRESTAR ||
+           c == OP_SALIR || c == OP_CONECTAR;
+}
+
+// Función para decodificar el cuerpo de una trama de solicitud
+static int decodificar_solicitud(const uint8_t *cuerpo, size_t largo, solicitud_t *sol) {
+    if (largo < CUERPO_SOLICITUD || cuerpo[0] != TRAMA_SOLICITUD ||
+        !(es_operacion(cuerpo[1]) || cuerpo[1] == OP_BUSCAR)) {
+        return 0;
+    }
+
+    size_t largo_nombre = cuerpo[14];
+    if (CUERPO_SOLICITUD + largo_nombre > largo) {
+        return 0;
+    }
+
+    sol->operacion = (operation_t)cuerpo[1];
+    sol->id_solicitud = leer_u32(cuerpo + 2);
+    sol->pid_solicitante = (int)leer_u32(cuerpo + 6);
+    sol->isbn = (int)leer_u32(cuerpo + 10);
+    memcpy(sol->nombre_libro, cuerpo + CUERPO_SOLICITUD, largo_nombre);
+    sol->nombre_libro[largo_nombre] = '\0';
+    sol->formato = FORMATO_BINARIO;
+    sol->sesion = -1;
+    sol->sesion_gen = 0;
+    sol->lote = NULL;
+    return 1;
+}
+
+// Función para decodificar una trama de lote. Las operaciones se copian a un
+// lote_t reservado aquí; lo libera quien procese la solicitud.
+static int decodificar_lote(const uint8_t *cuerpo, size_t largo, solicitud_t *sol) {
+    if (largo < CUERPO_LOTE || cuerpo[0] != TRAMA_LOTE) {
+        return 0;
+    }
+
+    size_t n = leer_u16(cuerpo + 9);
+    if (n == 0 || n > MAX_LOTE || CUERPO_LOTE + n * OPERACION_LOTE > largo) {
+        return 0;
+    }
+
+    lote_t *lote = malloc(sizeof(lote_t));
+    if (!lote) {
+        fprintf(stderr, "Sin memoria para un lote de %zu operaciones\n", n);
+        return 0;
+    }
+    lote->num = (int)n;
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *op = cuerpo + CUERPO_LOTE + i * OPERACION_LOTE;
+        lote->ops[i].operacion = (operation_t)op[0];
+        lote->ops[i].isbn = (int)leer_u32(op + 1);
+    }
+
+    memset(sol, 0, sizeof(*sol));
+    sol->operacion = OP_LOTE;
+    sol->id_solicitud = leer_u32(cuerpo + 1);
+    sol->pid_solicitante = (int)leer_u32(cuerpo + 5);
+    sol->isbn = lote->ops[0].isbn;  // de referencia: se despacha por todos (ver receptor.c)
+    sol->formato = FORMATO_BINARIO;
+    sol->sesion = -1;
+    sol->lote = lote;
+    return 1;
+}
+
+// Función para decodificar una consulta de disponibilidad. Los ISBN se copian
+// a un consulta_t reservado aquí; lo libera quien procese la solicitud.
+static int decodificar_consulta(const uint8_t *cuerpo, size_t largo, solicitud_t *sol) {
+    if (largo < CUERPO_CONSULTA || cuerpo[0] != TRAMA_CONSULTA) {
+        return 0;
+    }
+
+    size_t n = leer_u16(cuerpo + 9);
+    if (n == 0 || n > MAX_CONSULTA || CUERPO_CONSULTA + n * 4 > largo) {
+        return 0;
+    }
+
+    consulta_t *consulta = malloc(sizeof(consulta_t));
+    if (!consulta) {
+        fprintf(stderr, "Sin memoria para una consulta de %zu ISBN\n", n);
+        return 0;
+    }
+    consulta->num = (int)n;
+    for (size_t i = 0; i < n; i++) {
+        consulta->isbn[i] = (int)leer_u32(cuerpo + CUERPO_CONSULTA + i * 4);
+    }
+
+    memset(sol, 0, sizeof(*sol));
+    sol->operacion = OP_CONSULTAR;
+    sol->id_solicitud = leer_u32(cuerpo + 1);
+    sol->pid_solicitante = (int)leer_u32(cuerpo + 5);
+    sol->isbn = consulta->isbn[0];  // se despacha por su primer ISBN
+    sol->formato = FORMATO_BINARIO;
+    sol->sesion = -1;
+    sol->consulta = consulta;
+    return 1;
+}
+
+// Función para decodificar una consulta de vencidos
+static int decodificar_vencidos(const uint8_t *cuerpo, size_t largo, solicitud_t *sol) {
+    if (largo < CUERPO_VENCIDOS || cuerpo[0] != TRAMA_VENCIDOS) {
+        return 0;
+    }
+
+    memset(sol, 0, sizeof(*sol));
+    sol->operacion = OP_VENCIDOS;
+    sol->id_solicitud = leer_u32(cuerpo + 1);
+    sol->pid_solicitante = (int)leer_u32(cuerpo + 5);
+    sol->fecha_corte = fecha_de_aaaammdd(leer_u32(cuerpo + 9));
+    sol->formato = FORMATO_BINARIO;
+    sol->sesion = -1;
+    return 1;
+}
+
+// Función para extraer la siguiente solicitud completa del lector. Devuelve 1
+// si la obtuvo y 0 si faltan bytes. Los bytes que no forman un mensaje válido
+// se descartan uno a uno hasta volver a sincronizar.
+int lector_siguiente_solicitud(lector_t *lector, solicitud_t *sol) {
+    while (lector->fin > lector->inicio) {
+        const uint8_t *p = lector->datos + lector->inicio;
+        size_t disponibles = lector->fin - lector->inicio;
+
+        if (p[0] == PROTO_MAGIA) {
+            if (disponibles < PROTO_CABECERA) {
+                return 0;
+            }
+            size_t largo = leer_u16(p + 2);
+            if (p[1] != PROTO_VERSION || largo == 0 || largo > PROTO_MAX_TRAMA - PROTO_CABECERA) {
+                lector->inicio++;
+                continue;
+            }
+            if (disponibles < PROTO_CABECERA + largo) {
+                return 0;
+            }
+            lector->inicio += PROTO_CABECERA + largo;
+            if (decodificar_solicitud(p + PROTO_CABECERA, largo, sol) ||
+                decodificar_lote(p + PROTO_CABECERA, largo, sol) ||
+                decodificar_vencidos(p + PROTO_CABECERA, largo, sol) ||
+                decodificar_consulta(p + PROTO_CABECERA, largo, sol)) {
+                return 1;
+            }
+            fprintf(stderr, "Trama de solicitud inválida descartada\n");
+        } else if (es_operacion(p[0]) && (disponibles < 4 || (p[1] == 0 && p[2] == 0 && p[3] == 0))) {
+            if (disponibles < sizeof(solicitud_legado_t)) {
+                return 0;
+            }
+            solicitud_legado_t legado;
+            memcpy(&legado, p, sizeof(legado));
+            lector->inicio += sizeof(legado);
+
+            memset(sol, 0, sizeof(*sol));
+            sol->operacion = (operation_t)legado.operacion;
+            memcpy(sol->nombre_libro, legado.nombre_libro, MAX_STRING);
+            sol->nombre_libro[MAX_STRING - 1] = '\0';
+            sol->isbn = legado.isbn;
+            sol->pid_solicitante = legado.pid_solicitante;
+            sol->formato = FORMATO_LEGADO;
+            sol->sesion = -1;
+            return 1;
+        } else {
+            lector->inicio++;
+        }
+    }
+    return 0;
+}
+
+// Función para codificar una solicitud de lote (solo formato binario)
+static size_t codificar_lote(const solicitud_t *sol, uint8_t *buf) {
+    const lote_t *lote = sol->lote;
+    size_t largo = CUERPO_LOTE + (size_t)lote->num * OPERACION_LOTE;
+    uint8_t *c = buf + PROTO_CABECERA;
+
+    buf[0] = PROTO_MAGIA;
+    buf[1] = PROTO_VERSION;
+    escribir_u16(buf + 2, (uint16_t)largo);
+    c[0] = TRAMA_LOTE;
+    escribir_u32(c + 1, sol->id_solicitud);
+    escribir_u32(c + 5, (uint32_t)sol->pid_solicitante);
+    escribir_u16(c + 9, (uint16_t)lote->num);
+    for (int i = 0; i < lote->num; i++) {
+        uint8_t *op = c + CUERPO_LOTE + i * OPERACION_LOTE;
+        op[0] = (uint8_t)lote->ops[i].operacion;
+        escribir_u32(op + 1, (uint32_t)lote->ops[i].isbn);
+    }
+    return PROTO_CABECERA + largo;
+}
+
+// Función para codificar una consulta de disponibilidad (solo formato binario)
+static size_t codificar_consulta(const solicitud_t *sol, uint8_t *buf) {
+    const consulta_t *consulta = sol->consulta;
+    size_t largo = CUERPO_CONSULTA + (size_t)consulta->num * 4;
+    uint8_t *c = buf + PROTO_CABECERA;
+
+    buf[0] = PROTO_MAGIA;
+    buf[1] = PROTO_VERSION;
+    escribir_u16(buf + 2, (uint16_t)largo);
+    c[0] = TRAMA_CONSULTA;
+    escribir_u32(c + 1, sol->id_solicitud);
+    escribir_u32(c + 5, (uint32_t)sol->pid_solicitante);
+    escribir_u16(c + 9, (uint16_t)consulta->num);
+    for (int i = 0; i < consulta->num; i++) {
+        escribir_u32(c + CUERPO_CONSULTA + i * 4, (uint32_t)consulta->isbn[i]);
+    }
+    return PROTO_CABECERA + largo;
+}
+
+// Función para codificar una consulta de vencidos (solo formato binario)
+static size_t codificar_vencidos(const solicitud_t *sol, uint8_t *buf) {
+    uint8_t *c = buf + PROTO_CABECERA;
+
+    buf[0] = PROTO_MAGIA;
+    buf[1] = PROTO_VERSION;
+    escribir_u16(buf + 2, CUERPO_VENCIDOS);
+    c[0] = TRAMA_VENCIDOS;
+    escribir_u32(c + 1, sol->id_solicitud);
+    escribir_u32(c + 5, (uint32_t)sol->pid_solicitante);
+    escribir_u32(c + 9, fecha_a_aaaammdd(sol->fecha_corte));
+    return PROTO_CABECERA + CUERPO_VENCIDOS;
+}
+
+// Función para codificar una solicitud. Devuelve los bytes escritos en buf.
+size_t protocolo_codificar_solicitud(const solicitud_t *sol, formato_t formato, uint8_t *buf) {
+    if (sol->operacion == OP_LOTE) {
+        return codificar_lote(sol, buf);
+    }
+    if (sol->operacion == OP_VENCIDOS) {
+        return codificar_vencidos(sol, buf);
+    }
+    if (sol->operacion == OP_CONSULTAR) {
+        return codificar_consulta(sol, buf);
+    }
+    if (formato == FORMATO_LEGADO) {
+        solicitud_legado_t legado;
+        memset(&legado, 0, sizeof(legado));
+        legado.operacion = sol->operacion;
+        snprintf(legado.nombre_libro, sizeof(legado.nombre_libro), "%s", sol->nombre_libro);
+        legado.isbn = sol->isbn;
+        legado.pid_solicitante = sol->pid_solicitante;
+        memcpy(buf, &legado, sizeof(legado));
+        return sizeof(legado);
+    }
+
+    size_t largo_nombre = strnlen(sol->nombre_libro, 255);
+    size_t largo = CUERPO_SOLICITUD + largo_nombre;
+    uint8_t *c = buf + PROTO_CABECERA;
+
+    buf[0] = PROTO_MAGIA;
+    buf[1] = PROTO_VERSION;
+    escribir_u16(buf + 2, (uint16_t)largo);
+    c[0] = TRAMA_SOLICITUD;
+    c[1] = (uint8_t)sol->operacion;
+    escribir_u32(c + 2, sol->id_solicitud);
+    escribir_u32(c + 6, (uint32_t)sol->pid_solicitante);
+    escribir_u32(c + 10, (uint32_t)sol->isbn);
+    c[14] = (uint8_t)largo_nombre;
+    memcpy(c + CUERPO_SOLICITUD, sol->nombre_libro, largo_nombre);
+    return PROTO_CABECERA + largo;
+}
+
+// Función para codificar una respuesta. Devuelve los bytes escritos en buf.
+size_t protocolo_codificar_respuesta(const respuesta_t *resp, formato_t formato, uint8_t *buf) {
+    if (formato == FORMATO_LEGADO) {
+        respuesta_legado_t legado;
+        memset(&legado, 0, sizeof(legado));
+        legado.exito = resultado_exitoso(resp->codigo);
+        formatear_mensaje(resp, legado.mensaje, sizeof(legado.mensaje));
+        fecha_a_texto(resp->fecha_devolucion, legado.fecha_devolucion);
+        memcpy(buf, &legado, sizeof(legado));
+        return sizeof(legado);
+    }
+
+    uint8_t *c = buf + PROTO_CABECERA;
+    buf[0] = PROTO_MAGIA;
+    buf[1] = PROTO_VERSION;
+
+    if (resp->vencidos) {
+        size_t largo = CUERPO_VENCIDOS_RESPUESTA + (size_t)resp->num_vencidos * VENCIDO;
+        escribir_u16(buf + 2, (uint16_t)largo);
+        c[0] = TRAMA_VENCIDOS_RESPUESTA;
+        escribir_u32(c + 1, resp->id_solicitud);
+        c[5] = (uint8_t)(resp->ultimo_tramo != 0);
+        escribir_u16(c + 6, (uint16_t)resp->num_vencidos);
+        for (int i = 0; i < resp->num_vencidos; i++) {
+            uint8_t *v = c + CUERPO_VENCIDOS_RESPUESTA + i * VENCIDO;
+            escribir_u32(v, (uint32_t)resp->vencidos[i].isbn);
+            escribir_u32(v + 4, (uint32_t)resp->vencidos[i].ejemplar);
+            escribir_u32(v + 8, fecha_a_aaaammdd(resp->vencidos[i].fecha));
+        }
+        return PROTO_CABECERA + largo;
+    }
+
+    if (resp->encontrados) {
+        size_t largo = CUERPO_BUSQUEDA_RESPUESTA;
+        int n = 0;
+        c[0] = TRAMA_BUSQUEDA_RESPUESTA;
+        escribir_u32(c + 1, resp->id_solicitud);
+        for (; n < resp->num_encontrados; n++) {
+            size_t largo_nombre = strnlen(resp->encontrados[n].nombre, 255);
+            if (PROTO_CABECERA + largo + ENCONTRADO + largo_nombre > PROTO_MAX_TRAMA) {
+                break;
+            }
+            uint8_t *e = c + largo;
+            escribir_u32(e, (uint32_t)resp->encontrados[n].isbn);
+            e[4] = (uint8_t)largo_nombre;
+            memcpy(e + ENCONTRADO, resp->encontrados[n].nombre, largo_nombre);
+            largo += ENCONTRADO + largo_nombre;
+        }
+        c[5] = (uint8_t)(resp->hay_mas || n < resp->num_encontrados);
+        escribir_u16(c + 6, (uint16_t)n);
+        escribir_u16(buf + 2, (uint16_t)largo);
+        return PROTO_CABECERA + largo;
+    }
+
+    if (resp->disponibilidades) {
+        size_t largo = CUERPO_CONSULTA_RESPUESTA + (size_t)resp->num_disponibilidades * DISPONIBILIDAD;
+        escribir_u16(buf + 2, (uint16_t)largo);
+        c[0] = TRAMA_CONSULTA_RESPUESTA;
+        escribir_u32(c + 1, resp->id_solicitud);
+        escribir_u16(c + 5, (uint16_t)resp->num_disponibilidades);
+        for (int i = 0; i < resp->num_disponibilidades; i++) {
+            uint8_t *d = c + CUERPO_CONSULTA_RESPUESTA + i * DISPONIBILIDAD;
+            d[0] = (uint8_t)resp->disponibilidades[i].codigo;
+            escribir_u32(d + 1, (uint32_t)resp->disponibilidades[i].disponibles);
+            escribir_u32(d + 5, (uint32_t)resp->disponibilidades[i].prestados);
+        }
+        return PROTO_CABECERA + largo;
+    }
+
+    if (resp->resultados) {
+        size_t largo = CUERPO_LOTE_RESPUESTA + (size_t)resp->num_resultados * RESULTADO_LOTE;
+        escribir_u16(buf + 2, (uint16_t)largo);
+        c[0] = TRAMA_LOTE_RESPUESTA;
+        escribir_u32(c + 1, resp->id_solicitud);
+        escribir_u16(c + 5, (uint16_t)resp->num_resultados);
+        for (int i = 0; i < resp->num_resultados; i++) {
+            uint8_t *r = c + CUERPO_LOTE_RESPUESTA + i * RESULTADO_LOTE;
+            r[0] = (uint8_t)resp->resultados[i].codigo;
+            escribir_u32(r + 1, fecha_a_aaaammdd(resp->resultados[i].fecha_devolucion));
+        }
+        return PROTO_CABECERA + largo;
+    }
+
+    escribir_u16(buf + 2, CUERPO_RESPUESTA);
+    c[0] = TRAMA_RESPUESTA;
+    c[1] = (uint8_t)resp->codigo;
+    escribir_u32(c + 2, resp->id_solicitud);
+    escribir_u32(c + 6, fecha_a_aaaammdd(resp->fecha_devolucion));
+    return PROTO_CABECERA + CUERPO_RESPUESTA;
+}
+
+// Función para decodificar una respuesta completa (trama binaria con su
+// cabecera ya validada, o estructura legada). Si es la de un lote, los
+// resultados se copian en resp->resultados, que debe apuntar a un arreglo de
+// MAX_LOTE elementos puesto por quien llama; si es un tramo de vencidos, van a
+// resp->vencidos (VENCIDOS_POR_TRAMA elementos), y si es la de una consulta, a
+// resp->disponibilidades (MAX_CONSULTA elementos); los de una búsqueda, a
+// resp->encontrados (MAX_ENCONTRADOS elementos).
+static int decodificar_respuesta(const uint8_t *trama, formato_t formato, respuesta_t *resp) {
+    resultado_lote_t *resultados = resp->resultados;
+    vencido_t *vencidos = resp->vencidos;
+    disponibilidad_t *disponibilidades = resp->disponibilidades;
+    libro_encontrado_t *encontrados = resp->encontrados;
+    memset(resp, 0, sizeof(*resp));
+
+    if (formato == FORMATO_LEGADO) {
+        respuesta_legado_t legado;
+        memcpy(&legado, trama, sizeof(legado));
+        legado.mensaje[MAX_STRING - 1] = '\0';
+        legado.fecha_devolucion[sizeof(legado.fecha_devolucion) - 1] = '\0';
+        resp->fecha_devolucion = fecha_de_texto(legado.fecha_devolucion,
+                                                strlen(legado.fecha_devolucion));
+        resp->codigo = codigo_desde_mensaje(&legado, resp);
+        return 0;
+    }
+
+    size_t largo = leer_u16(trama + 2);
+    const uint8_t *c = trama + PROTO_CABECERA;
+    if (largo >= CUERPO_LOTE_RESPUESTA && c[0] == TRAMA_LOTE_RESPUESTA) {
+        size_t n = leer_u16(c + 5);
+        if (!resultados || n > MAX_LOTE || CUERPO_LOTE_RESPUESTA + n * RESULTADO_LOTE > largo) {
+            fprintf(stderr, "Trama de respuesta de lote inválida\n");
+            return -1;
+        }
+        resp->id_solicitud = leer_u32(c + 1);
+        resp->codigo = RES_ERROR;
+        resp->num_resultados = (int)n;
+        resp->resultados = resultados;
+        for (size_t i = 0; i < n; i++) {
+            const uint8_t *r = c + CUERPO_LOTE_RESPUESTA + i * RESULTADO_LOTE;
+            resultados[i].codigo = (codigo_resultado_t)r[0];
+            resultados[i].fecha_devolucion = fecha_de_aaaammdd(leer_u32(r + 1));
+        }
+        return 0;
+    }
+    if (largo >= CUERPO_VENCIDOS_RESPUESTA && c[0] == TRAMA_VENCIDOS_RESPUESTA) {
+        size_t n = leer_u16(c + 6);
+        if (!vencidos || n > VENCIDOS_POR_TRAMA ||
+            CUERPO_VENCIDOS_RESPUESTA + n * VENCIDO > largo) {
+            fprintf(stderr, "Trama de vencidos inválida\n");
+            return -1;
+        }
+        resp->id_solicitud = leer_u32(c + 1);
+        resp->codigo = RES_ERROR;
+        resp->ultimo_tramo = c[5];
+        resp->num_vencidos = (int)n;
+        resp->vencidos = vencidos;
+        for (size_t i = 0; i < n; i++) {
+            const uint8_t *v = c + CUERPO_VENCIDOS_RESPUESTA + i * VENCIDO;
+            vencidos[i].isbn = (int)leer_u32(v);
+            vencidos[i].ejemplar = (int)leer_u32(v + 4);
+            vencidos[i].fecha = fecha_de_aaaammdd(leer_u32(v + 8));
+        }
+        return 0;
+    }
+    if (largo >= CUERPO_CONSULTA_RESPUESTA && c[0] == TRAMA_CONSULTA_RESPUESTA) {
+        size_t n = leer_u16(c + 5);
+        if (!disponibilidades || n > MAX_CONSULTA ||
+            CUERPO_CONSULTA_RESPUESTA + n * DISPONIBILIDAD > largo) {
+            fprintf(stderr, "Trama de respuesta de consulta inválida\n");
+            return -1;
+        }
+        resp->id_solicitud = leer_u32(c + 1);
+        resp->codigo = RES_DISPONIBILIDAD;
+        resp->num_disponibilidades = (int)n;
+        resp->disponibilidades = disponibilidades;
+        for (size_t i = 0; i < n; i++) {
+            const uint8_t *d = c + CUERPO_CONSULTA_RESPUESTA + i * DISPONIBILIDAD;
+            disponibilidades[i].codigo = (codigo_resultado_t)d[0];
+            disponibilidades[i].disponibles = (int)leer_u32(d + 1);
+            disponibilidades[i].prestados = (int)leer_u32(d + 5);
+        }
+        return 0;
+    }
+    if (largo >= CUERPO_BUSQUEDA_RESPUESTA && c[0] == TRAMA_BUSQUEDA_RESPUESTA) {
+        size_t n = leer_u16(c + 6);
+        if (!encontrados || n > MAX_ENCONTRADOS) {
+            fprintf(stderr, "Trama de respuesta de búsqueda inválida\n");
+            return -1;
+        }
+        size_t pos = CUERPO_BUSQUEDA_RESPUESTA;
+        for (size_t i = 0; i < n; i++) {
+            if (pos + ENCONTRADO > largo || pos + ENCONTRADO + c[pos + 4] > largo) {
+                fprintf(stderr, "Trama de respuesta de búsqueda inválida\n");
+                return -1;
+            }
+            encontrados[i].isbn = (int)leer_u32(c + pos);
+            memcpy(encontrados[i].nombre, c + pos + ENCONTRADO, c[pos + 4]);
+            encontrados[i].nombre[c[pos + 4]] = '\0';
+            pos += ENCONTRADO + c[pos + 4];
+        }
+        resp->id_solicitud = leer_u32(c + 1);
+        resp->codigo = RES_BUSQUEDA;
+        resp->hay_mas = c[5];
+        resp->num_encontrados = (int)n;
+        resp->encontrados = encontrados;
+        return 0;
+    }
+    if (largo < CUERPO_RESPUESTA || c[0] != TRAMA_RESPUESTA) {
+        fprintf(stderr, "Trama de respuesta inválida\n");
+        return -1;
+    }
+    resp->codigo = (codigo_resultado_t)c[1];
+    resp->id_solicitud = leer_u32(c + 2);
+    resp->fecha_devolucion = fecha_de_aaaammdd(leer_u32(c + 6));
+    return 0;
+}
+
+// Función para comprobar la cabecera de una respuesta binaria
+static int cabecera_respuesta_valida(const uint8_t *p) {
+    if (p[0] != PROTO_MAGIA || p[1] != PROTO_VERSION ||
+        leer_u16(p + 2) > PROTO_MAX_TRAMA - PROTO_CABECERA) {
+        fprintf(stderr, "Trama de respuesta inválida\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Función para leer una respuesta completa del pipe de sesión (ver
+// decodificar_respuesta para los arreglos que debe traer resp)
+int protocolo_leer_respuesta(int fd, formato_t formato, respuesta_t *resp) {
+    uint8_t buf[PROTO_MAX_TRAMA];
+
+    if (formato == FORMATO_LEGADO) {
+        if (leer_completo(fd, buf, sizeof(respuesta_legado_t)) != 0) {
+            return -1;
+        }
+    } else if (leer_completo(fd, buf, PROTO_CABECERA) != 0 || !cabecera_respuesta_valida(buf) ||
+               leer_completo(fd, buf + PROTO_CABECERA, leer_u16(buf + 2)) != 0) {
+        return -1;
+    }
+    return decodificar_respuesta(buf, formato, resp);
+}
+
+// Función para extraer la siguiente respuesta completa del lector. Devuelve 1
+// si la obtuvo, 0 si faltan bytes y -1 si la trama es inválida.
+int lector_siguiente_respuesta(lector_t *lector, formato_t formato, respuesta_t *resp) {
+    const uint8_t *p = lector->datos + lector->inicio;
+    size_t disponibles = lector->fin - lector->inicio;
+    size_t largo = sizeof(respuesta_legado_t);
+
+    if (formato != FORMATO_LEGADO) {
+        if (disponibles < PROTO_CABECERA) {
+            return 0;
+        }
+        if (!cabecera_respuesta_valida(p)) {
+            return -1;
+        }
+        largo = PROTO_CABECERA + leer_u16(p + 2);
+    }
+    if (disponibles < largo) {
+        return 0;
+    }
+    lector->inicio += largo;
+    return decodificar_respuesta(p, formato, resp) == 0 ? 1 : -1;
+}
+
+// Función para leer una respuesta a través de un lector: un read() trae de una
+// vez todas las respuestas que el receptor haya escrito juntas
+int lector_leer_respuesta(lector_t *lector, int fd, formato_t formato, respuesta_t *resp) {
+    for (;;) {
+        int r = lector_siguiente_respuesta(lector, formato, resp);
+        if (r != 0) {
+            return r == 1 ? 0 : -1;
+        }
+        ssize_t n = lector_llenar(lector, fd);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+    }
+}
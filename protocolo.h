@@ -0,0 +1,112 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: protocolo.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Protocolo de comunicación entre solicitante y receptor.
+ *              Formato binario (v1): tramas con prefijo de longitud, campos
+ *              enteros en little-endian, título de largo variable y códigos de
+ *              resultado numéricos. Formato legado: las estructuras fijas
+ *              originales de 268/272 bytes, que el receptor sigue aceptando.
+ *
+ *   Trama:      magia(1)=0xB1  version(1)  largo(2)  cuerpo(largo)
+ *   Solicitud:  tipo(1)=1  operacion(1)  id(4)  pid(4)  isbn(4)
+ *               largo_nombre(1)  nombre(largo_nombre)
+ *   Respuesta:  tipo(1)=2  codigo(1)  id(4)  fecha(4, aaaammdd o 0)
+ *   Lote:       tipo(1)=3  id(4)  pid(4)  n(2)  n x [operacion(1) isbn(4)]
+ *   Resp. lote: tipo(1)=4  id(4)  n(2)  n x [codigo(1) fecha(4)]
+ *   Vencidos:   tipo(1)=5  id(4)  pid(4)  fecha_corte(4, aaaammdd o 0 = hoy)
+ *   Resp. venc.: tipo(1)=6  id(4)  ultimo(1)  n(2)  n x [isbn(4) ejemplar(4) fecha(4)]
+ *               (la lista puede ocupar varias tramas; la última lleva ultimo=1)
+ *   Consulta:   tipo(1)=7  id(4)  pid(4)  n(2)  n x [isbn(4)]
+ *   Resp. cons.: tipo(1)=8  id(4)  n(2)  n x [codigo(1) disponibles(4) prestados(4)]
+ *   Búsqueda:   una solicitud con operacion='B' y el texto en el nombre
+ *   Resp. busq.: tipo(1)=9  id(4)  mas(1)  n(2)  n x [isbn(4) largo(1) nombre(largo)]
+ *               (van los títulos que caben en la trama; si faltan, mas=1)
+ * =============================================================================
+ */
+
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include <stdint.h>
+
+#include "estructuras.h"
+
+#define PROTO_MAGIA 0xB1
+#define PROTO_VERSION 1
+#define PROTO_CABECERA 4
+#define PROTO_MAX_TRAMA 4096      // no supera PIPE_BUF: cada write es atómico
+
+// Tipos de trama
+#define TRAMA_SOLICITUD 1
+#define TRAMA_RESPUESTA 2
+#define TRAMA_LOTE 3
+#define TRAMA_LOTE_RESPUESTA 4
+#define TRAMA_VENCIDOS 5
+#define TRAMA_VENCIDOS_RESPUESTA 6
+#define TRAMA_CONSULTA 7
+#define TRAMA_CONSULTA_RESPUESTA 8
+#define TRAMA_BUSQUEDA_RESPUESTA 9
+
+// Vencidos que caben en una trama de respuesta
+#define VENCIDOS_POR_TRAMA 340
+
+// Estructuras fijas del formato legado (tal como viajaban originalmente)
+typedef struct {
+    int operacion;
+    char nombre_libro[MAX_STRING];
+    int isbn;
+    int pid_solicitante;
+} solicitud_legado_t;
+
+typedef struct {
+    int exito;
+    char mensaje[MAX_STRING];
+    char fecha_devolucion[12];
+} respuesta_legado_t;
+
+// Lector de tramas sobre un descriptor: acumula bytes entre llamadas a read()
+// y entrega mensajes completos aunque lleguen partidos.
+#define LECTOR_CAPACIDAD 65536
+
+typedef struct {
+    uint8_t datos[LECTOR_CAPACIDAD];
+    size_t inicio;
+    size_t fin;
+} lector_t;
+
+void lector_init(lector_t *lector);
+ssize_t lector_llenar(lector_t *lector, int fd);
+int lector_siguiente_solicitud(lector_t *lector, solicitud_t *sol);
+
+// Para llenar el lector desde otra fuente (recvmsg, memoria compartida)
+uint8_t *lector_espacio(lector_t *lector, size_t *espacio);
+void lector_agregar(lector_t *lector, size_t n);
+
+// Codificación
+size_t protocolo_codificar_solicitud(const solicitud_t *sol, formato_t formato, uint8_t *buf);
+size_t protocolo_codificar_respuesta(const respuesta_t *resp, formato_t formato, uint8_t *buf);
+int protocolo_leer_respuesta(int fd, formato_t formato, respuesta_t *resp);
+
+// Igual, pero acumulando en un lector: varias respuestas por read()
+int lector_leer_respuesta(lector_t *lector, int fd, formato_t formato, respuesta_t *resp);
+
+// Sin leer: 1 si había una respuesta completa en el lector, 0 si faltan bytes,
+// -1 si la trama es inválida
+int lector_siguiente_respuesta(lector_t *lector, formato_t formato, respuesta_t *resp);
+
+// Textos para mostrar al usuario
+int resultado_exitoso(codigo_resultado_t codigo);
+void formatear_mensaje(const respuesta_t *resp, char *buf, size_t largo);
+
+// Espera antes de reintentar una solicitud rechazada con RES_OCUPADO: se
+// duplica en cada intento (desde 0) hasta el tope y se elige al azar entre la
+// mitad y el total, para que los clientes rechazados a la vez no vuelvan juntos
+#define REINTENTO_BASE_US 2000
+#define REINTENTO_TOPE_US 500000
+
+unsigned espera_reintento_us(int intento, unsigned *semilla);
+
+#endif // PROTOCOLO_H
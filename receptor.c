@@ -10,21 +10,32 @@
  * Funcionalidades:
  *   - Gestión de base de datos de libros
  *   - Procesamiento concurrente de solicitudes
- *   - Buffer circular para renovaciones/devoluciones
+ *   - Cola sin bloqueos para devoluciones
  *   - Generación de reportes
- *   - Comunicación por pipes nombrados
+ *   - Métricas de latencia y rendimiento
+ *   - Comunicación por pipes nombrados con un bucle de eventos (epoll)
  * =============================================================================
  */
+#include <poll.h>
+#include <sys/socket.h>
+
 #include "estructuras.h"
+#include "catalogo.h"
+#include "despacho.h"
+#include "sesiones.h"
+#include "protocolo.h"
+#include "anillo.h"
+#include "wal.h"
+#include "instantanea.h"
+#include "bitacora.h"
+#include "vencimientos.h"
+#include "busqueda.h"
+#include "metricas.h"
+#include "eventos.h"
+#include "conexiones.h"
 
 // Variables globales
-libro_t biblioteca[MAX_BOOKS];
-int num_libros = 0;
-circular_buffer_t buffer_renovaciones;
-reporte_entry_t reportes[1000];
-int num_reportes = 0;
-pthread_mutex_t bd_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t reporte_mutex = PTHREAD_MUTEX_INITIALIZER;
+anillo_t buffer_devoluciones;
 int verbose_mode = 0;
 int terminar_programa = 0;
 
@@ -32,27 +43,32 @@ char pipe_name[MAX_STRING];
 char archivo_datos[MAX_STRING];
 char archivo_salida[MAX_STRING];
 int usar_archivo_salida = 0;
-
-// Implementación de funciones comunes
-void obtener_fecha_actual(char *fecha) {
-    time_t t = time(NULL);
-    struct tm *tm_info = localtime(&t);
-    strftime(fecha, 12, "%d-%m-%Y", tm_info);
-}
-
-void agregar_dias_fecha(char *fecha, int dias) {
-    struct tm tm_fecha = {0};
-    sscanf(fecha, "%d-%d-%d", &tm_fecha.tm_mday, &tm_fecha.tm_mon, &tm_fecha.tm_year);
-    tm_fecha.tm_mon--; // tm_mon es 0-11
-    tm_fecha.tm_year -= 1900; // tm_year desde 1900
-
-    time_t tiempo = mktime(&tm_fecha);
-    tiempo += dias * 24 * 60 * 60; // agregar días
-
-    struct tm *nueva_fecha = localtime(&tiempo);
-    strftime(fecha, 12, "%d-%m-%Y", nueva_fecha);
+char archivo_wal[MAX_STRING];
+int usar_wal = 0;
+char archivo_instantanea[MAX_STRING];
+int usar_instantanea = 0;
+int segundos_instantanea = INSTANTANEA_SEGUNDOS_POR_DEFECTO;
+int num_franjas = FRANJAS_POR_DEFECTO;
+int num_trabajadores = TRABAJADORES_POR_DEFECTO;
+int capacidad_buffer = CAPACIDAD_ANILLO_POR_DEFECTO;
+int num_consumidores = 1;
+int max_encoladas = COLA_DESPACHO_POR_DEFECTO;
+int max_en_vuelo_sesion = EN_VUELO_POR_SESION_POR_DEFECTO;
+char archivo_metricas[MAX_STRING];
+int usar_archivo_metricas = 0;
+int segundos_metricas = METRICAS_SEGUNDOS_POR_DEFECTO;
+char ruta_socket[MAX_STRING];
+int usar_socket = 0;
+
+void enviar_respuesta(const solicitud_t *sol, respuesta_t *resp);
+
+// Función para terminar con SIGINT o SIGTERM igual que con el comando 's'
+void manejar_senal(int sig) {
+    (void)sig;
+    eventos_detener();
 }
 
+// Implementación de funciones comunes
 int validar_isbn(int isbn) {
     return isbn > 0;
 }
@@ -64,242 +80,463 @@ void imprimir_verbose(const char *mensaje, solicitud_t *sol) {
     }
 }
 
-// Función para inicializar el buffer circular
-void init_buffer() {
-    buffer_renovaciones.in = 0;
-    buffer_renovaciones.out = 0;
-    buffer_renovaciones.count = 0;
-    pthread_mutex_init(&buffer_renovaciones.mutex, NULL);
-    pthread_cond_init(&buffer_renovaciones.not_full, NULL);
-    pthread_cond_init(&buffer_renovaciones.not_empty, NULL);
+// Función para cargar la base de datos. Si hay una instantánea se parte de
+// ella; lsn recibe el corte del WAL que ya incluye (0 si se cargó el texto).
+int cargar_base_datos(uint64_t *lsn) {
+    *lsn = 0;
+    if (usar_instantanea && access(archivo_instantanea, F_OK) == 0) {
+        return catalogo_cargar_instantanea(archivo_instantanea, lsn);
+    }
+    return catalogo_cargar(archivo_datos);
 }
 
-// Función para agregar al buffer (productor)
-void buffer_put(solicitud_t *sol) {
-    pthread_mutex_lock(&buffer_renovaciones.mutex);
+// Función para agregar entrada al reporte
+void agregar_reporte(char status, const char *nombre, int isbn, int ejemplar, int fecha) {
+    reporte_entry_t entrada;
+    entrada.status = status;
+    entrada.nombre = nombre;
+    entrada.isbn = isbn;
+    entrada.ejemplar = ejemplar;
+    entrada.fecha = fecha;
+    bitacora_agregar(&entrada, 1);
+}
 
-    while (buffer_renovaciones.count == BUFFER_SIZE) {
-        pthread_cond_wait(&buffer_renovaciones.not_full, &buffer_renovaciones.mutex);
-    }
+// Función para agregar varias entradas al reporte con números consecutivos
+void agregar_reportes(const reporte_entry_t *entradas, int n) {
+    bitacora_agregar(entradas, n);
+}
 
-    buffer_renovaciones.buffer[buffer_renovaciones.in] = *sol;
-    buffer_renovaciones.in = (buffer_renovaciones.in + 1) % BUFFER_SIZE;
-    buffer_renovaciones.count++;
+// Función para aplicar una operación P/R/D sobre un libro cuya franja ya está
+// bloqueada. Si el libro cambió, deja en *entrada la línea para el reporte
+// (status 0 si no hubo cambio) y en *fecha la de devolución (o SIN_FECHA).
+codigo_resultado_t aplicar_operacion(libro_t *libro, operation_t operacion,
+                                     int *fecha, reporte_entry_t *entrada) {
+    codigo_resultado_t codigo;
+    ejemplar_t anterior;
+    int i;
+
+    entrada->status = 0;
+    *fecha = SIN_FECHA;
+
+    switch (operacion) {
+        case OP_DEVOLVER:
+            // Buscar ejemplar prestado
+            i = libro_primer_ejemplar(libro, STATUS_PRESTADO);
+            if (i == -1) {
+                return RES_NADA_QUE_DEVOLVER;
+            }
+            anterior = libro->ejemplares[i];
+            libro_cambiar_estado(libro, i, STATUS_DISPONIBLE);
+            libro->ejemplares[i].fecha = fecha_hoy();
+            codigo = RES_DEVUELTO;
+            break;
 
-    pthread_cond_signal(&buffer_renovaciones.not_empty);
-    pthread_mutex_unlock(&buffer_renovaciones.mutex);
-}
+        case OP_RENOVAR:
+            // Buscar ejemplar prestado
+            i = libro_primer_ejemplar(libro, STATUS_PRESTADO);
+            if (i == -1) {
+                return RES_SIN_PRESTADOS;
+            }
+            anterior = libro->ejemplares[i];
+            // Renovar por 7 días más
+            libro->ejemplares[i].fecha += 7;
+            codigo = RES_RENOVADO;
+            break;
 
-// Función para obtener del buffer (consumidor)
-int buffer_get(solicitud_t *sol) {
-    pthread_mutex_lock(&buffer_renovaciones.mutex);
+        case OP_PRESTAR:
+            // Buscar ejemplar disponible
+            i = libro_primer_ejemplar(libro, STATUS_DISPONIBLE);
+            if (i == -1) {
+                return RES_SIN_DISPONIBLES;
+            }
+            anterior = libro->ejemplares[i];
+            libro_cambiar_estado(libro, i, STATUS_PRESTADO);
+            libro->ejemplares[i].fecha = fecha_hoy() + 7;
+            codigo = RES_PRESTADO;
+            break;
 
-    while (buffer_renovaciones.count == 0 && !terminar_programa) {
-        pthread_cond_wait(&buffer_renovaciones.not_empty, &buffer_renovaciones.mutex);
+        default:
+            return RES_ERROR;
     }
 
-    if (terminar_programa && buffer_renovaciones.count == 0) {
-        pthread_mutex_unlock(&buffer_renovaciones.mutex);
-        return 0; // No hay más elementos
+    // Marcar antes de registrar: una instantánea que corte el WAL después de
+    // este registro tiene que incluir el libro, o el cambio se perdería
+    instantanea_marcar(libro - biblioteca);
+    if (wal_registrar(operacion, libro, i) != 0) {
+        // Sin registro no hay cambio: se deshace y el cliente recibe el error
+        libro_cambiar_estado(libro, i, anterior.status);
+        libro->ejemplares[i].fecha = anterior.fecha;
+        return RES_ERROR;
     }
+    vencimientos_actualizar(libro - biblioteca, i);
+
+    entrada->status = (char)operacion;
+    entrada->nombre = libro->nombre;
+    entrada->isbn = libro->isbn;
+    entrada->ejemplar = libro->ejemplares[i].numero;
+    entrada->fecha = libro->ejemplares[i].fecha;
+    if (operacion != OP_DEVOLVER) {
+        *fecha = libro->ejemplares[i].fecha;
+    }
+    return codigo;
+}
 
-    *sol = buffer_renovaciones.buffer[buffer_renovaciones.out];
-    buffer_renovaciones.out = (buffer_renovaciones.out + 1) % BUFFER_SIZE;
-    buffer_renovaciones.count--;
-
-    pthread_cond_signal(&buffer_renovaciones.not_full);
-    pthread_mutex_unlock(&buffer_renovaciones.mutex);
+// Función para procesar una operación individual sobre su libro
+codigo_resultado_t procesar_operacion(solicitud_t *sol, int *fecha) {
+    int libro_idx = encontrar_libro(sol->isbn);
+    if (libro_idx == -1) {
+        *fecha = SIN_FECHA;
+        return RES_NO_ENCONTRADO;
+    }
 
-    return 1; // Elemento obtenido
+    reporte_entry_t entrada;
+    catalogo_bloquear(libro_idx);
+    codigo_resultado_t codigo = aplicar_operacion(&biblioteca[libro_idx], sol->operacion,
+                                                  fecha, &entrada);
+    if (entrada.status) {
+        agregar_reporte(entrada.status, entrada.nombre, entrada.isbn,
+                        entrada.ejemplar, entrada.fecha);
+    }
+    catalogo_desbloquear(libro_idx);
+    return codigo;
 }
 
-// Función para cargar la base de datos
-int cargar_base_datos() {
-    FILE *file = fopen(archivo_datos, "r");
-    if (!file) {
-        perror("Error abriendo archivo de datos");
-        return -1;
+// Función para esperar a que los cambios del hilo estén en disco antes de
+// confirmarlos. Si el WAL no se pudo escribir, el cambio de 'codigo' (si lo
+// hubo) no se confirma y el receptor se detiene: desde ahí ningún cambio
+// sería durable.
+codigo_resultado_t confirmar_cambio(codigo_resultado_t codigo) {
+    if (wal_sincronizar() == 0) {
+        return codigo;
     }
+    eventos_detener();
+    if (codigo == RES_PRESTADO || codigo == RES_RENOVADO || codigo == RES_DEVUELTO) {
+        return RES_ERROR;
+    }
+    return codigo;
+}
+
+// Función para procesar devolución
+void procesar_devolucion(solicitud_t *sol) {
+    int fecha;
+    procesar_operacion(sol, &fecha);
+}
+
+// Función para procesar renovación
+void procesar_renovacion(solicitud_t *sol) {
+    respuesta_t resp_renovacion = {0};
+    resp_renovacion.codigo = procesar_operacion(sol, &resp_renovacion.fecha_devolucion);
+    // No confirmar al cliente antes de que el cambio sea durable
+    resp_renovacion.codigo = confirmar_cambio(resp_renovacion.codigo);
+    // Enviar respuesta específica
+    enviar_respuesta(sol, &resp_renovacion);
+}
 
-    char linea[MAX_LINE];
-    num_libros = 0;
+// Función para procesar un lote. Se bloquean a la vez todas las franjas que
+// toca, las operaciones se aplican en el orden recibido (así se respeta el
+// orden por ISBN) y se responde con un único vector de resultados.
+void procesar_lote(solicitud_t *sol) {
+    lote_t *lote = sol->lote;
+    int libros[MAX_LOTE];
+    int franjas_tomadas[MAX_LOTE];
+    resultado_lote_t resultados[MAX_LOTE];
+    reporte_entry_t entradas[MAX_LOTE];
+    int num_entradas = 0;
+
+    for (int i = 0; i < lote->num; i++) {
+        libros[i] = encontrar_libro(lote->ops[i].isbn);
+    }
 
-    while (fgets(linea, sizeof(linea), file) && num_libros < MAX_BOOKS) {
-        // Remover salto de línea
-        linea[strcspn(linea, "\n")] = 0;
+    int num_tomadas = catalogo_bloquear_varios(libros, lote->num, franjas_tomadas);
+    for (int i = 0; i < lote->num; i++) {
+        reporte_entry_t entrada;
 
-        // Parsear información del libro
-        if (sscanf(linea, "%[^,], %d, %d",
-                   biblioteca[num_libros].nombre,
-                   &biblioteca[num_libros].isbn,
-                   &biblioteca[num_libros].num_ejemplares) != 3) {
+        if (libros[i] == -1) {
+            resultados[i].codigo = RES_NO_ENCONTRADO;
+            resultados[i].fecha_devolucion = SIN_FECHA;
             continue;
         }
-
-        // Leer información de cada ejemplar
-        for (int i = 0; i < biblioteca[num_libros].num_ejemplares; i++) {
-            if (!fgets(linea, sizeof(linea), file)) break;
-            linea[strcspn(linea, "\n")] = 0;
-
-            char status_char;
-            if (sscanf(linea, "%d, %c, %s",
-                       &biblioteca[num_libros].ejemplares[i].numero,
-                       &status_char,
-                       biblioteca[num_libros].ejemplares[i].fecha) == 3) {
-                biblioteca[num_libros].ejemplares[i].status = (status_t)status_char;
-            }
+        resultados[i].codigo = aplicar_operacion(&biblioteca[libros[i]], lote->ops[i].operacion,
+                                                 &resultados[i].fecha_devolucion, &entrada);
+        if (entrada.status) {
+            entradas[num_entradas++] = entrada;
+        }
+    }
+    agregar_reportes(entradas, num_entradas);
+    catalogo_desbloquear_varios(franjas_tomadas, num_tomadas);
+    // Un solo fdatasync cubre todo el lote
+    if (wal_sincronizar() != 0) {
+        for (int i = 0; i < lote->num; i++) {
+            resultados[i].codigo = confirmar_cambio(resultados[i].codigo);
         }
-
-        num_libros++;
     }
 
-    fclose(file);
-    printf("Base de datos cargada: %d libros\n", num_libros);
-    return 0;
+    respuesta_t resp = {0};
+    resp.num_resultados = lote->num;
+    resp.resultados = resultados;
+    enviar_respuesta(sol, &resp);
+
+    free(lote);
+    sol->lote = NULL;
 }
 
-// Función para encontrar un libro por ISBN
-int encontrar_libro(int isbn) {
-    for (int i = 0; i < num_libros; i++) {
-        if (biblioteca[i].isbn == isbn) {
-            return i;
+// Hilo auxiliar 1 para procesar devoluciones
+void* hilo_auxiliar1(void *arg) {
+    (void)arg; // Suprimir warning de parámetro no usado
+
+    solicitud_t lote[LOTE_ANILLO];
+    int n;
+
+    // Varios hilos pueden consumir a la vez; cada uno saca hasta LOTE_ANILLO
+    while ((n = anillo_sacar_lote(&buffer_devoluciones, lote, LOTE_ANILLO)) > 0) {
+        for (int i = 0; i < n; i++) {
+            if (lote[i].operacion == OP_DEVOLVER) {
+                metricas_registrar(MET_ESPERA_ANILLO, lote[i].recibida);
+                uint64_t inicio = metricas_ahora();
+                procesar_devolucion(&lote[i]);
+                metricas_registrar(MET_APLICAR_DEVOLUCION, inicio);
+                sesiones_terminar(&lote[i]);
+            }
         }
     }
-    return -1;
+
+    return NULL;
 }
 
-// Función para agregar entrada al reporte
-void agregar_reporte(char status, const char *nombre, int isbn, int ejemplar, const char *fecha) {
-    pthread_mutex_lock(&reporte_mutex);
+// Filtro y destino de un reporte pedido por consola
+typedef struct {
+    int isbn;           // 0: todos
+    char operacion;     // 0: todas
+    int desde;          // números de día; SIN_FECHA: sin límite
+    int hasta;
+    FILE *salida;
+    long lineas;
+} filtro_reporte_t;
+
+// Función para escribir una línea del reporte si pasa el filtro
+void imprimir_entrada_reporte(const reporte_entry_t *entrada, void *ctx) {
+    filtro_reporte_t *filtro = ctx;
+
+    if (filtro->isbn && entrada->isbn != filtro->isbn) {
+        return;
+    }
+    if (filtro->operacion && entrada->status != filtro->operacion) {
+        return;
+    }
+    if ((filtro->desde != SIN_FECHA && entrada->fecha < filtro->desde) ||
+        (filtro->hasta != SIN_FECHA && entrada->fecha > filtro->hasta)) {
+        return;
+    }
+    char fecha[LARGO_FECHA];
+    fecha_a_texto(entrada->fecha, fecha);
+    fprintf(filtro->salida, "%c, %s, %d, %d, %s\n", entrada->status, entrada->nombre,
+            entrada->isbn, entrada->ejemplar, fecha);
+    filtro->lineas++;
+}
 
-    if (num_reportes < 1000) {
-        reportes[num_reportes].status = status;
-        strcpy(reportes[num_reportes].nombre, nombre);
-        reportes[num_reportes].isbn = isbn;
-        reportes[num_reportes].ejemplar = ejemplar;
-        strcpy(reportes[num_reportes].fecha, fecha);
-        num_reportes++;
+// Función para separar el destino ("> archivo" o "| comando") del resto de
+// los argumentos de un comando de consola. Devuelve NULL si no hay destino.
+char *separar_destino(char *args, int *es_comando) {
+    char *destino = strpbrk(args, ">|");
+    if (!destino) {
+        return NULL;
     }
+    *es_comando = (*destino == '|');
+    *destino++ = '\0';
+    destino += strspn(destino, " \t");
+    destino[strcspn(destino, "\n")] = '\0';
+    return destino;
+}
 
-    pthread_mutex_unlock(&reporte_mutex);
+// Función para abrir el destino de un comando (la terminal si no hay)
+FILE *abrir_destino(const char *destino, int es_comando) {
+    if (!destino) {
+        return stdout;
+    }
+    if (*destino == '\0') {
+        printf("Falta el destino después de '>' o '|'\n");
+        return NULL;
+    }
+    FILE *salida = es_comando ? popen(destino, "w") : fopen(destino, "w");
+    if (!salida) {
+        perror("Error abriendo destino");
+    }
+    return salida;
 }
 
-// Función para procesar devolución
-void procesar_devolucion(solicitud_t *sol) {
-    pthread_mutex_lock(&bd_mutex);
+void cerrar_destino(FILE *salida, int es_comando) {
+    if (salida == stdout) {
+        fflush(stdout);
+    } else if (es_comando) {
+        pclose(salida);
+    } else {
+        fclose(salida);
+    }
+}
 
-    int libro_idx = encontrar_libro(sol->isbn);
-    if (libro_idx != -1) {
-        // Buscar ejemplar prestado
-        for (int i = 0; i < biblioteca[libro_idx].num_ejemplares; i++) {
-            if (biblioteca[libro_idx].ejemplares[i].status == STATUS_PRESTADO) {
-                biblioteca[libro_idx].ejemplares[i].status = STATUS_DISPONIBLE;
-                obtener_fecha_actual(biblioteca[libro_idx].ejemplares[i].fecha);
-
-                agregar_reporte('D', biblioteca[libro_idx].nombre, sol->isbn,
-                               biblioteca[libro_idx].ejemplares[i].numero,
-                               biblioteca[libro_idx].ejemplares[i].fecha);
-                break;
+// Función para generar un reporte. args es el resto de la línea del comando:
+//   [isbn=N] [op=P|R|D] [desde=dd-mm-aaaa] [hasta=dd-mm-aaaa] [> archivo | '|' comando]
+// El reporte cubre las operaciones aplicadas hasta el momento del comando; las
+// que llegan mientras se escribe quedan para el siguiente. No se toma ningún
+// bloqueo, así que la consola o un archivo lento no frenan las operaciones.
+void generar_reporte(char *args) {
+    filtro_reporte_t filtro = {0};
+    int es_comando = 0;
+    char *destino = separar_destino(args, &es_comando);
+
+    char *resto = NULL;
+    for (char *tok = strtok_r(args, " \t\n", &resto); tok; tok = strtok_r(NULL, " \t\n", &resto)) {
+        if (strncmp(tok, "isbn=", 5) == 0) {
+            filtro.isbn = atoi(tok + 5);
+        } else if (strncmp(tok, "op=", 3) == 0) {
+            filtro.operacion = tok[3];
+        } else if (strncmp(tok, "desde=", 6) == 0 || strncmp(tok, "hasta=", 6) == 0) {
+            int fecha = fecha_de_texto(tok + 6, strlen(tok + 6));
+            if (fecha == SIN_FECHA) {
+                printf("Fecha inválida (se espera dd-mm-aaaa): %s\n", tok + 6);
+                return;
             }
+            *(tok[0] == 'd' ? &filtro.desde : &filtro.hasta) = fecha;
+        } else {
+            printf("Filtro no reconocido: %s\n", tok);
+            return;
         }
     }
 
-    pthread_mutex_unlock(&bd_mutex);
-}
+    if (!(filtro.salida = abrir_destino(destino, es_comando))) {
+        return;
+    }
 
-// Función para procesar renovación
-void procesar_renovacion(solicitud_t *sol) {
-    respuesta_t resp_renovacion;
-    pthread_mutex_lock(&bd_mutex);
-    int libro_idx = encontrar_libro(sol->isbn);
-    if (libro_idx == -1) {
-        resp_renovacion.exito = 0;
-        strcpy(resp_renovacion.mensaje, "Libro no encontrado");
-        strcpy(resp_renovacion.fecha_devolucion, "");
+    uint64_t corte = bitacora_corte();
+
+    if (filtro.salida == stdout) {
+        printf("\n=== REPORTE DE OPERACIONES ===\n");
+    }
+    fprintf(filtro.salida, "Status, Nombre del Libro, ISBN, Ejemplar, Fecha\n");
+    bitacora_recorrer(corte, imprimir_entrada_reporte, &filtro);
+
+    if (filtro.salida == stdout) {
+        printf("=== FIN REPORTE ===\n\n");
     } else {
-        // Buscar ejemplar prestado
-        int encontrado = 0;
-        for (int i = 0; i < biblioteca[libro_idx].num_ejemplares; i++) {
-            if (biblioteca[libro_idx].ejemplares[i].status == STATUS_PRESTADO) {
-                // Renovar por 7 días más
-                agregar_dias_fecha(biblioteca[libro_idx].ejemplares[i].fecha, 7);
-
-                resp_renovacion.exito = 1;
-                // MENSAJE MÁS CORTO PARA EVITAR TRUNCACIÓN
-                strcpy(resp_renovacion.mensaje, "Renovación exitosa");
-                strcpy(resp_renovacion.fecha_devolucion,
-                       biblioteca[libro_idx].ejemplares[i].fecha);
-                agregar_reporte('R', biblioteca[libro_idx].nombre, sol->isbn,
-                               biblioteca[libro_idx].ejemplares[i].numero,
-                               biblioteca[libro_idx].ejemplares[i].fecha);
-                encontrado = 1;
-                break;
-            }
-        }
-        if (!encontrado) {
-            resp_renovacion.exito = 0;
-            strcpy(resp_renovacion.mensaje, "No hay ejemplares prestados para renovar");
-            strcpy(resp_renovacion.fecha_devolucion, "");
-        }
+        cerrar_destino(filtro.salida, es_comando);
+        printf("Reporte escrito en %s: %ld operaciones\n", destino, filtro.lineas);
     }
-    pthread_mutex_unlock(&bd_mutex);
-    // Enviar respuesta específica
-    enviar_respuesta(sol->pid_solicitante, &resp_renovacion);
-    buffer_put(sol);
 }
 
-// Hilo auxiliar 1 para procesar devoluciones y renovaciones
-void* hilo_auxiliar1(void *arg) {
-    (void)arg; // Suprimir warning de parámetro no usado
+// Función para listar los ejemplares vencidos. args: [dd-mm-aaaa] [destino];
+// la fecha es el día de corte (vencidos antes de ese día, por defecto hoy).
+void listar_vencidos(char *args) {
+    int es_comando = 0;
+    char *destino = separar_destino(args, &es_comando);
+    int corte = fecha_hoy();
+
+    char *resto = NULL;
+    char *tok = strtok_r(args, " \t\n", &resto);
+    if (tok && (corte = fecha_de_texto(tok, strlen(tok))) == SIN_FECHA) {
+        printf("Fecha inválida (se espera dd-mm-aaaa): %s\n", tok);
+        return;
+    }
 
-    solicitud_t sol;
+    vencido_t *vencidos;
+    int num = vencimientos_listar(corte, &vencidos);
+    if (num < 0) {
+        fprintf(stderr, "Sin memoria para listar vencidos\n");
+        return;
+    }
+    FILE *salida = abrir_destino(destino, es_comando);
+    if (!salida) {
+        free(vencidos);
+        return;
+    }
 
-    while (buffer_get(&sol)) {
-        if (sol.operacion == OP_DEVOLVER) {
-            procesar_devolucion(&sol);
-        } else if (sol.operacion == OP_RENOVAR) {
-            procesar_renovacion(&sol);
-        }
+    if (salida == stdout) {
+        printf("\n=== EJEMPLARES VENCIDOS ===\n");
     }
+    fprintf(salida, "ISBN, Nombre del Libro, Ejemplar, Fecha devolución, Días de atraso\n");
+    for (int i = 0; i < num; i++) {
+        char fecha[LARGO_FECHA];
+        int libro_idx = encontrar_libro(vencidos[i].isbn);
+        fecha_a_texto(vencidos[i].fecha, fecha);
+        fprintf(salida, "%d, %s, %d, %s, %d\n", vencidos[i].isbn,
+                libro_idx >= 0 ? biblioteca[libro_idx].nombre : "?",
+                vencidos[i].ejemplar, fecha, corte - vencidos[i].fecha);
+    }
+    if (salida == stdout) {
+        printf("=== %d VENCIDOS ===\n\n", num);
+    } else {
+        cerrar_destino(salida, es_comando);
+        printf("Vencidos escritos en %s: %d ejemplares\n", destino, num);
+    }
+    free(vencidos);
+}
 
-    return NULL;
+// Función para mostrar las métricas. args: [destino]
+void mostrar_metricas(char *args) {
+    int es_comando = 0;
+    char *destino = separar_destino(args, &es_comando);
+    FILE *salida = abrir_destino(destino, es_comando);
+    if (!salida) {
+        return;
+    }
+
+    if (salida == stdout) {
+        printf("\n=== MÉTRICAS ===\n");
+    }
+    metricas_imprimir(salida);
+    if (salida == stdout) {
+        printf("=== FIN MÉTRICAS ===\n\n");
+    } else {
+        cerrar_destino(salida, es_comando);
+        printf("Métricas escritas en %s\n", destino);
+    }
 }
 
-// Hilo auxiliar 2 para comandos de consola
+// Hilo auxiliar 2 para comandos de consola. Espera a la vez la entrada y el
+// canal de control, así termina enseguida aunque la salida venga de una señal.
 void* hilo_auxiliar2(void *arg) {
     (void)arg;
 
-    char comando;
-    while (!terminar_programa) {
-        printf("Ingrese comando (s=salir, r=reporte): ");
-        if (scanf(" %c", &comando) != 1) {
-            continue;
+    char linea[MAX_STRING * 2];
+    struct pollfd fds[2] = {
+        { .fd = STDIN_FILENO, .events = POLLIN },
+        { .fd = eventos_fd_control(), .events = POLLIN }
+    };
+
+    // Sin buffer: lo que poll() no ve como pendiente no quedó guardado en stdin
+    setvbuf(stdin, NULL, _IONBF, 0);
+    for (;;) {
+        printf("Ingrese comando (s=salir, r=reporte, v=vencidos, m=metricas): ");
+        fflush(stdout);
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents) {
+            break;  // se pidió terminar (señal)
         }
+        if (!fgets(linea, sizeof(linea), stdin)) {
+            // Sin consola el receptor sigue atendiendo hasta SIGINT o SIGTERM
+            printf("\nEntrada cerrada: la consola deja de leer comandos\n");
+            break;
+        }
+
+        // Primer carácter: el comando; el resto de la línea: sus argumentos
+        char *comienzo = linea + strspn(linea, " \t");
+        char comando = *comienzo;
+        char *args = comando ? comienzo + 1 : comienzo;
 
         if (comando == 's') {
             printf("Terminando programa...\n");
-            terminar_programa = 1;
-
-            // Despertar al hilo auxiliar1
-            pthread_mutex_lock(&buffer_renovaciones.mutex);
-            pthread_cond_broadcast(&buffer_renovaciones.not_empty);
-            pthread_mutex_unlock(&buffer_renovaciones.mutex);
-
+            eventos_detener();
             break;
         } else if (comando == 'r') {
-            printf("\n=== REPORTE DE OPERACIONES ===\n");
-            printf("Status, Nombre del Libro, ISBN, Ejemplar, Fecha\n");
-
-            pthread_mutex_lock(&reporte_mutex);
-            for (int i = 0; i < num_reportes; i++) {
-                printf("%c, %s, %d, %d, %s\n",
-                       reportes[i].status, reportes[i].nombre,
-                       reportes[i].isbn, reportes[i].ejemplar,
-                       reportes[i].fecha);
-            }
-            pthread_mutex_unlock(&reporte_mutex);
-
-            printf("=== FIN REPORTE ===\n\n");
+            generar_reporte(args);
+        } else if (comando == 'v') {
+            listar_vencidos(args);
+        } else if (comando == 'm') {
+            mostrar_metricas(args);
         }
     }
 
@@ -307,60 +544,252 @@ void* hilo_auxiliar2(void *arg) {
 }
 
 // Función para enviar respuesta
-void enviar_respuesta(int pid_solicitante, respuesta_t *resp) {
-    char pipe_respuesta[MAX_STRING];
-    snprintf(pipe_respuesta, sizeof(pipe_respuesta), "/tmp/resp_%d", pid_solicitante);
+void enviar_respuesta(const solicitud_t *sol, respuesta_t *resp) {
+    uint64_t inicio = metricas_ahora();
+    resp->id_solicitud = sol->id_solicitud;
+
+    uint8_t buf[PROTO_MAX_TRAMA];
+    size_t largo = protocolo_codificar_respuesta(resp, sol->formato, buf);
+
+    // Con sesión abierta se escribe directamente en el descriptor guardado;
+    // sin sesión se abre y se cierra el pipe del solicitante para esta respuesta.
+    // Por el socket siempre hay sesión: si ya no está, el cliente se fue.
+    if (sesiones_enviar(sol, buf, largo) == SESION_INEXISTENTE && sol->conexion == -1) {
+        char pipe_respuesta[MAX_STRING];
+        snprintf(pipe_respuesta, sizeof(pipe_respuesta), FORMATO_PIPE_RESPUESTA, sol->pid_solicitante);
+
+        // Sin bloquear: si el solicitante todavía no abrió su pipe se reintenta
+        // un momento, pero uno que ya no está no traba al trabajador
+        int resp_fd = -1;
+        for (int ms = 0; ms < ESPERA_SIN_SESION_MS; ms++) {
+            resp_fd = open(pipe_respuesta, O_WRONLY | O_NONBLOCK);
+            if (resp_fd != -1 || errno != ENXIO) {
+                break;
+            }
+            usleep(1000);
+        }
+        if (resp_fd != -1) {
+            if (write(resp_fd, buf, largo) != (ssize_t)largo) {
+                perror("Error escribiendo respuesta");
+            }
+            close(resp_fd);
+        }
+    }
+    metricas_registrar(MET_ENVIO_RESPUESTA, inicio);
+    if (resp->codigo == RES_OCUPADO) {
+        metricas_registrar(MET_RECHAZADA, sol->recibida);
+        return;
+    }
 
-    int resp_fd = open(pipe_respuesta, O_WRONLY);
-    if (resp_fd != -1) {
-        write(resp_fd, resp, sizeof(respuesta_t));
-        close(resp_fd);
+    // El servicio termina con la última respuesta (los vencidos van en tramos)
+    int servicio = metricas_de_operacion(sol->operacion);
+    if (servicio != -1 && (sol->operacion != OP_VENCIDOS || resp->ultimo_tramo ||
+                           resp->codigo == RES_ERROR)) {
+        metricas_registrar(servicio, sol->recibida);
     }
 }
 
 // Función para procesar préstamo
 void procesar_prestamo(solicitud_t *sol) {
-    respuesta_t resp;
+    respuesta_t resp = {0};
+    resp.codigo = procesar_operacion(sol, &resp.fecha_devolucion);
+    resp.codigo = confirmar_cambio(resp.codigo);
+    enviar_respuesta(sol, &resp);
+}
 
-    pthread_mutex_lock(&bd_mutex);
+// Función para responder una consulta de vencidos: la lista se envía en
+// tramos de VENCIDOS_POR_TRAMA; el último (aunque esté vacío) lo indica.
+void procesar_vencidos(solicitud_t *sol) {
+    int corte = (sol->fecha_corte != SIN_FECHA) ? sol->fecha_corte : fecha_hoy();
+    vencido_t *vencidos;
+    int num = vencimientos_listar(corte, &vencidos);
+
+    respuesta_t resp = {0};
+    if (num < 0) {
+        resp.codigo = RES_ERROR;
+        enviar_respuesta(sol, &resp);
+        return;
+    }
+    int enviados = 0;
+    do {
+        resp.vencidos = vencidos + enviados;
+        resp.num_vencidos = num - enviados < VENCIDOS_POR_TRAMA ? num - enviados : VENCIDOS_POR_TRAMA;
+        enviados += resp.num_vencidos;
+        resp.ultimo_tramo = (enviados == num);
+        enviar_respuesta(sol, &resp);
+    } while (enviados < num);
+    free(vencidos);
+}
 
-    int libro_idx = encontrar_libro(sol->isbn);
-    if (libro_idx == -1) {
-        resp.exito = 0;
-        strcpy(resp.mensaje, "Libro no encontrado");
-    } else {
-        // Buscar ejemplar disponible
-        int ejemplar_disponible = -1;
-        for (int i = 0; i < biblioteca[libro_idx].num_ejemplares; i++) {
-            if (biblioteca[libro_idx].ejemplares[i].status == STATUS_DISPONIBLE) {
-                ejemplar_disponible = i;
-                break;
-            }
+// Función para responder una consulta de disponibilidad. No toma ninguna
+// franja: los contadores se leen con catalogo_leer_disponibilidad, así las
+// consultas no compiten con los préstamos.
+void procesar_consulta(solicitud_t *sol) {
+    consulta_t *consulta = sol->consulta;
+    disponibilidad_t disponibilidades[MAX_CONSULTA];
+
+    for (int i = 0; i < consulta->num; i++) {
+        int libro_idx = encontrar_libro(consulta->isbn[i]);
+        if (libro_idx == -1) {
+            disponibilidades[i].codigo = RES_NO_ENCONTRADO;
+            disponibilidades[i].disponibles = 0;
+            disponibilidades[i].prestados = 0;
+            continue;
         }
+        disponibilidades[i].codigo = RES_DISPONIBILIDAD;
+        catalogo_leer_disponibilidad(libro_idx, &disponibilidades[i].disponibles,
+                                     &disponibilidades[i].prestados);
+    }
 
-        if (ejemplar_disponible == -1) {
-            resp.exito = 0;
-            strcpy(resp.mensaje, "No hay ejemplares disponibles");
-        } else {
-            // Prestar el libro
-            biblioteca[libro_idx].ejemplares[ejemplar_disponible].status = STATUS_PRESTADO;
-            obtener_fecha_actual(biblioteca[libro_idx].ejemplares[ejemplar_disponible].fecha);
-            agregar_dias_fecha(biblioteca[libro_idx].ejemplares[ejemplar_disponible].fecha, 7);
-
-            resp.exito = 1;
-            snprintf(resp.mensaje, sizeof(resp.mensaje),
-                    "Libro prestado exitosamente. Fecha de devolución: %s",
-                    biblioteca[libro_idx].ejemplares[ejemplar_disponible].fecha);
-
-            agregar_reporte('P', biblioteca[libro_idx].nombre, sol->isbn,
-                           biblioteca[libro_idx].ejemplares[ejemplar_disponible].numero,
-                           biblioteca[libro_idx].ejemplares[ejemplar_disponible].fecha);
-        }
+    respuesta_t resp = {0};
+    resp.num_disponibilidades = consulta->num;
+    resp.disponibilidades = disponibilidades;
+    enviar_respuesta(sol, &resp);
+
+    free(consulta);
+    sol->consulta = NULL;
+}
+
+// Función para responder una búsqueda por título: el texto viene en el nombre
+void procesar_busqueda(solicitud_t *sol) {
+    int libros[MAX_ENCONTRADOS];
+    libro_encontrado_t encontrados[MAX_ENCONTRADOS];
+    respuesta_t resp = {0};
+
+    resp.num_encontrados = busqueda_buscar(sol->nombre_libro, libros, MAX_ENCONTRADOS,
+                                           &resp.hay_mas);
+    for (int i = 0; i < resp.num_encontrados; i++) {
+        encontrados[i].isbn = biblioteca[libros[i]].isbn;
+        snprintf(encontrados[i].nombre, sizeof(encontrados[i].nombre), "%s",
+                 biblioteca[libros[i]].nombre);
     }
+    resp.encontrados = encontrados;
+    enviar_respuesta(sol, &resp);
+}
+
+// Función que ejecutan los trabajadores del pool (préstamos, renovaciones,
+// lotes, vencidos, consultas y búsquedas)
+void procesar_en_trabajador(solicitud_t *sol) {
+    metricas_registrar(MET_ESPERA_DESPACHO, sol->recibida);
+    if (sol->operacion == OP_PRESTAR) {
+        procesar_prestamo(sol);
+    } else if (sol->operacion == OP_RENOVAR) {
+        procesar_renovacion(sol);
+    } else if (sol->operacion == OP_LOTE) {
+        procesar_lote(sol);
+    } else if (sol->operacion == OP_VENCIDOS) {
+        procesar_vencidos(sol);
+    } else if (sol->operacion == OP_CONSULTAR) {
+        procesar_consulta(sol);
+    } else if (sol->operacion == OP_BUSCAR) {
+        procesar_busqueda(sol);
+    }
+    sesiones_terminar(sol);
+}
+
+// Función para responder "ocupado" a una solicitud que no se admitió. Es una
+// respuesta común aunque la operación tenga su propia trama: el cliente mira
+// el código antes que nada y puede reintentar.
+void rechazar_solicitud(solicitud_t *sol) {
+    respuesta_t resp = {0};
+    resp.codigo = RES_OCUPADO;
+    enviar_respuesta(sol, &resp);
+    if (sol->operacion == OP_LOTE) {
+        free(sol->lote);
+        sol->lote = NULL;
+    } else if (sol->operacion == OP_CONSULTAR) {
+        free(sol->consulta);
+        sol->consulta = NULL;
+    }
+}
 
-    pthread_mutex_unlock(&bd_mutex);
+// Función para encolar en el pool. Un lote espera su turno en el fragmento
+// de cada uno de sus ISBN, así no se adelanta a nada encolado antes para
+// ninguno de ellos.
+int encolar_en_despacho(solicitud_t *sol) {
+    if (sol->operacion != OP_LOTE) {
+        return despacho_encolar(sol);
+    }
+    int isbns[MAX_LOTE];
+    for (int i = 0; i < sol->lote->num; i++) {
+        isbns[i] = sol->lote->ops[i].isbn;
+    }
+    return despacho_encolar_varios(sol, isbns, sol->lote->num);
+}
 
-    enviar_respuesta(sol->pid_solicitante, &resp);
+// Función para pasar una solicitud al pool si su sesión y la cola admiten
+// una más; si no, se rechaza en el acto en lugar de hacer esperar a todos
+void admitir_en_despacho(solicitud_t *sol) {
+    if (!sesiones_admitir(sol)) {
+        rechazar_solicitud(sol);
+    } else if (encolar_en_despacho(sol) != 0) {
+        sesiones_terminar(sol);
+        rechazar_solicitud(sol);
+    }
+}
+
+// Función para atender una solicitud recién leída (hilo lector)
+void atender_solicitud(solicitud_t *sol) {
+    respuesta_t resp = {0};
+
+    sol->recibida = metricas_ahora();
+    imprimir_verbose("Solicitud recibida", sol);
+    sesiones_asignar(sol);
+
+    switch (sol->operacion) {
+        case OP_CONECTAR:
+            // Por el socket la sesión se abrió al aceptar la conexión
+            if (sol->conexion != -1 || sesiones_conectar(sol->pid_solicitante) != -1) {
+                sesiones_asignar(sol);
+                resp.codigo = RES_SESION_ESTABLECIDA;
+                enviar_respuesta(sol, &resp);
+            }
+            break;
+
+        case OP_DEVOLVER:
+            // Con el anillo lleno no se espera al hilo auxiliar: el hilo
+            // lector no se bloquea y el cliente sabe que debe reintentar
+            if (!sesiones_admitir(sol)) {
+                rechazar_solicitud(sol);
+            } else if (!anillo_intentar_poner(&buffer_devoluciones, sol)) {
+                sesiones_terminar(sol);
+                rechazar_solicitud(sol);
+            } else {
+                resp.codigo = RES_DEVOLUCION_RECIBIDA;
+                enviar_respuesta(sol, &resp);
+            }
+            break;
+
+        case OP_RENOVAR:
+        case OP_PRESTAR:
+        case OP_LOTE:
+        case OP_VENCIDOS:
+        case OP_CONSULTAR:
+            admitir_en_despacho(sol); // Procesado en paralelo por el pool
+            break;
+
+        case OP_BUSCAR:
+            // No hay orden que preservar por ISBN: se reparte por solicitante
+            sol->isbn = sol->pid_solicitante;
+            admitir_en_despacho(sol);
+            break;
+
+        case OP_SALIR:
+            printf("Proceso solicitante %d terminó\n", sol->pid_solicitante);
+            if (sol->conexion == -1) {
+                sesiones_cerrar(sol->pid_solicitante);
+            } else {
+                // La casilla se libera cuando se cierre la conexión
+                sesiones_cerrar_conexion(sol->sesion, sol->sesion_gen, 0);
+                // Como al cerrar el pipe de sesión: el cliente ve fin de archivo
+                shutdown(sol->conexion, SHUT_WR);
+            }
+            break;
+
+        default:
+            printf("Operación desconocida: %c\n", sol->operacion);
+            break;
+    }
 }
 
 // Función para guardar estado final
@@ -375,23 +804,24 @@ void guardar_estado_final() {
 
     fprintf(file, "=== ESTADO FINAL DE LA BIBLIOTECA ===\n");
     for (int i = 0; i < num_libros; i++) {
+        catalogo_bloquear_lectura(i);
         fprintf(file, "\nLibro: %s (ISBN: %d)\n", biblioteca[i].nombre, biblioteca[i].isbn);
         fprintf(file, "Ejemplares totales: %d\n", biblioteca[i].num_ejemplares);
 
-        int disponibles = 0;
         for (int j = 0; j < biblioteca[i].num_ejemplares; j++) {
             fprintf(file, "  Ejemplar %d: %s",
                    biblioteca[i].ejemplares[j].numero,
                    (biblioteca[i].ejemplares[j].status == STATUS_DISPONIBLE) ? "Disponible" : "Prestado");
 
             if (biblioteca[i].ejemplares[j].status == STATUS_PRESTADO) {
-                fprintf(file, " (Fecha devolución: %s)", biblioteca[i].ejemplares[j].fecha);
-            } else {
-                disponibles++;
+                char fecha[LARGO_FECHA];
+                fecha_a_texto(biblioteca[i].ejemplares[j].fecha, fecha);
+                fprintf(file, " (Fecha devolución: %s)", fecha);
             }
             fprintf(file, "\n");
         }
-        fprintf(file, "Ejemplares disponibles: %d\n", disponibles);
+        fprintf(file, "Ejemplares disponibles: %d\n", biblioteca[i].disponibles);
+        catalogo_desbloquear(i);
     }
 
     fclose(file);
@@ -401,7 +831,8 @@ void guardar_estado_final() {
 int main(int argc, char *argv[]) {
     // Parsear argumentos
     if (argc < 5) {
-        printf("Uso: %s -p pipeReceptor -f filedatos [-v] [-s filesalida]\n", argv[0]);
+        printf("Uso: %s -p pipeReceptor -f filedatos [-v] [-s filesalida] [-k franjas] [-w trabajadores] [-c capacidad] [-d consumidores] [-l archivo_wal]\n"
+               "       [-i instantanea] [-t segundos] [-m archivo_metricas] [-e segundos] [-u socket] [-q max_cola] [-n max_en_vuelo]\n", argv[0]);
         exit(1);
     }
 
@@ -416,6 +847,34 @@ int main(int argc, char *argv[]) {
         } else if (strcmp(argv[i], "-s") == 0) {
             usar_archivo_salida = 1;
             strcpy(archivo_salida, argv[++i]);
+        } else if (strcmp(argv[i], "-k") == 0) {
+            num_franjas = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0) {
+            num_trabajadores = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0) {
+            capacidad_buffer = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0) {
+            num_consumidores = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            usar_wal = 1;
+            strcpy(archivo_wal, argv[++i]);
+        } else if (strcmp(argv[i], "-i") == 0) {
+            usar_instantanea = 1;
+            strcpy(archivo_instantanea, argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0) {
+            segundos_instantanea = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-m") == 0) {
+            usar_archivo_metricas = 1;
+            strcpy(archivo_metricas, argv[++i]);
+        } else if (strcmp(argv[i], "-e") == 0) {
+            segundos_metricas = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-u") == 0) {
+            usar_socket = 1;
+            strcpy(ruta_socket, argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0) {
+            max_encoladas = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0) {
+            max_en_vuelo_sesion = atoi(argv[++i]);
         }
         i++;
     }
@@ -426,11 +885,77 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
+    if (num_franjas < 1) {
+        printf("Error: El número de franjas de bloqueo (-k) debe ser positivo\n");
+        exit(1);
+    }
+    if (num_trabajadores < 1) {
+        printf("Error: El número de trabajadores (-w) debe ser positivo\n");
+        exit(1);
+    }
+    if (segundos_instantanea < 1) {
+        printf("Error: El intervalo entre instantáneas (-t) debe ser positivo\n");
+        exit(1);
+    }
+    if (segundos_metricas < 1) {
+        printf("Error: El intervalo entre escrituras de métricas (-e) debe ser positivo\n");
+        exit(1);
+    }
+    if (max_encoladas < 0 || max_en_vuelo_sesion < 0) {
+        printf("Error: Los límites de cola (-q) y de solicitudes en vuelo (-n) no pueden ser negativos\n");
+        exit(1);
+    }
+    if (capacidad_buffer < 2 || num_consumidores < 1) {
+        printf("Error: La capacidad del buffer (-c) debe ser al menos 2 y los consumidores (-d) positivos\n");
+        exit(1);
+    }
+
+    // Un solicitante que termina sin cerrar su sesión no debe matar al receptor
+    signal(SIGPIPE, SIG_IGN);
+    if (eventos_iniciar() != 0) {
+        exit(1);
+    }
+    signal(SIGINT, manejar_senal);
+    signal(SIGTERM, manejar_senal);
+
     // Inicializar estructuras
-    init_buffer();
+    if (anillo_init(&buffer_devoluciones, capacidad_buffer) != 0) {
+        fprintf(stderr, "Error creando el buffer de devoluciones\n");
+        exit(1);
+    }
+    if (sesiones_init(SESIONES_MAX, max_en_vuelo_sesion) != 0) {
+        fprintf(stderr, "Error creando la tabla de sesiones\n");
+        exit(1);
+    }
+    if (catalogo_init_bloqueos(num_franjas) < 0) {
+        fprintf(stderr, "Error creando franjas de bloqueo\n");
+        exit(1);
+    }
 
     // Cargar base de datos
-    if (cargar_base_datos() != 0) {
+    uint64_t lsn_instantanea;
+    if (cargar_base_datos(&lsn_instantanea) != 0) {
+        exit(1);
+    }
+
+    // Reaplicar los cambios registrados desde la última instantánea
+    if (usar_wal && wal_iniciar(archivo_wal, lsn_instantanea) != 0) {
+        exit(1);
+    }
+    if (usar_instantanea && instantanea_iniciar(archivo_instantanea, segundos_instantanea) != 0) {
+        exit(1);
+    }
+    if (vencimientos_iniciar() != 0) {
+        fprintf(stderr, "Sin memoria para el índice de vencimientos\n");
+        exit(1);
+    }
+    if (busqueda_iniciar() != 0) {
+        fprintf(stderr, "Sin memoria para el índice de títulos\n");
+        exit(1);
+    }
+
+    // Las métricas cuentan desde que se empiezan a atender solicitudes
+    if (metricas_iniciar(usar_archivo_metricas ? archivo_metricas : NULL, segundos_metricas) != 0) {
         exit(1);
     }
 
@@ -448,67 +973,107 @@ int main(int argc, char *argv[]) {
     }
 
     // Crear hilos auxiliares
-    pthread_t hilo1, hilo2;
-    pthread_create(&hilo1, NULL, hilo_auxiliar1, NULL);
+    pthread_t hilos1[num_consumidores], hilo2;
+    for (int c = 0; c < num_consumidores; c++) {
+        pthread_create(&hilos1[c], NULL, hilo_auxiliar1, NULL);
+    }
     pthread_create(&hilo2, NULL, hilo_auxiliar2, NULL);
+    if (despacho_iniciar(num_trabajadores, procesar_en_trabajador, max_encoladas) != 0) {
+        fprintf(stderr, "Error creando el pool de trabajadores\n");
+        exit(1);
+    }
 
-    // Procesar solicitudes
-    int pipe_fd = open(pipe_name, O_RDONLY);
-    if (pipe_fd == -1) {
+    // El pipe se abre sin bloquear (no hace falta esperar al primer
+    // solicitante) y también para escribir: así read() no ve fin de archivo
+    // cada vez que se va el último cliente
+    int pipe_fd = open(pipe_name, O_RDONLY | O_NONBLOCK);
+    int guarda_fd = (pipe_fd != -1) ? open(pipe_name, O_WRONLY) : -1;
+    if (guarda_fd == -1 || eventos_agregar(pipe_fd, EPOLLIN, EVENTO_DATO(EVENTO_PIPE, 0)) != 0) {
         perror("Error abriendo pipe");
         exit(1);
     }
+    if (usar_socket && conexiones_iniciar(ruta_socket, SESIONES_MAX) != 0) {
+        exit(1);
+    }
 
+    static lector_t lector;
+    static struct epoll_event eventos[MAX_EVENTOS];
     solicitud_t sol;
-    respuesta_t resp;
+    lector_init(&lector);
 
     while (!terminar_programa) {
-        if (read(pipe_fd, &sol, sizeof(solicitud_t)) > 0) {
-            imprimir_verbose("Solicitud recibida", &sol);
-
-            switch (sol.operacion) {
-                case OP_DEVOLVER:
-                    resp.exito = 1;
-                    strcpy(resp.mensaje, "Libro recibido para devolución");
-                    enviar_respuesta(sol.pid_solicitante, &resp);
-                    buffer_put(&sol); // Enviar al hilo auxiliar
+        int n = eventos_esperar(eventos, MAX_EVENTOS);
+        sesiones_retener();
+        for (int e = 0; e < n; e++) {
+            uint64_t dato = eventos[e].data.u64;
+            switch (EVENTO_ETIQUETA(dato)) {
+                case EVENTO_PIPE:
+                    // Un read puede traer varios mensajes o solo parte de uno. Con
+                    // pocas lecturas por vuelta el control no espera a que se vacíe.
+                    for (int l = 0; l < LECTURAS_POR_EVENTO && lector_llenar(&lector, pipe_fd) > 0; l++) {
+                        while (lector_siguiente_solicitud(&lector, &sol)) {
+                            sol.conexion = -1;
+                            atender_solicitud(&sol);
+                        }
+                    }
                     break;
 
-                case OP_RENOVAR:
-			procesar_renovacion(&sol);
-			break;
+                case EVENTO_CONTROL:
+                    terminar_programa = 1;
+                    break;
+
+                case EVENTO_SESION:
+                    sesiones_vaciar(EVENTO_VALOR(dato));
+                    break;
 
-                case OP_PRESTAR:
-                    procesar_prestamo(&sol);
+                case EVENTO_ESCUCHA:
+                    conexiones_aceptar();
                     break;
 
-                case OP_SALIR:
-                    printf("Proceso solicitante %d terminó\n", sol.pid_solicitante);
+                case EVENTO_CONEXION:
+                    conexiones_leer(EVENTO_VALOR(dato), atender_solicitud);
                     break;
 
-                default:
-                    printf("Operación desconocida: %c\n", sol.operacion);
+                case EVENTO_MEMORIA:
+                    conexiones_memoria(EVENTO_VALOR(dato), atender_solicitud);
                     break;
             }
         }
+        sesiones_soltar();
     }
 
     close(pipe_fd);
+    close(guarda_fd);
+
+    // Despertar a los hilos de devoluciones para que vacíen la cola
+    anillo_cerrar(&buffer_devoluciones);
 
     // Esperar que terminen los hilos
-    pthread_join(hilo1, NULL);
+    despacho_detener();
+    for (int c = 0; c < num_consumidores; c++) {
+        pthread_join(hilos1[c], NULL);
+    }
     pthread_join(hilo2, NULL);
+    metricas_detener();
+    instantanea_detener();
+    wal_cerrar();
 
     // Guardar estado final
     guardar_estado_final();
 
     // Limpiar
     unlink(pipe_name);
-    pthread_mutex_destroy(&bd_mutex);
-    pthread_mutex_destroy(&reporte_mutex);
-    pthread_mutex_destroy(&buffer_renovaciones.mutex);
-    pthread_cond_destroy(&buffer_renovaciones.not_full);
-    pthread_cond_destroy(&buffer_renovaciones.not_empty);
+    if (usar_socket) {
+        conexiones_destruir();
+    }
+    catalogo_liberar();
+    catalogo_destruir_bloqueos();
+    sesiones_destruir();
+    eventos_destruir();
+    bitacora_liberar();
+    vencimientos_liberar();
+    busqueda_liberar();
+    anillo_destruir(&buffer_devoluciones);
 
     printf("Proceso receptor terminado\n");
 
@@ -0,0 +1,397 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: sesiones.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Implementación de la tabla de sesiones. El índice PID -> casilla
+ *              y la lista de casillas libres solo los toca el hilo lector, así
+ *              que no llevan bloqueo; el mutex de cada sesión protege su
+ *              descriptor y su salida pendiente frente a los trabajadores que
+ *              responden y al bucle de eventos que la vacía.
+ * =============================================================================
+ */
+
+#include "sesiones.h"
+#include "indice.h"
+#include "eventos.h"
+
+static sesion_t *sesiones = NULL;
+static int capacidad_sesiones = 0;
+static int *casillas_libres = NULL;
+static int num_libres = 0;
+static indice_t indice_sesiones;  // PID -> casilla
+static int max_en_vuelo = 0;
+
+// Sesiones con respuestas retenidas por el hilo lector (ver sesiones_retener)
+#define MAX_RETENIDAS 64
+static __thread int reteniendo = 0;
+static int retenidas[MAX_RETENIDAS];
+static int num_retenidas = 0;
+
+int sesiones_init(int capacidad, int max) {
+    sesiones = calloc(capacidad, sizeof(sesion_t));
+    casillas_libres = malloc(capacidad * sizeof(int));
+    if (!sesiones || !casillas_libres || indice_init(&indice_sesiones, capacidad) != 0) {
+        free(sesiones);
+        free(casillas_libres);
+        return -1;
+    }
+
+    capacidad_sesiones = capacidad;
+    max_en_vuelo = max;
+    for (int i = 0; i < capacidad; i++) {
+        pthread_mutex_init(&sesiones[i].mutex, NULL);
+        sesiones[i].fd = -1;
+        casillas_libres[i] = capacidad - 1 - i;
+    }
+    num_libres = capacidad;
+    return 0;
+}
+
+void sesiones_destruir(void) {
+    for (int i = 0; i < capacidad_sesiones; i++) {
+        if (sesiones[i].fd != -1) {
+            close(sesiones[i].fd);
+        }
+        pthread_mutex_destroy(&sesiones[i].mutex);
+        free(sesiones[i].salida);
+    }
+    free(sesiones);
+    free(casillas_libres);
+    indice_destruir(&indice_sesiones);
+    sesiones = NULL;
+    capacidad_sesiones = 0;
+}
+
+// Función para cerrar el descriptor de una casilla (con su mutex tomado)
+static void cerrar_casilla(sesion_t *s) {
+    if (s->fd != -1) {
+        // Un socket sigue abierto en su conexión: close() no lo quitaría
+        if (s->vigilada) {
+            eventos_quitar(s->fd);
+        }
+        close(s->fd);
+        s->fd = -1;
+    }
+    if (s->memoria) {
+        memoria_cerrar(s->memoria);
+        s->memoria = NULL;
+    }
+    s->pendiente = 0;
+    s->vigilada = 0;
+    s->en_vuelo = 0;
+    s->generacion++;
+}
+
+// Función para liberar la casilla de un PID (solo hilo lector)
+void sesiones_cerrar(int pid) {
+    int casilla = indice_buscar(&indice_sesiones, pid);
+    if (casilla == INDICE_NO_ENCONTRADO) {
+        return;
+    }
+
+    sesion_t *s = &sesiones[casilla];
+    pthread_mutex_lock(&s->mutex);
+    cerrar_casilla(s);
+    pthread_mutex_unlock(&s->mutex);
+
+    indice_eliminar(&indice_sesiones, pid);
+    casillas_libres[num_libres++] = casilla;
+}
+
+// Función para tomar una casilla libre y guardar en ella el descriptor
+// (solo hilo lector). Devuelve la casilla o -1.
+static int ocupar_casilla(int pid, int fd) {
+    if (num_libres == 0) {
+        fprintf(stderr, "Sin casillas de sesión libres para %d\n", pid);
+        close(fd);
+        return -1;
+    }
+
+    int casilla = casillas_libres[--num_libres];
+    sesion_t *s = &sesiones[casilla];
+    pthread_mutex_lock(&s->mutex);
+    s->fd = fd;
+    s->pid = pid;
+    pthread_mutex_unlock(&s->mutex);
+    return casilla;
+}
+
+// Función para abrir el pipe de respuesta de un solicitante y guardarlo. El
+// cliente ya tiene abierto el extremo de lectura, así que el open no falla.
+// El descriptor queda sin bloqueo. Devuelve la casilla o -1.
+int sesiones_conectar(int pid) {
+    sesiones_cerrar(pid);  // una sesión anterior del mismo PID queda obsoleta
+
+    char pipe_respuesta[MAX_STRING];
+    snprintf(pipe_respuesta, sizeof(pipe_respuesta), FORMATO_PIPE_RESPUESTA, pid);
+
+    int fd = open(pipe_respuesta, O_WRONLY | O_NONBLOCK);
+    if (fd == -1) {
+        perror("Error abriendo pipe de sesión");
+        return -1;
+    }
+
+    int casilla = ocupar_casilla(pid, fd);
+    if (casilla != -1) {
+        indice_insertar(&indice_sesiones, pid, casilla);
+    }
+    return casilla;
+}
+
+// Función para abrir la sesión de una conexión con una copia de su
+// descriptor. No entra en el índice de PIDs: un proceso puede tener varias
+// conexiones y cada una tiene la suya. Devuelve la casilla o -1.
+int sesiones_abrir_conexion(int pid, int conexion, unsigned *generacion) {
+    int fd = fcntl(conexion, F_DUPFD_CLOEXEC, 0);
+    if (fd == -1) {
+        perror("Error copiando conexión de sesión");
+        return -1;
+    }
+
+    int casilla = ocupar_casilla(pid, fd);
+    if (casilla != -1) {
+        pthread_mutex_lock(&sesiones[casilla].mutex);
+        *generacion = sesiones[casilla].generacion;
+        pthread_mutex_unlock(&sesiones[casilla].mutex);
+    }
+    return casilla;
+}
+
+// Función para cerrar la sesión de una conexión si sigue siendo la misma
+// generación; con 'liberar' la casilla vuelve a la lista de libres (solo
+// hilo lector, que es quien la ocupó)
+void sesiones_cerrar_conexion(int casilla, unsigned generacion, int liberar) {
+    if (casilla < 0 || casilla >= capacidad_sesiones) {
+        return;
+    }
+
+    sesion_t *s = &sesiones[casilla];
+    pthread_mutex_lock(&s->mutex);
+    if (s->generacion == generacion) {
+        cerrar_casilla(s);
+    }
+    pthread_mutex_unlock(&s->mutex);
+
+    if (liberar) {
+        casillas_libres[num_libres++] = casilla;
+    }
+}
+
+// Función para desviar las respuestas de una conexión a su anillo (solo
+// hilo lector)
+int sesiones_usar_memoria(int casilla, unsigned generacion, anillo_bytes_t *anillo) {
+    if (casilla < 0 || casilla >= capacidad_sesiones) {
+        return -1;
+    }
+
+    sesion_t *s = &sesiones[casilla];
+    int resultado = -1;
+    pthread_mutex_lock(&s->mutex);
+    if (s->fd != -1 && s->generacion == generacion) {
+        s->memoria = anillo;
+        resultado = 0;
+    }
+    pthread_mutex_unlock(&s->mutex);
+    return resultado;
+}
+
+// Función para anotar en la solicitud la sesión de su remitente (hilo lector).
+// Las que llegan por el socket ya traen la de su conexión.
+void sesiones_asignar(solicitud_t *sol) {
+    if (sol->conexion != -1) {
+        return;
+    }
+    sol->sesion = -1;
+    sol->sesion_gen = 0;
+
+    int casilla = indice_buscar(&indice_sesiones, sol->pid_solicitante);
+    if (casilla == INDICE_NO_ENCONTRADO) {
+        return;
+    }
+
+    sesion_t *s = &sesiones[casilla];
+    pthread_mutex_lock(&s->mutex);
+    int viva = (s->fd != -1);
+    unsigned generacion = s->generacion;
+    pthread_mutex_unlock(&s->mutex);
+
+    if (!viva) {
+        // Un trabajador la cerró por error de escritura: liberar la casilla
+        sesiones_cerrar(sol->pid_solicitante);
+        return;
+    }
+    sol->sesion = casilla;
+    sol->sesion_gen = generacion;
+}
+
+int sesiones_admitir(const solicitud_t *sol) {
+    if (max_en_vuelo <= 0 || sol->sesion < 0 || sol->sesion >= capacidad_sesiones) {
+        return 1;
+    }
+    sesion_t *s = &sesiones[sol->sesion];
+    pthread_mutex_lock(&s->mutex);
+    int admitida = (s->generacion != sol->sesion_gen || s->en_vuelo < max_en_vuelo);
+    if (admitida && s->generacion == sol->sesion_gen) {
+        s->en_vuelo++;
+    }
+    pthread_mutex_unlock(&s->mutex);
+    return admitida;
+}
+
+// Función para descontar una solicitud terminada. Si la sesión se cerró
+// entretanto, su cuenta ya volvió a cero con la nueva generación.
+void sesiones_terminar(const solicitud_t *sol) {
+    if (max_en_vuelo <= 0 || sol->sesion < 0 || sol->sesion >= capacidad_sesiones) {
+        return;
+    }
+    sesion_t *s = &sesiones[sol->sesion];
+    pthread_mutex_lock(&s->mutex);
+    if (s->generacion == sol->sesion_gen && s->en_vuelo > 0) {
+        s->en_vuelo--;
+    }
+    pthread_mutex_unlock(&s->mutex);
+}
+
+// Función para pedir al bucle de eventos un aviso (uno solo) cuando el pipe
+// de la casilla admita más datos (con el mutex tomado)
+static void vigilar(sesion_t *s, int casilla) {
+    uint32_t eventos = EPOLLOUT | EPOLLONESHOT;
+    uint64_t dato = EVENTO_DATO(EVENTO_SESION, casilla);
+    int error = s->vigilada ? eventos_modificar(s->fd, eventos, dato)
+                            : eventos_agregar(s->fd, eventos, dato);
+    if (error != 0) {
+        perror("Error vigilando pipe de sesión");
+        return;
+    }
+    s->vigilada = 1;
+}
+
+// Función para agregar datos al final de la salida pendiente (con el mutex
+// tomado). Devuelve -1 si se pasaría de SALIDA_MAX_SESION.
+static int encolar_salida(sesion_t *s, const uint8_t *datos, size_t largo) {
+    if (s->pendiente + largo > SALIDA_MAX_SESION) {
+        return -1;
+    }
+    if (s->pendiente + largo > s->capacidad_salida) {
+        size_t capacidad = s->capacidad_salida ? s->capacidad_salida : 8192;
+        while (capacidad < s->pendiente + largo) {
+            capacidad *= 2;
+        }
+        uint8_t *nueva = realloc(s->salida, capacidad);
+        if (!nueva) {
+            return -1;
+        }
+        s->salida = nueva;
+        s->capacidad_salida = capacidad;
+    }
+    memcpy(s->salida + s->pendiente, datos, largo);
+    s->pendiente += largo;
+    return 0;
+}
+
+// Función para escribir lo que el pipe acepte de la salida pendiente (con el
+// mutex tomado). Devuelve -1 si el cliente cerró su extremo.
+static int escribir_pendiente(sesion_t *s) {
+    size_t escritos = 0;
+    while (escritos < s->pendiente) {
+        ssize_t n = write(s->fd, s->salida + escritos, s->pendiente - escritos);
+        if (n > 0) {
+            escritos += n;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1 && errno == EAGAIN) {
+            break;
+        } else {
+            return -1;
+        }
+    }
+    memmove(s->salida, s->salida + escritos, s->pendiente - escritos);
+    s->pendiente -= escritos;
+    return 0;
+}
+
+// Función para escribir una respuesta por la sesión de la solicitud. Si hay
+// salida pendiente (o el pipe está lleno) la respuesta va detrás, para no
+// desordenar el flujo; nunca se espera al cliente.
+int sesiones_enviar(const solicitud_t *sol, const void *datos, size_t largo) {
+    if (sol->sesion < 0 || sol->sesion >= capacidad_sesiones) {
+        return SESION_INEXISTENTE;
+    }
+
+    sesion_t *s = &sesiones[sol->sesion];
+    int resultado = SESION_ENVIADO;
+
+    pthread_mutex_lock(&s->mutex);
+    if (s->fd == -1 || s->generacion != sol->sesion_gen) {
+        resultado = SESION_PERDIDA;
+    } else if (s->memoria) {
+        // El mutex hace de los trabajadores un solo productor del anillo
+        int aviso = memoria_escribir(s->memoria, datos, largo);
+        if (aviso == -1) {
+            cerrar_casilla(s);  // el cliente no lee: igual que SALIDA_MAX_SESION
+            resultado = SESION_PERDIDA;
+        } else if (aviso == 1) {
+            memoria_despertar(&s->memoria->esperando_datos);
+        }
+    } else {
+        int habia_pendiente = (s->pendiente > 0);
+        ssize_t n = 0;
+        if (!habia_pendiente && reteniendo && !s->retenida && num_retenidas < MAX_RETENIDAS) {
+            // El hilo lector la escribe al final de la tanda, con las que sigan
+            s->retenida = 1;
+            retenidas[num_retenidas++] = sol->sesion;
+            habia_pendiente = 1;
+        } else if (!habia_pendiente) {
+            n = write(s->fd, datos, largo);
+            if (n == -1 && (errno == EAGAIN || errno == EINTR)) {
+                n = 0;
+            }
+        }
+        if (n == -1 || ((size_t)n < largo &&
+                        encolar_salida(s, (const uint8_t *)datos + n, largo - n) != 0)) {
+            // El cliente cerró su extremo (EPIPE) o no lee: la sesión se descarta
+            cerrar_casilla(s);
+            resultado = SESION_PERDIDA;
+        } else if (!habia_pendiente && s->pendiente > 0) {
+            vigilar(s, sol->sesion);
+        }
+    }
+    pthread_mutex_unlock(&s->mutex);
+
+    return resultado;
+}
+
+void sesiones_vaciar(int casilla) {
+    if (casilla < 0 || casilla >= capacidad_sesiones) {
+        return;
+    }
+    sesion_t *s = &sesiones[casilla];
+
+    pthread_mutex_lock(&s->mutex);
+    if (s->fd != -1 && s->pendiente > 0) {
+        if (escribir_pendiente(s) != 0) {
+            cerrar_casilla(s);
+        } else if (s->pendiente > 0) {
+            vigilar(s, casilla);
+        }
+    }
+    pthread_mutex_unlock(&s->mutex);
+}
+
+void sesiones_retener(void) {
+    reteniendo = 1;
+}
+
+void sesiones_soltar(void) {
+    reteniendo = 0;
+    for (int i = 0; i < num_retenidas; i++) {
+        sesion_t *s = &sesiones[retenidas[i]];
+        pthread_mutex_lock(&s->mutex);
+        s->retenida = 0;
+        pthread_mutex_unlock(&s->mutex);
+        sesiones_vaciar(retenidas[i]);
+    }
+    num_retenidas = 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: sesiones.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Tabla de sesiones del receptor. Un solicitante que se conecta
+ *              con OP_CONECTAR deja su pipe de respuesta abierto durante toda
+ *              la sesión; el receptor guarda el descriptor (PID -> sesión) y
+ *              ya no hace open/close por cada respuesta. El descriptor no
+ *              bloquea: si el pipe está lleno la respuesta queda en la salida
+ *              pendiente de la sesión y el bucle de eventos la termina de
+ *              escribir cuando el cliente lee. Un cliente del socket Unix
+ *              recibe por una copia del descriptor de su conexión (una sesión
+ *              por conexión), o por el anillo de respuestas si la conexión
+ *              trajo memoria compartida.
+ * =============================================================================
+ */
+
+#ifndef SESIONES_H
+#define SESIONES_H
+
+#include "estructuras.h"
+#include "memoria.h"
+
+#define SESIONES_MAX 4096
+
+// Solicitudes de una sesión encoladas o en proceso a la vez (0: sin límite)
+#define EN_VUELO_POR_SESION_POR_DEFECTO 1024
+
+// Salida pendiente máxima por sesión: un cliente que se atrasa más se desconecta
+#define SALIDA_MAX_SESION (1 << 20)
+
+// Resultado de sesiones_enviar
+#define SESION_ENVIADO 0
+#define SESION_INEXISTENTE 1   // el cliente no tiene sesión: usar open/close
+#define SESION_PERDIDA -1      // la sesión se cerró; la respuesta se descarta
+
+// Sin sesión, cuánto se espera a que el solicitante abra su pipe para leer
+#define ESPERA_SIN_SESION_MS 100
+
+// Sesión de un solicitante. La generación cambia cada vez que la casilla se
+// cierra, así una respuesta tardía nunca llega a un cliente distinto.
+typedef struct {
+    pthread_mutex_t mutex;
+    int fd;
+    int pid;
+    unsigned generacion;
+    uint8_t *salida;            // respuestas que el pipe todavía no aceptó
+    size_t pendiente;           // bytes en salida
+    size_t capacidad_salida;
+    int vigilada;               // registrada en el bucle de eventos
+    int retenida;               // en la lista de sesiones_soltar
+    anillo_bytes_t *memoria;    // anillo de respuestas (NULL: se escribe en fd)
+    int en_vuelo;               // admitidas y todavía sin terminar
+} sesion_t;
+
+int sesiones_init(int capacidad, int max_en_vuelo);
+void sesiones_destruir(void);
+
+// Solo el hilo lector conecta, cierra y asigna sesiones. Las de los pipes se
+// buscan por PID; las del socket Unix, por la casilla y la generación que
+// guarda su conexión, así dos conexiones del mismo proceso no se pisan
+int sesiones_conectar(int pid);
+void sesiones_cerrar(int pid);
+void sesiones_asignar(solicitud_t *sol);
+int sesiones_abrir_conexion(int pid, int conexion, unsigned *generacion);
+void sesiones_cerrar_conexion(int casilla, unsigned generacion, int liberar);
+
+// Desde ahora las respuestas de la sesión de una conexión se copian en su
+// anillo de memoria compartida. Devuelve -1 si la sesión ya se cerró.
+int sesiones_usar_memoria(int casilla, unsigned generacion, anillo_bytes_t *anillo);
+
+// Control de admisión: el hilo lector admite una solicitud antes de
+// encolarla (0 si su sesión ya tiene max_en_vuelo) y quien la procesa avisa
+// al terminar. Las solicitudes sin sesión no se cuentan.
+int sesiones_admitir(const solicitud_t *sol);
+void sesiones_terminar(const solicitud_t *sol);
+
+// Cualquier hilo puede responder por la sesión asignada a una solicitud
+int sesiones_enviar(const solicitud_t *sol, const void *datos, size_t largo);
+
+// El bucle de eventos avisa que el pipe de una casilla admite más datos
+void sesiones_vaciar(int casilla);
+
+// Mientras el hilo lector atiende una tanda de eventos, sus respuestas se
+// juntan en la salida de cada sesión; sesiones_soltar las escribe con un
+// write por sesión en lugar de uno por respuesta
+void sesiones_retener(void);
+void sesiones_soltar(void);
+
+#endif // SESIONES_H
@@ -7,16 +7,92 @@
  * Descripción: Implementa el proceso solicitante que puede enviar solicitudes
  *              de préstamo, devolución y renovación de libros a través de pipes
  *              nombrados. Soporta modo interactivo y procesamiento por lotes.
+ *              También consulta los ejemplares vencidos (-V, líneas V, menú)
+ *              y la disponibilidad de uno o varios ISBN (líneas A, menú), y
+ *              busca libros por palabras del título (líneas B, menú).
+ *              Con -u habla con el receptor por su socket Unix en lugar de
+ *              los pipes, y agrupa las solicitudes en un solo writev(). Con
+ *              -u y -M las solicitudes y respuestas pasan por anillos en
+ *              memoria compartida con el receptor (ver memoria.h). Si el
+ *              receptor responde que está ocupado, la solicitud se reintenta
+ *              con esperas exponenciales con variación aleatoria.
  * =============================================================================
  */
 
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
 #include "estructuras.h"
+#include "memoria.h"
+#include "protocolo.h"
+
+// Tiempo máximo de espera del saludo de sesión
+#define TIMEOUT_SESION_MS 5000
+
+// Reintentos ante RES_OCUPADO (la espera, en espera_reintento_us)
+#define REINTENTOS_MAX 8
 
 // Variables globales
 char pipe_name[MAX_STRING];
 char input_file[MAX_STRING];
 int usar_archivo = 0;
 int pipe_fd;
+int resp_fd = -1;   // pipe de respuesta, abierto durante toda la sesión
+lector_t lector_respuestas; // lo que llegó por resp_fd y aún no se leyó
+formato_t formato = FORMATO_BINARIO;  // -L: estructuras fijas del formato legado
+char pipe_respuesta[MAX_STRING];
+
+// -u: socket Unix. Las solicitudes se juntan y salen en un solo writev()
+// cuando hace falta una respuesta, al salir o cuando se llena el grupo.
+#define MAX_AGRUPADAS 64
+
+char ruta_socket[MAX_STRING];
+int usar_socket = 0;
+uint8_t agrupadas[MAX_AGRUPADAS][PROTO_MAX_TRAMA];
+struct iovec iov_agrupadas[MAX_AGRUPADAS];
+int num_agrupadas = 0;
+
+// -M: anillos en memoria compartida; el socket queda para el arranque y
+// para enterarse de que el receptor terminó
+int usar_memoria = 0;
+memoria_t *memoria = NULL;
+int aviso_fd = -1;   // eventfd por el que se despierta al receptor
+
+// Modo en tubería: el id de cada solicitud lleva su casilla en los bits bajos
+#define BITS_CASILLA 16
+#define MASCARA_CASILLA ((1u << BITS_CASILLA) - 1)
+#define MAX_EN_VUELO 4096
+
+typedef struct {
+    solicitud_t sol;
+    int activa;
+    int intentos;   // veces que el receptor la rechazó por ocupado
+} pendiente_t;
+
+int en_vuelo_max = 1;
+pendiente_t *pendientes = NULL;
+unsigned *casillas_libres = NULL;
+int num_casillas_libres = 0;
+unsigned contador_solicitudes = 0;
+
+// Modo lote (-b N): las líneas P/R/D consecutivas viajan en un solo mensaje
+int tam_lote = 1;
+lote_t lote_actual;
+char nombres_lote[MAX_LOTE][MAX_STRING];
+
+// Consultas de disponibilidad: las líneas A consecutivas viajan juntas
+consulta_t consulta_actual;
+char nombres_consulta[MAX_CONSULTA][MAX_STRING];
+
+// -V fecha|hoy: solo consultar los vencidos y salir
+int solo_vencidos = 0;
+int fecha_vencidos = SIN_FECHA;
+
+unsigned semilla_reintentos;
 
 // Función para mostrar el menú
 void mostrar_menu() {
@@ -25,6 +101,9 @@ void mostrar_menu() {
     printf("2. Renovar libro (R)\n");
     printf("3. Solicitar préstamo (P)\n");
     printf("4. Salir (Q)\n");
+    printf("5. Listar vencidos (V)\n");
+    printf("6. Consultar disponibilidad (A)\n");
+    printf("7. Buscar por título (B)\n");
     printf("Seleccione una opción: ");
 }
 
@@ -38,17 +117,98 @@ operation_t obtener_operacion_menu() {
         case 2: return OP_RENOVAR;
         case 3: return OP_PRESTAR;
         case 4: return OP_SALIR;
+        case 5: return OP_VENCIDOS;
+        case 6: return OP_CONSULTAR;
+        case 7: return OP_BUSCAR;
         default:
             printf("Opción inválida\n");
             return obtener_operacion_menu();
     }
 }
 
+// Función para escribir de una vez las solicitudes agrupadas en el socket.
+// writev puede quedarse corto (señal): se sigue desde donde quedó.
+int vaciar_agrupadas() {
+    struct iovec *iov = iov_agrupadas;
+    int num = num_agrupadas;
+    num_agrupadas = 0;
+
+    while (num > 0) {
+        ssize_t n = writev(pipe_fd, iov, num);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error escribiendo en socket");
+            return -1;
+        }
+        while (num > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            num--;
+        }
+        if (num > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+// Función para saber si el receptor sigue al otro lado del socket. Con -M
+// no escribe nada por él, así que cualquier evento es el cierre.
+int receptor_vivo() {
+    struct pollfd pfd = { .fd = pipe_fd, .events = POLLIN };
+    return poll(&pfd, 1, 0) == 0;
+}
+
+// Función para copiar una trama en el anillo de solicitudes. Si el receptor
+// dormía se lo despierta por el eventfd; si el anillo está lleno se espera.
+int escribir_en_memoria(const uint8_t *trama, size_t largo) {
+    anillo_bytes_t *anillo = &memoria->solicitudes;
+    int aviso;
+    while ((aviso = memoria_escribir(anillo, trama, largo)) == -1) {
+        if (!receptor_vivo()) {
+            fprintf(stderr, "Error escribiendo solicitud: el receptor cerró la sesión\n");
+            return -1;
+        }
+        memoria_esperar_espacio(anillo, largo);
+    }
+    if (aviso == 1) {
+        eventfd_write(aviso_fd, 1);
+    }
+    return 0;
+}
+
 // Función para enviar solicitud
 int enviar_solicitud(solicitud_t *sol) {
     sol->pid_solicitante = getpid();
+    sol->sesion = -1;
+    sol->sesion_gen = 0;
 
-    if (write(pipe_fd, sol, sizeof(solicitud_t)) == -1) {
+    if (usar_memoria) {
+        uint8_t buf[PROTO_MAX_TRAMA];
+        return escribir_en_memoria(buf, protocolo_codificar_solicitud(sol, formato, buf));
+    }
+
+    if (usar_socket) {
+        uint8_t *buf = agrupadas[num_agrupadas];
+        iov_agrupadas[num_agrupadas].iov_base = buf;
+        iov_agrupadas[num_agrupadas].iov_len = protocolo_codificar_solicitud(sol, formato, buf);
+        num_agrupadas++;
+
+        // OP_SALIR no tiene respuesta que obligue a vaciar el grupo
+        if (num_agrupadas == MAX_AGRUPADAS || sol->operacion == OP_SALIR) {
+            return vaciar_agrupadas();
+        }
+        return 0;
+    }
+
+    uint8_t buf[PROTO_MAX_TRAMA];
+    size_t largo = protocolo_codificar_solicitud(sol, formato, buf);
+
+    // Un solo write de menos de PIPE_BUF: no se mezcla con otros solicitantes
+    if (write(pipe_fd, buf, largo) == -1) {
         perror("Error escribiendo en pipe");
         return -1;
     }
@@ -56,38 +216,560 @@ int enviar_solicitud(solicitud_t *sol) {
     return 0;
 }
 
-// Función para recibir respuesta
+// Función para sacar una respuesta del anillo de respuestas. Se duerme en
+// su futex solo cuando está vacío, y cada MEMORIA_ESPERA_MS se comprueba que
+// el receptor siga vivo.
+int recibir_de_memoria(respuesta_t *resp) {
+    anillo_bytes_t *anillo = &memoria->respuestas;
+    for (;;) {
+        int r = lector_siguiente_respuesta(&lector_respuestas, formato, resp);
+        if (r != 0) {
+            return r == 1 ? 0 : -1;
+        }
+
+        size_t espacio;
+        uint8_t *destino = lector_espacio(&lector_respuestas, &espacio);
+        size_t n = memoria_leer(anillo, destino, espacio);
+        if (n > 0) {
+            lector_agregar(&lector_respuestas, n);
+            continue;
+        }
+        if (__atomic_load_n(&anillo->cerrado, __ATOMIC_ACQUIRE)) {
+            // Lo escrito antes del cierre ya está a la vista
+            n = memoria_leer(anillo, destino, espacio);
+            if (n == 0) {
+                return -1;
+            }
+            lector_agregar(&lector_respuestas, n);
+            continue;
+        }
+        if (!receptor_vivo()) {
+            return -1;
+        }
+        memoria_esperar_datos(anillo);
+    }
+}
+
+// Función para leer una respuesta completa del pipe de sesión
 int recibir_respuesta(respuesta_t *resp) {
-    char pipe_respuesta[MAX_STRING];
-    snprintf(pipe_respuesta, sizeof(pipe_respuesta), "/tmp/resp_%d", getpid());
+    if (usar_memoria) {
+        if (recibir_de_memoria(resp) != 0) {
+            fprintf(stderr, "Error leyendo respuesta: el receptor cerró la sesión\n");
+            return -1;
+        }
+        return 0;
+    }
+    if (num_agrupadas > 0 && vaciar_agrupadas() != 0) {
+        return -1;
+    }
+    if (lector_leer_respuesta(&lector_respuestas, resp_fd, formato, resp) != 0) {
+        fprintf(stderr, "Error leyendo respuesta: el receptor cerró la sesión\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Función para esperar antes del reintento número 'intento' (desde 0)
+void esperar_reintento(int intento) {
+    usleep(espera_reintento_us(intento, &semilla_reintentos));
+}
 
-    // Crear pipe nombrado para respuesta
-    if (mkfifo(pipe_respuesta, 0666) == -1) {
-        if (errno != EEXIST) {
-            perror("Error creando pipe de respuesta");
+// Función para enviar una solicitud y recibir su (primera) respuesta,
+// reintentando mientras el receptor esté ocupado. Tras REINTENTOS_MAX
+// rechazos devuelve la respuesta RES_OCUPADO tal cual.
+int solicitar(solicitud_t *sol, respuesta_t *resp) {
+    respuesta_t plantilla = *resp;  // arreglos donde decodificar
+    for (int intento = 0; ; intento++) {
+        *resp = plantilla;
+        if (enviar_solicitud(sol) != 0 || recibir_respuesta(resp) != 0) {
             return -1;
         }
+        if (resp->codigo != RES_OCUPADO || intento == REINTENTOS_MAX) {
+            return 0;
+        }
+        esperar_reintento(intento);
     }
+}
 
-    int resp_fd = open(pipe_respuesta, O_RDONLY);
+// Función para conectarse al socket del receptor. La conexión ya es la
+// sesión: las respuestas vuelven por el mismo socket.
+int conectar_socket() {
+    struct sockaddr_un direccion = { .sun_family = AF_UNIX };
+    if (strlen(ruta_socket) >= sizeof(direccion.sun_path)) {
+        printf("Error: ruta de socket demasiado larga: %s\n", ruta_socket);
+        return -1;
+    }
+    strcpy(direccion.sun_path, ruta_socket);
+
+    pipe_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (pipe_fd == -1 || connect(pipe_fd, (struct sockaddr *)&direccion, sizeof(direccion)) != 0) {
+        perror("Error conectando al socket");
+        return -1;
+    }
+    resp_fd = pipe_fd;
+    return 0;
+}
+
+// Función para crear el segmento compartido y el eventfd y mandárselos al
+// receptor por el socket (SCM_RIGHTS, con un byte que el lector descarta).
+// El receptor marca 'listo' cuando lo adoptó.
+int compartir_memoria() {
+    int segmento_fd = memfd_create("solicitante", MFD_CLOEXEC);
+    if (segmento_fd == -1 || ftruncate(segmento_fd, sizeof(memoria_t)) != 0) {
+        perror("Error creando memoria compartida");
+        return -1;
+    }
+    memoria = mmap(NULL, sizeof(memoria_t), PROT_READ | PROT_WRITE, MAP_SHARED, segmento_fd, 0);
+    aviso_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (memoria == MAP_FAILED || aviso_fd == -1) {
+        perror("Error creando memoria compartida");
+        close(segmento_fd);
+        return -1;
+    }
+    memoria->magia = MEMORIA_MAGIA;
+    memoria->solicitudes.esperando_datos = 1;  // el receptor duerme en epoll
+
+    uint8_t marca = 0;
+    struct iovec iov = { .iov_base = &marca, .iov_len = 1 };
+    union {
+        struct cmsghdr cabecera;
+        char datos[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = control.datos, .msg_controllen = sizeof(control.datos) };
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    int fds[2] = { segmento_fd, aviso_fd };
+    memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+
+    ssize_t n = sendmsg(pipe_fd, &msg, 0);
+    close(segmento_fd);
+    if (n != 1) {
+        perror("Error enviando memoria compartida");
+        return -1;
+    }
+
+    for (int t = 0; t < TIMEOUT_SESION_MS / MEMORIA_ESPERA_MS &&
+                    !__atomic_load_n(&memoria->listo, __ATOMIC_ACQUIRE); t++) {
+        memoria_esperar(&memoria->listo, 0);
+    }
+    if (!__atomic_load_n(&memoria->listo, __ATOMIC_ACQUIRE)) {
+        fprintf(stderr, "El receptor no aceptó la memoria compartida\n");
+        return -1;
+    }
+    usar_memoria = 1;
+    return 0;
+}
+
+// Función para abrir la sesión con el receptor. El pipe de respuesta se crea
+// y se abre una sola vez; el receptor guarda su extremo de escritura hasta
+// que llega OP_SALIR.
+int abrir_sesion() {
+    snprintf(pipe_respuesta, sizeof(pipe_respuesta), FORMATO_PIPE_RESPUESTA, getpid());
+
+    if (mkfifo(pipe_respuesta, 0666) == -1 && errno != EEXIST) {
+        perror("Error creando pipe de respuesta");
+        return -1;
+    }
+
+    // Abrir sin bloquear para que el receptor encuentre un lector al conectarse
+    resp_fd = open(pipe_respuesta, O_RDONLY | O_NONBLOCK);
     if (resp_fd == -1) {
         perror("Error abriendo pipe de respuesta");
+        unlink(pipe_respuesta);
         return -1;
     }
 
-    if (read(resp_fd, resp, sizeof(respuesta_t)) == -1) {
-        perror("Error leyendo respuesta");
-        close(resp_fd);
+    solicitud_t sol = {0};
+    sol.operacion = OP_CONECTAR;
+    strcpy(sol.nombre_libro, "Conectar");
+    if (enviar_solicitud(&sol) != 0) {
+        unlink(pipe_respuesta);
+        return -1;
+    }
+
+    struct pollfd pfd = { .fd = resp_fd, .events = POLLIN };
+    if (poll(&pfd, 1, TIMEOUT_SESION_MS) <= 0) {
+        fprintf(stderr, "El receptor no respondió al saludo de sesión\n");
+        unlink(pipe_respuesta);
         return -1;
     }
 
-    close(resp_fd);
+    // Ambos extremos están abiertos: el nombre ya no hace falta
     unlink(pipe_respuesta);
+    fcntl(resp_fd, F_SETFL, fcntl(resp_fd, F_GETFL) & ~O_NONBLOCK);
+
+    respuesta_t resp;
+    if (recibir_respuesta(&resp) != 0 || resp.codigo != RES_SESION_ESTABLECIDA) {
+        fprintf(stderr, "No se pudo establecer la sesión\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Función para mostrar la respuesta a una solicitud
+void mostrar_respuesta(const solicitud_t *sol, const respuesta_t *resp) {
+    char mensaje[MAX_STRING];
+    formatear_mensaje(resp, mensaje, sizeof(mensaje));
+
+    if (en_vuelo_max > 1) {
+        printf("Respuesta #%u (%c, %d): %s\n", resp->id_solicitud,
+               sol->operacion, sol->isbn, mensaje);
+    } else {
+        printf("Respuesta: %s\n", mensaje);
+    }
+    if (sol->operacion == OP_RENOVAR && resultado_exitoso(resp->codigo)) {
+        char fecha[LARGO_FECHA];
+        fecha_a_texto(resp->fecha_devolucion, fecha);
+        printf("Nueva fecha de devolución: %s\n", fecha);
+    }
+}
+
+// Función para esperar una respuesta y emparejarla con su solicitud pendiente
+// por id (las respuestas pueden llegar en otro orden). Devuelve 0 si emparejó.
+int completar_pendiente() {
+    respuesta_t resp;
+    if (recibir_respuesta(&resp) != 0) {
+        return -1;
+    }
+
+    unsigned casilla = resp.id_solicitud & MASCARA_CASILLA;
+    if ((int)casilla >= en_vuelo_max || !pendientes[casilla].activa ||
+        pendientes[casilla].sol.id_solicitud != resp.id_solicitud) {
+        printf("Respuesta con id desconocido: %u\n", resp.id_solicitud);
+        return 0;
+    }
 
+    // Rechazada: se vuelve a mandar con el mismo id, sin liberar la casilla
+    pendiente_t *p = &pendientes[casilla];
+    if (resp.codigo == RES_OCUPADO && p->intentos < REINTENTOS_MAX) {
+        esperar_reintento(p->intentos++);
+        return enviar_solicitud(&p->sol);
+    }
+
+    mostrar_respuesta(&pendientes[casilla].sol, &resp);
+    pendientes[casilla].activa = 0;
+    casillas_libres[num_casillas_libres++] = casilla;
+    return 0;
+}
+
+// Función para enviar una solicitud sin esperar su respuesta. Si ya hay
+// en_vuelo_max solicitudes pendientes, primero espera a que llegue una.
+int enviar_en_tuberia(solicitud_t *sol) {
+    while (num_casillas_libres == 0) {
+        if (completar_pendiente() != 0) {
+            return -1;
+        }
+    }
+
+    unsigned casilla = casillas_libres[--num_casillas_libres];
+    sol->id_solicitud = (++contador_solicitudes << BITS_CASILLA) | casilla;
+    if (enviar_solicitud(sol) != 0) {
+        casillas_libres[num_casillas_libres++] = casilla;
+        return -1;
+    }
+
+    pendientes[casilla].sol = *sol;
+    pendientes[casilla].activa = 1;
+    pendientes[casilla].intentos = 0;
+    return 0;
+}
+
+// Función para enviar el lote acumulado y mostrar su vector de resultados
+int enviar_lote() {
+    if (lote_actual.num == 0) {
+        return 0;
+    }
+
+    solicitud_t sol = {0};
+    sol.operacion = OP_LOTE;
+    sol.id_solicitud = ++contador_solicitudes;
+    sol.lote = &lote_actual;
+
+    resultado_lote_t resultados[MAX_LOTE];
+    respuesta_t resp = {0};
+    resp.resultados = resultados;
+
+    printf("Enviando lote #%u con %d operaciones\n", sol.id_solicitud, lote_actual.num);
+    if (solicitar(&sol, &resp) != 0) {
+        printf("Error procesando lote\n");
+        return -1;
+    }
+    if (resp.codigo == RES_OCUPADO) {
+        printf("Lote #%u: receptor ocupado, no se procesó\n", sol.id_solicitud);
+        lote_actual.num = 0;
+        return 0;
+    }
+
+    for (int i = 0; i < resp.num_resultados && i < lote_actual.num; i++) {
+        respuesta_t parcial = {0};
+        char mensaje[MAX_STRING];
+
+        parcial.codigo = resultados[i].codigo;
+        parcial.fecha_devolucion = resultados[i].fecha_devolucion;
+        formatear_mensaje(&parcial, mensaje, sizeof(mensaje));
+        printf("Lote #%u [%d] (%c, %s, %d): %s\n", resp.id_solicitud, i,
+               lote_actual.ops[i].operacion, nombres_lote[i], lote_actual.ops[i].isbn, mensaje);
+    }
+
+    lote_actual.num = 0;
+    return 0;
 }
 
-// Función para procesar archivo de entrada
-// Función corregida para procesar archivo de entrada
+// Función para agregar una solicitud al lote, enviándolo si se llenó
+int agregar_a_lote(const solicitud_t *sol) {
+    lote_actual.ops[lote_actual.num].operacion = sol->operacion;
+    lote_actual.ops[lote_actual.num].isbn = sol->isbn;
+    strcpy(nombres_lote[lote_actual.num], sol->nombre_libro);
+    lote_actual.num++;
+
+    if (lote_actual.num == tam_lote) {
+        return enviar_lote();
+    }
+    return 0;
+}
+
+// Función para enviar la consulta de disponibilidad acumulada y mostrar su
+// resultado. Primero se recoge lo pendiente para no mezclar respuestas.
+int enviar_consulta() {
+    if (consulta_actual.num == 0) {
+        return 0;
+    }
+    if (formato == FORMATO_LEGADO) {
+        printf("Error: la consulta de disponibilidad no existe en el formato legado (-L)\n");
+        consulta_actual.num = 0;
+        return 0;
+    }
+    enviar_lote();
+    while (num_casillas_libres < en_vuelo_max && completar_pendiente() == 0) {
+    }
+
+    solicitud_t sol = {0};
+    sol.operacion = OP_CONSULTAR;
+    sol.id_solicitud = ++contador_solicitudes;
+    sol.consulta = &consulta_actual;
+
+    disponibilidad_t disponibilidades[MAX_CONSULTA];
+    respuesta_t resp = {0};
+    resp.disponibilidades = disponibilidades;
+
+    if (solicitar(&sol, &resp) != 0) {
+        printf("Error procesando consulta de disponibilidad\n");
+        return -1;
+    }
+    if (resp.codigo == RES_OCUPADO || !resp.disponibilidades) {
+        printf("Error procesando consulta de disponibilidad%s\n",
+               resp.codigo == RES_OCUPADO ? ": receptor ocupado" : "");
+        consulta_actual.num = 0;
+        return resp.codigo == RES_OCUPADO ? 0 : -1;
+    }
+    for (int i = 0; i < resp.num_disponibilidades && i < consulta_actual.num; i++) {
+        printf("Disponibilidad #%u (%s, %d): ", resp.id_solicitud,
+               nombres_consulta[i], consulta_actual.isbn[i]);
+        if (disponibilidades[i].codigo == RES_DISPONIBILIDAD) {
+            printf("%d disponibles, %d prestados\n",
+                   disponibilidades[i].disponibles, disponibilidades[i].prestados);
+        } else {
+            respuesta_t parcial = {0};
+            char mensaje[MAX_STRING];
+            parcial.codigo = disponibilidades[i].codigo;
+            formatear_mensaje(&parcial, mensaje, sizeof(mensaje));
+            printf("%s\n", mensaje);
+        }
+    }
+
+    consulta_actual.num = 0;
+    return 0;
+}
+
+// Función para agregar un ISBN a la consulta, enviándola si se llenó
+int agregar_a_consulta(const solicitud_t *sol) {
+    consulta_actual.isbn[consulta_actual.num] = sol->isbn;
+    strcpy(nombres_consulta[consulta_actual.num], sol->nombre_libro);
+    consulta_actual.num++;
+
+    if (consulta_actual.num == MAX_CONSULTA) {
+        return enviar_consulta();
+    }
+    return 0;
+}
+
+// Función para buscar libros cuyo título contiene todas las palabras de texto
+// y mostrar su ISBN. Primero se recoge lo pendiente para no mezclar respuestas.
+int buscar_titulo(const char *texto) {
+    if (formato == FORMATO_LEGADO) {
+        printf("Error: la búsqueda por título no existe en el formato legado (-L)\n");
+        return 0;
+    }
+    enviar_consulta();
+    enviar_lote();
+    while (num_casillas_libres < en_vuelo_max && completar_pendiente() == 0) {
+    }
+
+    solicitud_t sol = {0};
+    sol.operacion = OP_BUSCAR;
+    sol.id_solicitud = ++contador_solicitudes;
+    snprintf(sol.nombre_libro, sizeof(sol.nombre_libro), "%s", texto);
+
+    libro_encontrado_t encontrados[MAX_ENCONTRADOS];
+    respuesta_t resp = {0};
+    resp.encontrados = encontrados;
+
+    if (solicitar(&sol, &resp) != 0) {
+        printf("Error procesando búsqueda\n");
+        return -1;
+    }
+    if (resp.codigo == RES_OCUPADO || !resp.encontrados) {
+        printf("Error procesando búsqueda%s\n", resp.codigo == RES_OCUPADO ? ": receptor ocupado" : "");
+        return resp.codigo == RES_OCUPADO ? 0 : -1;
+    }
+    printf("Búsqueda \"%s\": %d títulos%s\n", texto, resp.num_encontrados,
+           resp.hay_mas ? " (hay más; agregue palabras para acotar)" : "");
+    for (int i = 0; i < resp.num_encontrados; i++) {
+        printf("  %d, %s\n", encontrados[i].isbn, encontrados[i].nombre);
+    }
+    return 0;
+}
+
+// Función para leer la fecha de corte de una consulta de vencidos:
+// dd-mm-aaaa u "hoy" (SIN_FECHA). Devuelve 0 si es válida.
+int leer_fecha_corte(const char *texto, int *fecha) {
+    if (strcmp(texto, "hoy") == 0) {
+        *fecha = SIN_FECHA;
+        return 0;
+    }
+    *fecha = fecha_de_texto(texto, strlen(texto));
+    if (*fecha == SIN_FECHA) {
+        printf("Fecha de corte inválida (se espera dd-mm-aaaa u hoy): %s\n", texto);
+        return -1;
+    }
+    return 0;
+}
+
+// Función para consultar los ejemplares prestados que vencen antes de
+// fecha_corte (SIN_FECHA: hoy). La lista llega en varios tramos; el receptor
+// marca el último. Primero se recoge lo pendiente para no mezclar respuestas.
+int consultar_vencidos(int fecha_corte) {
+    if (formato == FORMATO_LEGADO) {
+        printf("Error: la consulta de vencidos no existe en el formato legado (-L)\n");
+        return -1;
+    }
+    enviar_lote();
+    while (num_casillas_libres < en_vuelo_max && completar_pendiente() == 0) {
+    }
+
+    solicitud_t sol = {0};
+    sol.operacion = OP_VENCIDOS;
+    sol.id_solicitud = ++contador_solicitudes;
+    sol.fecha_corte = fecha_corte;
+
+    // Solo el primer tramo puede ser un rechazo: después ya está en proceso
+    vencido_t vencidos[VENCIDOS_POR_TRAMA];
+    respuesta_t resp = {0};
+    resp.vencidos = vencidos;
+    if (solicitar(&sol, &resp) != 0) {
+        return -1;
+    }
+    if (resp.codigo == RES_OCUPADO) {
+        printf("Error consultando vencidos: receptor ocupado\n");
+        return -1;
+    }
+
+    int total = 0;
+    printf("ISBN, Ejemplar, Fecha devolución\n");
+    for (int primero = 1; ; primero = 0) {
+        if (!primero) {
+            resp.vencidos = vencidos;
+            if (recibir_respuesta(&resp) != 0) {
+                return -1;
+            }
+        }
+        if (!resp.vencidos) {
+            printf("Error consultando vencidos\n");
+            return -1;
+        }
+        for (int i = 0; i < resp.num_vencidos; i++) {
+            char fecha[LARGO_FECHA];
+            fecha_a_texto(vencidos[i].fecha, fecha);
+            printf("%d, %d, %s\n", vencidos[i].isbn, vencidos[i].ejemplar, fecha);
+        }
+        total += resp.num_vencidos;
+        if (resp.ultimo_tramo) {
+            break;
+        }
+    }
+    printf("Ejemplares vencidos: %d\n", total);
+    return 0;
+}
+
+// Función para parsear una línea "OPERACION, NOMBRE_LIBRO, ISBN" (en las
+// líneas V el segundo campo es la fecha de corte: dd-mm-aaaa u hoy, y en las
+// B, las palabras a buscar en los títulos).
+// Devuelve 1 si la línea produjo una solicitud.
+int parsear_linea(char *linea, solicitud_t *sol) {
+    // Remover salto de línea
+    linea[strcspn(linea, "\n")] = 0;
+
+    // Ignorar líneas vacías
+    if (strlen(linea) == 0) {
+        return 0;
+    }
+
+    // Usar un parsing más robusto
+    char *token1 = strtok(linea, ",");
+    char *token2 = strtok(NULL, ",");
+    char *token3 = strtok(NULL, ",");
+
+    if (token1 == NULL || token2 == NULL || token3 == NULL) {
+        printf("Error parseando línea: %s\n", linea);
+        return 0;
+    }
+
+    // Limpiar espacios en blanco
+    while (*token1 == ' ') token1++;  // Quitar espacios del inicio
+    while (*token2 == ' ') token2++;
+    while (*token3 == ' ') token3++;
+
+    // Convertir carácter a operation_t
+    switch(token1[0]) {
+        case 'P':
+            sol->operacion = OP_PRESTAR;
+            break;
+        case 'R':
+            sol->operacion = OP_RENOVAR;
+            break;
+        case 'D':
+            sol->operacion = OP_DEVOLVER;
+            break;
+        case 'Q':
+            sol->operacion = OP_SALIR;
+            break;
+        case 'V':
+            sol->operacion = OP_VENCIDOS;
+            return leer_fecha_corte(token2, &sol->fecha_corte) == 0;
+        case 'A':
+            sol->operacion = OP_CONSULTAR;
+            break;
+        case 'B':
+            sol->operacion = OP_BUSCAR;
+            break;
+        default:
+            printf("Operación desconocida: %c\n", token1[0]);
+            return 0;
+    }
+
+    snprintf(sol->nombre_libro, sizeof(sol->nombre_libro), "%s", token2);
+    sol->isbn = atoi(token3);
+    return 1;
+}
+
+// Función para procesar archivo de entrada. Con -n 1 (por defecto) cada
+// solicitud espera su respuesta; con -n N hay hasta N solicitudes en vuelo y
+// con -b N se envían lotes de hasta N operaciones. Las líneas A consecutivas
+// se consultan juntas (hasta MAX_CONSULTA ISBN por mensaje).
 void procesar_archivo() {
     FILE *file = fopen(input_file, "r");
     if (!file) {
@@ -97,96 +779,85 @@ void procesar_archivo() {
 
     char linea[MAX_LINE];
     while (fgets(linea, sizeof(linea), file)) {
-        // Remover salto de línea
-        linea[strcspn(linea, "\n")] = 0;
-        
-        // Ignorar líneas vacías
-        if (strlen(linea) == 0) {
+        solicitud_t sol = {0};
+        if (!parsear_linea(linea, &sol)) {
             continue;
         }
 
-        // Parsear línea con formato: "OPERACION, NOMBRE_LIBRO, ISBN"
-        char op_char;
-        char nombre[MAX_STRING];
-        int isbn;
-
-        // Usar un parsing más robusto
-        char *token1 = strtok(linea, ",");
-        char *token2 = strtok(NULL, ",");
-        char *token3 = strtok(NULL, ",");
-        
-        if (token1 == NULL || token2 == NULL || token3 == NULL) {
-            printf("Error parseando línea: %s\n", linea);
+        if (sol.operacion == OP_CONSULTAR) {
+            if (agregar_a_consulta(&sol) != 0) {
+                break;
+            }
             continue;
         }
-        
-        // Limpiar espacios en blanco
-        while (*token1 == ' ') token1++;  // Quitar espacios del inicio
-        while (*token2 == ' ') token2++;
-        while (*token3 == ' ') token3++;
-        
-        op_char = token1[0];
-        strcpy(nombre, token2);
-        isbn = atoi(token3);
-
-        // Crear solicitud
-        solicitud_t sol;
-        
-        // Convertir carácter a operation_t
-        switch(op_char) {
-            case 'P':
-                sol.operacion = OP_PRESTAR;
-                break;
-            case 'R':
-                sol.operacion = OP_RENOVAR;
-                break;
-            case 'D':
-                sol.operacion = OP_DEVOLVER;
-                break;
-            case 'Q':
-                sol.operacion = OP_SALIR;
-                break;
-            default:
-                printf("Operación desconocida: %c\n", op_char);
-                continue;
+        if (enviar_consulta() != 0) {
+            break;
         }
-        
-        strcpy(sol.nombre_libro, nombre);
-        sol.isbn = isbn;
 
-        // Si es comando de salir
+        // Si es comando de salir: primero recoger todo lo pendiente
         if (sol.operacion == OP_SALIR) {
+            enviar_lote();
+            while (num_casillas_libres < en_vuelo_max && completar_pendiente() == 0) {
+            }
             printf("Comando de salir detectado\n");
             enviar_solicitud(&sol);
             break;
         }
 
-        // Enviar solicitud
-        printf("Enviando: %c, %s, %d\n", op_char, nombre, isbn);
-        if (enviar_solicitud(&sol) == 0) {
-            respuesta_t resp;
-            if (recibir_respuesta(&resp) == 0) {
-                printf("Respuesta: %s\n", resp.mensaje);
-                if (sol.operacion == OP_RENOVAR && resp.exito) {
-                    printf("Nueva fecha de devolución: %s\n", resp.fecha_devolucion);
-                }
-            } else {
-                printf("Error recibiendo respuesta\n");
+        if (sol.operacion == OP_VENCIDOS) {
+            if (consultar_vencidos(sol.fecha_corte) != 0) {
+                break;
+            }
+            continue;
+        }
+
+        if (sol.operacion == OP_BUSCAR) {
+            if (buscar_titulo(sol.nombre_libro) != 0) {
+                break;
+            }
+            continue;
+        }
+
+        if (tam_lote > 1) {
+            if (agregar_a_lote(&sol) != 0) {
+                break;
             }
+            continue;
+        }
+
+        if (en_vuelo_max > 1) {
+            if (enviar_en_tuberia(&sol) != 0) {
+                printf("Error enviando solicitud\n");
+                break;
+            }
+            continue;
+        }
+
+        // Enviar solicitud
+        printf("Enviando: %c, %s, %d\n", sol.operacion, sol.nombre_libro, sol.isbn);
+        respuesta_t resp = {0};
+        if (solicitar(&sol, &resp) == 0) {
+            mostrar_respuesta(&sol, &resp);
         } else {
-            printf("Error enviando solicitud\n");
+            printf("Error procesando solicitud\n");
         }
-        
+
         // Pequeña pausa para evitar saturar el sistema
         usleep(100000); // 100ms
     }
 
+    // Archivo sin Q: esperar igualmente las respuestas pendientes
+    enviar_consulta();
+    enviar_lote();
+    while (num_casillas_libres < en_vuelo_max && completar_pendiente() == 0) {
+    }
+
     fclose(file);
 }
 
 // Función para procesar menú interactivo
 void procesar_menu() {
-    solicitud_t sol;
+    solicitud_t sol = {0};
     respuesta_t resp;
 
     while (1) {
@@ -201,6 +872,44 @@ void procesar_menu() {
             break;
         }
 
+        if (sol.operacion == OP_VENCIDOS) {
+            char texto[MAX_STRING];
+            printf("Ingrese la fecha de corte (dd-mm-aaaa o hoy): ");
+            if (scanf("%63s", texto) == 1 && leer_fecha_corte(texto, &sol.fecha_corte) == 0) {
+                consultar_vencidos(sol.fecha_corte);
+            }
+            continue;
+        }
+
+        if (sol.operacion == OP_CONSULTAR) {
+            char isbns[MAX_LINE];
+            printf("Ingrese uno o más ISBN separados por espacios: ");
+            getchar(); // consumir newline
+            if (fgets(isbns, sizeof(isbns), stdin)) {
+                char *resto = NULL;
+                for (char *tok = strtok_r(isbns, " \t\n", &resto); tok;
+                     tok = strtok_r(NULL, " \t\n", &resto)) {
+                    solicitud_t consulta = {0};
+                    consulta.isbn = atoi(tok);
+                    strcpy(consulta.nombre_libro, "-");
+                    agregar_a_consulta(&consulta);
+                }
+                enviar_consulta();
+            }
+            continue;
+        }
+
+        if (sol.operacion == OP_BUSCAR) {
+            char texto[MAX_STRING];
+            printf("Ingrese palabras del título: ");
+            getchar(); // consumir newline
+            if (fgets(texto, sizeof(texto), stdin)) {
+                texto[strcspn(texto, "\n")] = '\0';
+                buscar_titulo(texto);
+            }
+            continue;
+        }
+
         printf("Ingrese el nombre del libro: ");
         getchar(); // consumir newline
         fgets(sol.nombre_libro, sizeof(sol.nombre_libro), stdin);
@@ -209,25 +918,40 @@ void procesar_menu() {
         printf("Ingrese el ISBN: ");
         scanf("%d", &sol.isbn);
 
-        // Enviar solicitud
-        if (enviar_solicitud(&sol) == 0) {
-            if (recibir_respuesta(&resp) == 0) {
-                printf("\nRespuesta del sistema: %s\n", resp.mensaje);
-                if (sol.operacion == OP_RENOVAR && resp.exito) {
-                    printf("Nueva fecha de devolución: %s\n", resp.fecha_devolucion);
-                }
+        // Enviar solicitud (con reintentos si el receptor está ocupado)
+        resp = (respuesta_t){0};
+        if (solicitar(&sol, &resp) == 0) {
+            char mensaje[MAX_STRING];
+            formatear_mensaje(&resp, mensaje, sizeof(mensaje));
+            printf("\nRespuesta del sistema: %s\n", mensaje);
+            if (sol.operacion == OP_RENOVAR && resultado_exitoso(resp.codigo)) {
+                char fecha[LARGO_FECHA];
+                fecha_a_texto(resp.fecha_devolucion, fecha);
+                printf("Nueva fecha de devolución: %s\n", fecha);
             }
         }
     }
 }
 
+// Función para cerrar los descriptores del receptor (con -u son uno solo)
+void cerrar_descriptores() {
+    if (pipe_fd > 0) {
+        close(pipe_fd);
+    }
+    if (resp_fd != -1 && resp_fd != pipe_fd) {
+        close(resp_fd);
+    }
+    if (aviso_fd != -1) {
+        close(aviso_fd);
+    }
+}
+
 // Función para manejar señales
 void signal_handler(int sig) {
     if (sig == SIGINT) {
         printf("\nCerrando proceso solicitante...\n");
-        if (pipe_fd > 0) {
-            close(pipe_fd);
-        }
+        cerrar_descriptores();
+        unlink(pipe_respuesta);
         exit(0);
     }
 }
@@ -235,10 +959,11 @@ void signal_handler(int sig) {
 int main(int argc, char *argv[]) {
     // Configurar manejo de señales
     signal(SIGINT, signal_handler);
+    semilla_reintentos = (unsigned)getpid() ^ (unsigned)time(NULL);
 
     // Parsear argumentos
     if (argc < 3) {
-        printf("Uso: %s [-i archivo] -p pipeReceptor\n", argv[0]);
+        printf("Uso: %s [-i archivo] -p pipeReceptor | -u socket [-M] [-n en_vuelo | -b tam_lote] [-L] [-V fecha|hoy]\n", argv[0]);
         exit(1);
     }
 
@@ -249,25 +974,95 @@ int main(int argc, char *argv[]) {
             strcpy(input_file, argv[++i]);
         } else if (strcmp(argv[i], "-p") == 0) {
             strcpy(pipe_name, argv[++i]);
+        } else if (strcmp(argv[i], "-u") == 0) {
+            usar_socket = 1;
+            strcpy(ruta_socket, argv[++i]);
+        } else if (strcmp(argv[i], "-M") == 0) {
+            usar_memoria = 1;
+        } else if (strcmp(argv[i], "-n") == 0) {
+            en_vuelo_max = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0) {
+            tam_lote = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-L") == 0) {
+            formato = FORMATO_LEGADO;
+        } else if (strcmp(argv[i], "-V") == 0) {
+            solo_vencidos = 1;
+            if (++i >= argc || leer_fecha_corte(argv[i], &fecha_vencidos) != 0) {
+                printf("Error: -V necesita una fecha dd-mm-aaaa u hoy\n");
+                exit(1);
+            }
         }
         i++;
     }
 
-    if (strlen(pipe_name) == 0) {
-        printf("Error: Debe especificar el pipe receptor con -p\n");
+    if (strlen(pipe_name) == 0 && !usar_socket) {
+        printf("Error: Debe especificar el pipe receptor con -p o el socket con -u\n");
+        exit(1);
+    }
+
+    if (usar_memoria && !usar_socket) {
+        printf("Error: -M necesita el socket del receptor (-u)\n");
         exit(1);
     }
+    // Se activa cuando el receptor adopta el segmento
+    int pedir_memoria = usar_memoria;
+    usar_memoria = 0;
 
-    // Abrir pipe para comunicación
-    pipe_fd = open(pipe_name, O_WRONLY);
-    if (pipe_fd == -1) {
-        perror("Error abriendo pipe");
+    if (en_vuelo_max < 1 || en_vuelo_max > MAX_EN_VUELO) {
+        printf("Error: -n debe estar entre 1 y %d\n", MAX_EN_VUELO);
+        exit(1);
+    }
+    if (formato == FORMATO_LEGADO && en_vuelo_max > 1) {
+        printf("Error: el formato legado (-L) no lleva id de solicitud; use -n 1\n");
+        exit(1);
+    }
+    if (tam_lote < 1 || tam_lote > MAX_LOTE) {
+        printf("Error: -b debe estar entre 1 y %d\n", MAX_LOTE);
+        exit(1);
+    }
+    if (tam_lote > 1 && (formato == FORMATO_LEGADO || en_vuelo_max > 1)) {
+        printf("Error: -b no se combina con -L ni con -n\n");
+        exit(1);
+    }
+    pendientes = calloc(en_vuelo_max, sizeof(pendiente_t));
+    casillas_libres = malloc(en_vuelo_max * sizeof(unsigned));
+    if (!pendientes || !casillas_libres) {
+        perror("Error reservando solicitudes pendientes");
         exit(1);
     }
+    for (int c = 0; c < en_vuelo_max; c++) {
+        casillas_libres[num_casillas_libres++] = en_vuelo_max - 1 - c;
+    }
+
+    if (usar_socket) {
+        if (conectar_socket() != 0 || (pedir_memoria && compartir_memoria() != 0)) {
+            exit(1);
+        }
+    } else {
+        // Abrir pipe para comunicación
+        pipe_fd = open(pipe_name, O_WRONLY);
+        if (pipe_fd == -1) {
+            perror("Error abriendo pipe");
+            exit(1);
+        }
+
+        if (abrir_sesion() != 0) {
+            close(pipe_fd);
+            exit(1);
+        }
+    }
 
     printf("Proceso solicitante iniciado (PID: %d)\n", getpid());
 
-    if (usar_archivo) {
+    if (solo_vencidos) {
+        int resultado = consultar_vencidos(fecha_vencidos);
+        solicitud_t salir = {0};
+        salir.operacion = OP_SALIR;
+        strcpy(salir.nombre_libro, "Salir");
+        enviar_solicitud(&salir);
+        cerrar_descriptores();
+        return resultado == 0 ? 0 : 1;
+    } else if (usar_archivo) {
         printf("Procesando archivo: %s\n", input_file);
         procesar_archivo();
     } else {
@@ -275,7 +1070,7 @@ int main(int argc, char *argv[]) {
         procesar_menu();
     }
 
-    close(pipe_fd);
+    cerrar_descriptores();
     printf("Proceso solicitante terminado\n");
 
     return 0;
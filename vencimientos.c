@@ -0,0 +1,234 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: vencimientos.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Montículos de fechas de devolución por franja (ver
+ *              vencimientos.h). Listar los vencidos recorre cada montículo
+ *              desde la raíz y no baja por un nodo que todavía no vence: visita
+ *              solo los k vencidos y sus hijos, y después se ordenan en
+ *              O(k log k), sin tocar los ejemplares que están al día.
+ * =============================================================================
+ */
+
+#include "vencimientos.h"
+#include "catalogo.h"
+
+typedef struct {
+    int fecha;
+    int libro;
+    int ejemplar;       // posición global en pool_ejemplares
+} entrada_vencimiento_t;
+
+// Montículo de una franja (alineado para que franjas vecinas no compartan línea)
+typedef struct {
+    entrada_vencimiento_t *entradas;
+    int num;
+    int capacidad;
+} __attribute__((aligned(TAM_LINEA_CACHE))) monticulo_t;
+
+static monticulo_t *monticulos = NULL;
+static int num_monticulos = 0;
+static int *posiciones = NULL;  // por ejemplar: posición en su montículo, -1 si no está
+
+static void colocar(monticulo_t *m, int i, entrada_vencimiento_t e) {
+    m->entradas[i] = e;
+    posiciones[e.ejemplar] = i;
+}
+
+static void subir(monticulo_t *m, int i) {
+    entrada_vencimiento_t e = m->entradas[i];
+    while (i > 0) {
+        int padre = (i - 1) / 2;
+        if (m->entradas[padre].fecha <= e.fecha) {
+            break;
+        }
+        colocar(m, i, m->entradas[padre]);
+        i = padre;
+    }
+    colocar(m, i, e);
+}
+
+static void bajar(monticulo_t *m, int i) {
+    entrada_vencimiento_t e = m->entradas[i];
+    for (;;) {
+        int hijo = 2 * i + 1;
+        if (hijo >= m->num) {
+            break;
+        }
+        if (hijo + 1 < m->num && m->entradas[hijo + 1].fecha < m->entradas[hijo].fecha) {
+            hijo++;
+        }
+        if (e.fecha <= m->entradas[hijo].fecha) {
+            break;
+        }
+        colocar(m, i, m->entradas[hijo]);
+        i = hijo;
+    }
+    colocar(m, i, e);
+}
+
+static int insertar(monticulo_t *m, entrada_vencimiento_t e) {
+    if (m->num == m->capacidad) {
+        int capacidad = m->capacidad ? m->capacidad * 2 : 64;
+        entrada_vencimiento_t *nuevas = realloc(m->entradas, capacidad * sizeof(*nuevas));
+        if (!nuevas) {
+            return -1;
+        }
+        m->entradas = nuevas;
+        m->capacidad = capacidad;
+    }
+    colocar(m, m->num++, e);
+    subir(m, m->num - 1);
+    return 0;
+}
+
+static void quitar(monticulo_t *m, int i) {
+    posiciones[m->entradas[i].ejemplar] = -1;
+    m->num--;
+    if (i == m->num) {
+        return;
+    }
+    entrada_vencimiento_t ultima = m->entradas[m->num];
+    colocar(m, i, ultima);
+    if (i > 0 && m->entradas[(i - 1) / 2].fecha > ultima.fecha) {
+        subir(m, i);
+    } else {
+        bajar(m, i);
+    }
+}
+
+int vencimientos_iniciar(void) {
+    num_monticulos = catalogo_num_franjas();
+    monticulos = aligned_alloc(TAM_LINEA_CACHE, num_monticulos * sizeof(monticulo_t));
+    posiciones = malloc((num_ejemplares_total > 0 ? num_ejemplares_total : 1) * sizeof(int));
+    if (!monticulos || !posiciones) {
+        return -1;
+    }
+    memset(monticulos, 0, num_monticulos * sizeof(monticulo_t));
+
+    for (int i = 0; i < num_libros; i++) {
+        for (int j = 0; j < biblioteca[i].num_ejemplares; j++) {
+            posiciones[biblioteca[i].ejemplares + j - pool_ejemplares] = -1;
+            vencimientos_actualizar(i, j);
+        }
+    }
+    return 0;
+}
+
+void vencimientos_liberar(void) {
+    for (int i = 0; i < num_monticulos; i++) {
+        free(monticulos[i].entradas);
+    }
+    free(monticulos);
+    free(posiciones);
+    monticulos = NULL;
+    posiciones = NULL;
+    num_monticulos = 0;
+}
+
+void vencimientos_actualizar(int libro_idx, int ejemplar) {
+    if (!monticulos) {
+        return;
+    }
+    const ejemplar_t *e = &biblioteca[libro_idx].ejemplares[ejemplar];
+    monticulo_t *m = &monticulos[catalogo_franja(libro_idx)];
+    int global = e - pool_ejemplares;
+    int pos = posiciones[global];
+
+    if (e->status != STATUS_PRESTADO) {
+        if (pos != -1) {
+            quitar(m, pos);
+        }
+        return;
+    }
+    if (pos == -1) {
+        entrada_vencimiento_t nueva = { e->fecha, libro_idx, global };
+        if (insertar(m, nueva) != 0) {
+            fprintf(stderr, "Sin memoria para el índice de vencimientos\n");
+        }
+        return;
+    }
+    int anterior = m->entradas[pos].fecha;
+    m->entradas[pos].fecha = e->fecha;
+    if (e->fecha < anterior) {
+        subir(m, pos);
+    } else {
+        bajar(m, pos);
+    }
+}
+
+static int comparar_vencidos(const void *a, const void *b) {
+    const vencido_t *x = a, *y = b;
+    if (x->fecha != y->fecha) {
+        return (x->fecha > y->fecha) - (x->fecha < y->fecha);
+    }
+    if (x->isbn != y->isbn) {
+        return (x->isbn > y->isbn) - (x->isbn < y->isbn);
+    }
+    return (x->ejemplar > y->ejemplar) - (x->ejemplar < y->ejemplar);
+}
+
+int vencimientos_listar(int antes_de, vencido_t **lista) {
+    int num = 0, capacidad = 64;
+    vencido_t *vencidos = malloc(capacidad * sizeof(vencido_t));
+    int *pendientes = NULL;
+    int capacidad_pendientes = 0;
+
+    if (!vencidos) {
+        return -1;
+    }
+    for (int f = 0; f < num_monticulos; f++) {
+        monticulo_t *m = &monticulos[f];
+        catalogo_bloquear_franja_lectura(f);
+
+        // Recorrido desde la raíz: si un nodo no vence, tampoco sus hijos
+        int tope = 0;
+        if (m->num > 0 && m->entradas[0].fecha < antes_de) {
+            if (capacidad_pendientes < m->num) {
+                int *nuevos = realloc(pendientes, m->num * sizeof(int));
+                if (!nuevos) {
+                    catalogo_desbloquear_franja(f);
+                    free(pendientes);
+                    free(vencidos);
+                    return -1;
+                }
+                pendientes = nuevos;
+                capacidad_pendientes = m->num;
+            }
+            pendientes[tope++] = 0;
+        }
+        while (tope > 0) {
+            const entrada_vencimiento_t *e = &m->entradas[pendientes[--tope]];
+            if (num == capacidad) {
+                vencido_t *nuevos = realloc(vencidos, 2 * capacidad * sizeof(vencido_t));
+                if (!nuevos) {
+                    catalogo_desbloquear_franja(f);
+                    free(pendientes);
+                    free(vencidos);
+                    return -1;
+                }
+                vencidos = nuevos;
+                capacidad *= 2;
+            }
+            vencidos[num].isbn = biblioteca[e->libro].isbn;
+            vencidos[num].ejemplar = pool_ejemplares[e->ejemplar].numero;
+            vencidos[num].fecha = e->fecha;
+            num++;
+
+            int hijo = 2 * (int)(e - m->entradas) + 1;
+            for (int h = hijo; h <= hijo + 1 && h < m->num; h++) {
+                if (m->entradas[h].fecha < antes_de) {
+                    pendientes[tope++] = h;
+                }
+            }
+        }
+        catalogo_desbloquear_franja(f);
+    }
+    free(pendientes);
+
+    qsort(vencidos, num, sizeof(vencido_t), comparar_vencidos);
+    *lista = vencidos;
+    return num;
+}
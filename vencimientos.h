@@ -0,0 +1,35 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: vencimientos.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Índice de fechas de devolución para encontrar ejemplares
+ *              vencidos sin recorrer el catálogo. Cada franja de bloqueo tiene
+ *              su montículo mínimo con los ejemplares prestados de sus libros,
+ *              ordenado por fecha de devolución y protegido por la misma
+ *              franja. Una posición por ejemplar permite mover o quitar una
+ *              entrada en O(log n) al renovar o devolver.
+ * =============================================================================
+ */
+
+#ifndef VENCIMIENTOS_H
+#define VENCIMIENTOS_H
+
+#include "estructuras.h"
+
+// Se llama con el catálogo cargado (y el WAL reaplicado) y antes de atender
+// solicitudes: arma los montículos con los ejemplares prestados
+int vencimientos_iniciar(void);
+void vencimientos_liberar(void);
+
+// Refleja en el índice el estado actual de un ejemplar (posición dentro del
+// libro). Se llama con la franja del libro bloqueada para escritura.
+void vencimientos_actualizar(int libro_idx, int ejemplar);
+
+// Devuelve en *lista (reservada aquí, la libera quien llama) los ejemplares
+// prestados con fecha de devolución anterior a antes_de, ordenados por fecha.
+// Toma cada franja para lectura por separado. Devuelve la cantidad o -1.
+int vencimientos_listar(int antes_de, vencido_t **lista);
+
+#endif // VENCIMIENTOS_H
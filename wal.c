@@ -0,0 +1,430 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: wal.c
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Implementación del registro declarado en wal.h. Los hilos
+ *              agregan registros a un buffer en memoria bajo wal_mutex; el hilo
+ *              del WAL intercambia ese buffer por uno vacío, lo escribe con un
+ *              solo write y un fdatasync, y avisa hasta qué LSN es durable.
+ *              Mientras dura un fdatasync se acumulan los registros siguientes,
+ *              que viajan todos juntos en el próximo.
+ * =============================================================================
+ */
+
+#include <libgen.h>
+
+#include "wal.h"
+#include "catalogo.h"
+
+static char archivo_wal[MAX_STRING];
+static char archivo_anterior[MAX_STRING + 16];
+static int wal_activo = 0;
+static int wal_fd = -1;
+static pthread_t hilo_wal;
+static pthread_mutex_t wal_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t hay_pendientes = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t hay_durables = PTHREAD_COND_INITIALIZER;
+
+// Buffer donde se agregan registros y buffer que el hilo está escribiendo
+static registro_wal_t *pendientes = NULL;
+static size_t num_pendientes = 0;
+static size_t capacidad_pendientes = 0;
+static registro_wal_t *en_escritura = NULL;
+static size_t capacidad_escritura = 0;
+
+static uint64_t siguiente_lsn = 1;
+static uint64_t lsn_durable = 0;
+static int cerrar_wal = 0;
+static int error_wal = 0;
+static int rotacion_pedida = 0;
+static uint64_t lsn_rotacion = 0;
+
+// Último LSN registrado por cada hilo: es lo que wal_sincronizar espera
+static __thread uint64_t ultimo_lsn_hilo = 0;
+
+static uint32_t tabla_crc[256];
+
+static void init_crc(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        tabla_crc[i] = c;
+    }
+}
+
+static uint32_t crc_registro(const registro_wal_t *reg) {
+    const uint8_t *p = (const uint8_t *)reg + sizeof(reg->crc);
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < sizeof(*reg) - sizeof(reg->crc); i++) {
+        c = tabla_crc[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+static int escribir_magia(int fd) {
+    return write(fd, WAL_MAGIA, WAL_TAM_MAGIA) == WAL_TAM_MAGIA ? 0 : -1;
+}
+
+// Función para reaplicar un segmento del registro sobre el catálogo recién
+// cargado. Los cambios anteriores a lsn_minimo ya están en la instantánea y se
+// saltan. Devuelve el desplazamiento del primer byte no válido (donde el
+// archivo debe truncarse; 0 si ni la marca llegó a escribirse), -1 si no se
+// pudo leer o -2 si el segmento es de otro formato.
+static off_t reproducir(int fd, uint64_t lsn_minimo, int *aplicados, int *ignorados) {
+    registro_wal_t reg;
+    char magia[WAL_TAM_MAGIA];
+    uint64_t ultimo = 0;
+
+    ssize_t n = read(fd, magia, sizeof(magia));
+    if (n < (ssize_t)sizeof(magia)) {
+        return n == -1 ? -1 : 0;
+    }
+    if (memcmp(magia, WAL_MAGIA, WAL_TAM_MAGIA) != 0) {
+        return -2;
+    }
+    off_t valido = WAL_TAM_MAGIA;
+
+    while ((n = read(fd, &reg, sizeof(reg))) == (ssize_t)sizeof(reg)) {
+        if (reg.crc != crc_registro(&reg) || reg.lsn <= ultimo) {
+            break;  // escritura a medias del último grupo: fin del registro
+        }
+        valido += sizeof(reg);
+        ultimo = reg.lsn;
+        if (reg.lsn >= siguiente_lsn) {
+            siguiente_lsn = reg.lsn + 1;
+        }
+        if (reg.lsn < lsn_minimo) {
+            continue;
+        }
+
+        int idx = encontrar_libro(reg.isbn);
+        if (idx == -1 || reg.ejemplar < 0 || reg.ejemplar >= biblioteca[idx].num_ejemplares) {
+            (*ignorados)++;
+            continue;
+        }
+        libro_cambiar_estado(&biblioteca[idx], reg.ejemplar, (status_t)reg.status);
+        biblioteca[idx].ejemplares[reg.ejemplar].fecha = reg.fecha;
+        (*aplicados)++;
+    }
+    if (n == -1) {
+        return -1;
+    }
+    return valido;
+}
+
+// Función para hacer durable la creación o el renombre de un archivo
+int sincronizar_directorio(const char *ruta) {
+    char copia[MAX_STRING];
+    snprintf(copia, sizeof(copia), "%s", ruta);
+
+    int fd = open(dirname(copia), O_RDONLY | O_DIRECTORY);
+    if (fd == -1) {
+        perror("Error abriendo directorio");
+        return -1;
+    }
+    int r = fsync(fd);
+    close(fd);
+    return r;
+}
+
+// Función para pasar el segmento actual a <archivo>.anterior y abrir uno
+// nuevo (hilo del WAL, sin wal_mutex). El segmento viejo ya tiene fdatasync.
+static void rotar_segmento(void) {
+    if (rename(archivo_wal, archivo_anterior) != 0) {
+        perror("Error rotando el WAL");
+        return;
+    }
+    int fd = open(archivo_wal, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd != -1 && escribir_magia(fd) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    if (fd == -1) {
+        perror("Error abriendo nuevo segmento del WAL");
+        rename(archivo_anterior, archivo_wal);  // seguir en el mismo segmento
+        return;
+    }
+    sincronizar_directorio(archivo_wal);
+    close(wal_fd);
+    wal_fd = fd;
+}
+
+// Función para escribir un grupo al final del segmento y hacerlo durable
+// (hilo del WAL, sin wal_mutex). Devuelve -1 si algo falló.
+static int escribir_grupo(const registro_wal_t *grupo, size_t num) {
+    size_t bytes = num * sizeof(registro_wal_t);
+    size_t escritos = 0;
+    while (escritos < bytes) {
+        ssize_t r = write(wal_fd, (const char *)grupo + escritos, bytes - escritos);
+        if (r == -1 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return -1;
+        }
+        escritos += r;
+    }
+    return fdatasync(wal_fd);
+}
+
+// Función para escribir un grupo con reintentos. Antes de cada reintento se
+// trunca lo que haya quedado del intento anterior: un registro a medias en
+// el medio haría que la recuperación descarte todo lo que viene detrás.
+// Devuelve -1 si el grupo no llegó al disco.
+static int escribir_grupo_reintentando(const registro_wal_t *grupo, size_t num) {
+    off_t inicio = lseek(wal_fd, 0, SEEK_CUR);
+    if (inicio == -1) {
+        perror("Error escribiendo el WAL");
+        return -1;
+    }
+    for (int intento = 0; intento <= WAL_REINTENTOS; intento++) {
+        if (intento > 0) {
+            usleep(WAL_ESPERA_REINTENTO_MS * 1000 * intento);
+            if (ftruncate(wal_fd, inicio) != 0 || lseek(wal_fd, inicio, SEEK_SET) == -1) {
+                perror("Error descartando escritura incompleta del WAL");
+                return -1;
+            }
+        }
+        if (escribir_grupo(grupo, num) == 0) {
+            return 0;
+        }
+        perror("Error escribiendo el WAL");
+    }
+    // Lo que haya quedado no es durable ni se confirmó: no debe reaplicarse
+    if (ftruncate(wal_fd, inicio) != 0 || lseek(wal_fd, inicio, SEEK_SET) == -1) {
+        perror("Error descartando escritura incompleta del WAL");
+    }
+    return -1;
+}
+
+// Hilo del WAL: escribe en grupo todo lo pendiente. Si un grupo no se puede
+// escribir, el WAL queda en error: lsn_durable ya no avanza y los grupos
+// siguientes se descartan, porque detrás de un hueco no serían recuperables.
+static void *hilo_escritor_wal(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&wal_mutex);
+    while (1) {
+        while (num_pendientes == 0 && !cerrar_wal && !rotacion_pedida) {
+            pthread_cond_wait(&hay_pendientes, &wal_mutex);
+        }
+        if (num_pendientes == 0 && !rotacion_pedida) {
+            break;  // cerrando y sin nada más que escribir
+        }
+        int rotar = rotacion_pedida;
+        int fallido = error_wal;
+
+        // Intercambiar buffers: los trabajadores siguen agregando al vacío
+        registro_wal_t *grupo = pendientes;
+        size_t num_grupo = num_pendientes;
+        size_t capacidad_grupo = capacidad_pendientes;
+        pendientes = en_escritura;
+        capacidad_pendientes = capacidad_escritura;
+        num_pendientes = 0;
+        en_escritura = grupo;
+        capacidad_escritura = capacidad_grupo;
+        uint64_t hasta = siguiente_lsn - 1;
+        pthread_mutex_unlock(&wal_mutex);
+
+        int fallo = fallido || escribir_grupo_reintentando(grupo, num_grupo) != 0;
+        if (rotar && !fallo) {
+            rotar_segmento();
+        }
+
+        pthread_mutex_lock(&wal_mutex);
+        if (fallo && !error_wal) {
+            fprintf(stderr, "El WAL no se pudo escribir: los cambios desde el LSN %llu "
+                    "no son durables\n", (unsigned long long)(lsn_durable + 1));
+            error_wal = 1;
+        }
+        if (rotar) {
+            // Sin rotar, el corte es lo último que de verdad está en disco
+            rotacion_pedida = 0;
+            lsn_rotacion = fallo ? lsn_durable + 1 : hasta + 1;
+        }
+        if (!fallo) {
+            lsn_durable = hasta;
+        }
+        pthread_cond_broadcast(&hay_durables);
+    }
+    pthread_mutex_unlock(&wal_mutex);
+    return NULL;
+}
+
+// Función para abrir un segmento, reaplicarlo y truncar su cola inválida
+static int recuperar_segmento(const char *archivo, uint64_t lsn_minimo, int flags,
+                              int *aplicados, int *ignorados) {
+    int fd = open(archivo, flags, 0644);
+    if (fd == -1) {
+        return -1;
+    }
+
+    off_t valido = reproducir(fd, lsn_minimo, aplicados, ignorados);
+    if (valido == -2) {
+        fprintf(stderr, "%s no tiene el formato %s (¿es de una versión anterior?)\n",
+                archivo, WAL_MAGIA);
+        close(fd);
+        return -2;
+    }
+    if (valido == -1 || ftruncate(fd, valido) != 0 || lseek(fd, valido, SEEK_SET) == -1 ||
+        (valido == 0 && escribir_magia(fd) != 0)) {
+        perror("Error recuperando el WAL");
+        close(fd);
+        return -2;
+    }
+    return fd;
+}
+
+// Función para reaplicar el WAL existente y abrirlo para seguir agregando.
+// Debe llamarse después de cargar el catálogo y antes de atender solicitudes.
+// Si una instantánea se interrumpió queda un segmento anterior: va primero.
+int wal_iniciar(const char *archivo, uint64_t lsn_minimo) {
+    init_crc();
+    snprintf(archivo_wal, sizeof(archivo_wal), "%s", archivo);
+    snprintf(archivo_anterior, sizeof(archivo_anterior), "%s.anterior", archivo);
+    siguiente_lsn = lsn_minimo > 0 ? lsn_minimo : 1;
+
+    int aplicados = 0, ignorados = 0;
+    int fd = recuperar_segmento(archivo_anterior, lsn_minimo, O_RDWR, &aplicados, &ignorados);
+    if (fd == -2) {
+        return -1;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    wal_fd = recuperar_segmento(archivo, lsn_minimo, O_RDWR | O_CREAT, &aplicados, &ignorados);
+    if (wal_fd < 0) {
+        if (wal_fd == -1) {
+            perror("Error abriendo el WAL");
+        }
+        wal_fd = -1;
+        return -1;
+    }
+    printf("WAL %s: %d cambios reaplicados", archivo, aplicados);
+    if (ignorados > 0) {
+        printf(" (%d ignorados: libro o ejemplar inexistente)", ignorados);
+    }
+    printf("\n");
+
+    capacidad_pendientes = capacidad_escritura = WAL_CAPACIDAD_INICIAL;
+    pendientes = malloc(capacidad_pendientes * sizeof(registro_wal_t));
+    en_escritura = malloc(capacidad_escritura * sizeof(registro_wal_t));
+    lsn_durable = siguiente_lsn - 1;
+    cerrar_wal = 0;
+    if (!pendientes || !en_escritura ||
+        pthread_create(&hilo_wal, NULL, hilo_escritor_wal, NULL) != 0) {
+        fprintf(stderr, "Error iniciando el WAL\n");
+        free(pendientes);
+        free(en_escritura);
+        close(wal_fd);
+        wal_fd = -1;
+        return -1;
+    }
+    wal_activo = 1;
+    return 0;
+}
+
+// Función para escribir lo pendiente y detener el hilo del WAL
+void wal_cerrar(void) {
+    if (!wal_activo) {
+        return;
+    }
+    wal_activo = 0;
+
+    pthread_mutex_lock(&wal_mutex);
+    cerrar_wal = 1;
+    pthread_cond_signal(&hay_pendientes);
+    pthread_mutex_unlock(&wal_mutex);
+    pthread_join(hilo_wal, NULL);
+
+    close(wal_fd);
+    wal_fd = -1;
+    free(pendientes);
+    free(en_escritura);
+    pendientes = en_escritura = NULL;
+}
+
+int wal_registrar(operation_t operacion, const libro_t *libro, int ejemplar) {
+    if (!wal_activo) {
+        return 0;
+    }
+
+    registro_wal_t reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.operacion = (uint32_t)operacion;
+    reg.isbn = libro->isbn;
+    reg.ejemplar = ejemplar;
+    reg.status = libro->ejemplares[ejemplar].status;
+    reg.fecha = libro->ejemplares[ejemplar].fecha;
+
+    pthread_mutex_lock(&wal_mutex);
+    if (num_pendientes == capacidad_pendientes) {
+        registro_wal_t *nuevo = realloc(pendientes, 2 * capacidad_pendientes * sizeof(registro_wal_t));
+        if (!nuevo) {
+            pthread_mutex_unlock(&wal_mutex);
+            fprintf(stderr, "Sin memoria para el WAL: cambio de %d no registrado\n", libro->isbn);
+            return -1;
+        }
+        pendientes = nuevo;
+        capacidad_pendientes *= 2;
+    }
+    reg.lsn = siguiente_lsn++;
+    reg.crc = crc_registro(&reg);
+    pendientes[num_pendientes++] = reg;
+    if (num_pendientes == 1) {
+        pthread_cond_signal(&hay_pendientes);
+    }
+    pthread_mutex_unlock(&wal_mutex);
+
+    ultimo_lsn_hilo = reg.lsn;
+    return 0;
+}
+
+int wal_sincronizar(void) {
+    if (!wal_activo || ultimo_lsn_hilo == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&wal_mutex);
+    while (lsn_durable < ultimo_lsn_hilo && !error_wal) {
+        pthread_cond_wait(&hay_durables, &wal_mutex);
+    }
+    int durable = (lsn_durable >= ultimo_lsn_hilo);
+    pthread_mutex_unlock(&wal_mutex);
+    return durable ? 0 : -1;
+}
+
+uint64_t wal_rotar(void) {
+    if (!wal_activo) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&wal_mutex);
+    if (access(archivo_anterior, F_OK) == 0) {
+        // Una instantánea anterior falló: su segmento sigue haciendo falta
+        uint64_t lsn = siguiente_lsn;
+        pthread_mutex_unlock(&wal_mutex);
+        return lsn;
+    }
+    rotacion_pedida = 1;
+    pthread_cond_signal(&hay_pendientes);
+    while (rotacion_pedida) {
+        pthread_cond_wait(&hay_durables, &wal_mutex);
+    }
+    uint64_t lsn = lsn_rotacion;
+    pthread_mutex_unlock(&wal_mutex);
+    return lsn;
+}
+
+// Función para borrar el segmento anterior una vez que hay una instantánea
+// que lo cubre
+void wal_descartar_anterior(void) {
+    if (wal_activo && unlink(archivo_anterior) == 0) {
+        sincronizar_directorio(archivo_anterior);
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * =============================================================================
+ * Proyecto: Sistema de Préstamo de Libros
+ * Archivo: wal.h
+ * Autor: Samuel Emperador
+ * Fecha: 23/05/2025
+ * Descripción: Registro de escritura anticipada (WAL) de los cambios del
+ *              catálogo. Cada préstamo, renovación o devolución agrega un
+ *              registro binario con el estado completo del ejemplar que cambió;
+ *              un hilo propio escribe y hace fdatasync de todo lo acumulado de
+ *              una vez (commit en grupo). Al arrancar se reaplica el registro
+ *              sobre la base cargada, así que un cierre abrupto no pierde
+ *              operaciones ya confirmadas al cliente. Las instantáneas rotan
+ *              el registro para que no crezca sin límite.
+ * =============================================================================
+ */
+
+#ifndef WAL_H
+#define WAL_H
+
+#include <stdint.h>
+
+#include "estructuras.h"
+
+#define WAL_CAPACIDAD_INICIAL 4096  // registros por buffer antes de crecer
+#define WAL_REINTENTOS 3            // reintentos de un grupo que no se pudo escribir
+#define WAL_ESPERA_REINTENTO_MS 100 // espera antes del primer reintento (crece lineal)
+
+// Cada segmento empieza con esta marca, que cambia con el formato del registro
+#define WAL_MAGIA "BIBWAL02"
+#define WAL_TAM_MAGIA 8
+
+// Registro en disco (32 bytes). El CRC cubre todo lo que le sigue; un
+// registro con CRC incorrecto marca el final de lo que llegó a escribirse.
+typedef struct {
+    uint32_t crc;
+    uint32_t operacion;
+    uint64_t lsn;
+    int32_t isbn;
+    int32_t ejemplar;   // posición del ejemplar dentro del libro
+    int32_t status;
+    int32_t fecha;      // número de día (ver fechas.h)
+} registro_wal_t;
+
+int wal_iniciar(const char *archivo, uint64_t lsn_minimo);
+void wal_cerrar(void);
+
+// Se llama con la franja del libro bloqueada, así el orden del registro
+// coincide con el orden en que cambió cada ejemplar. Devuelve -1 si el
+// cambio no se pudo registrar (sin memoria): hay que deshacerlo.
+int wal_registrar(operation_t operacion, const libro_t *libro, int ejemplar);
+
+// Espera a que los registros del hilo que llama estén en disco. Devuelve -1
+// si el WAL falló antes: esos cambios no son durables y no se confirman.
+int wal_sincronizar(void);
+
+// Rotación para instantáneas: el segmento actual pasa a <archivo>.anterior y
+// se abre uno nuevo. Devuelve el LSN del corte (todo lo anterior quedó en el
+// segmento viejo). Sin WAL devuelve 0; si ya hay un segmento anterior sin
+// descartar, no rota y devuelve el próximo LSN.
+uint64_t wal_rotar(void);
+void wal_descartar_anterior(void);
+
+int sincronizar_directorio(const char *ruta);
+
+#endif // WAL_H